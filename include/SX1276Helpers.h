@@ -73,7 +73,62 @@ namespace Radio {
         uint8_t     Exp;
     };
 
+    /* FRF register bytes (MSB, MID, LSB) of a carrier frequency, computed once so a hop is a single burst write */
+    struct FrequencyRegs {
+        uint32_t    frequency;
+        uint8_t     frf[3];
+    };
+
+    /* Which SX127x the calling task talks to. Only DUAL_RADIO builds have a secondary one. The
+       selection is per task, so the RX state machine and the TX path each keep their own. */
+    enum class Device : uint8_t {
+        Primary,    ///< scanning receiver; the only radio without DUAL_RADIO
+        Secondary   ///< transmitter
+    };
+
+    /* What SPI traffic is accounted to, per task like the device */
+    enum class SpiPath : uint8_t {
+        Other,
+        Rx,
+        Tx,
+        Count
+    };
+
+    /*
+        Configuration registers are shadowed in RAM per device: a write of the value a register
+        already holds is skipped and reads of registers the chip never changes by itself are
+        served from the shadow. Volatile registers (FIFO, mode, RSSI/AFC, IRQ flags, ...) always
+        go to the chip.
+    */
+    struct SpiStats {
+        uint32_t transactions;  ///< SPI transactions issued
+        uint32_t saved;         ///< transactions avoided thanks to the shadow
+    };
+
+    Device currentDevice();
+
+    /* Selects a device (and the path its SPI traffic counts for) for the calling task until the end of the scope */
+    class DeviceScope {
+        public:
+            explicit DeviceScope(Device device, SpiPath path = SpiPath::Other);
+            ~DeviceScope();
+            DeviceScope(const DeviceScope &) = delete;
+            DeviceScope &operator=(const DeviceScope &) = delete;
+
+        private:
+            Device previous;
+            SpiPath previousPath;
+    };
+
+    SpiStats spiStats(SpiPath path);
+    void resetSpiStats();
+    /* Forget the shadow of the selected device, e.g. after a reset */
+    void invalidateShadow();
+
     void initHardware();
+#if defined(DUAL_RADIO)
+    void initSecondaryHardware();
+#endif
     void initRegisters(uint8_t maxPayloadLength);
     void calibrate();
     void setStandby();
@@ -93,6 +148,8 @@ namespace Radio {
     bool inStdbyOrSleep();
     bool setParams();
     bool setCarrier(Carrier param, uint32_t value);
+    FrequencyRegs frequencyRegs(uint32_t frequency);
+    void setFrequency(const FrequencyRegs &regs);
     regBandWidth bwRegs(uint8_t bandwidth);
     void dump();
     void dumpReal();
@@ -114,6 +114,16 @@
 #define RADIO_PREAMBLE_DETECTED                 RADIO_DIO_4     // Preamble detected from Radio (used instead of FIFO empty)
 #endif
 
+/*
+ * Dual radio: a second SX127x on the same SPI bus transmits (commands and 2W replies) while the first
+ * keeps scanning. Build with -DDUAL_RADIO -DRADIO2_CS_PIN=.. -DRADIO2_DIO0_PIN=.. [-DRADIO2_RST_PIN=..]
+ */
+#if defined(DUAL_RADIO)
+#if !defined(RADIO_SX127X) || !defined(RADIO2_CS_PIN) || !defined(RADIO2_DIO0_PIN)
+#error "DUAL_RADIO needs an SX127x radio, RADIO2_CS_PIN and RADIO2_DIO0_PIN"
+#endif
+#endif
+
 #define SPI_CLK_FRQ                                 10000000
 
 /*
@@ -0,0 +1,72 @@
+#ifndef COVER_STATE_BUS_H
+#define COVER_STATE_BUS_H
+
+#include <ArduinoJson.h>
+#include <stdint.h>
+
+/* Cover state-change bus.
+ *
+ * Producers (iohcRemote1W::cmd, handleRemoteAction, updatePositions) post the
+ * latest state/position of a cover. Updates for the same device are merged
+ * inside a short coalescing window and then fanned out once to every sink
+ * (MQTT, WebSocket, OLED). Each sink has its own rate limit so moving many
+ * blinds at once cannot flood the AsyncMqttClient or WebSocket buffers. */
+
+#ifndef COVER_STATE_WINDOW_MS
+#define COVER_STATE_WINDOW_MS 150
+#endif
+
+#define COVER_STATE_MAX_DEVICES 32
+
+enum class CoverState : uint8_t {
+  Unknown,
+  Opening,
+  Closing,
+  Stop,
+  Open,
+  Close,
+};
+
+enum class CoverSink : uint8_t {
+  Mqtt,
+  WebSocket,
+  Oled,
+  Count
+};
+
+struct CoverSinkStats {
+  const char *name;
+  uint32_t delivered;  // updates handed to the sink
+  uint32_t merged;     // updates superseded before the sink saw them
+  uint32_t deferred;   // updates postponed at least once by the sink's rate limit
+  uint32_t dropped;    // updates the sink failed to accept (MQTT: not taken by the client nor the outbox)
+  uint16_t ratePerSec;
+};
+
+struct CoverStateBusStats {
+  uint32_t posted;
+  uint32_t direct;     // posts delivered by the caller because every slot had updates pending
+  uint32_t evicted;    // idle slots reused for another device
+  uint32_t flushes;
+  uint16_t windowMs;
+  uint8_t devices;
+  CoverSinkStats sinks[static_cast<uint8_t>(CoverSink::Count)];
+};
+
+const char *coverStateToString(CoverState state);
+
+void initCoverStateBus();
+/* Queue the latest state and position of a cover. `state` may be
+ * CoverState::Unknown to only update the position. Safe to call from any task. */
+void postCoverState(const uint8_t *node, const char *name, CoverState state, float position);
+/* Release the slot of a removed device so it can be reused. */
+void forgetCoverState(const uint8_t *node);
+void setCoverStateWindow(uint16_t windowMs);
+void setCoverSinkRate(CoverSink sink, uint16_t ratePerSec);
+// Accepts a sink name (mqtt, websocket, oled), case-insensitive
+bool parseCoverSink(const char *name, CoverSink &sink);
+CoverStateBusStats getCoverStateBusStats();
+void resetCoverStateBusStats();
+void appendCoverStateBusStats(JsonObject &root);
+
+#endif // COVER_STATE_BUS_H
@@ -31,7 +31,11 @@ class Line {
         std::string leftText;
         std::string rightText;
         Ticker ticker;
-        ScrollingWindow scroller;  
+        ScrollingWindow scroller;
+        // Last rendered text, rebuilt only when the text, width or scroll position changes
+        std::string rendered;
+        int renderedStart = -1;
+        int renderedWidth = -1;
     public:
         Line(const std::string &pLeftText, const std::string &pRightText);
 
@@ -39,9 +43,9 @@ class Line {
 
         void update(const std::string &pRightText);
 
-        std::string getKey() const;
+        const std::string &getKey() const;
 
-        std::string get(const int width);
+        const std::string &get(const int width);
 };
  
 class DisplayBuffer {
@@ -49,7 +53,7 @@ class DisplayBuffer {
         std::vector<Line> lines;
         ScrollingWindow scroller;
 
-        Line* find(const std::string key);
+        Line* find(const std::string &key);
         void purge();
     public:
         DisplayBuffer();
@@ -58,5 +62,7 @@ class DisplayBuffer {
 
         void clear();
 
-        std::vector<std::string> getTextToDisplay(const int width, const int height);
+        // Fills `out` with the visible lines, reusing its strings. Returns true when they differ from
+        // what `out` held before, so the caller can skip redrawing an unchanged screen.
+        bool getTextToDisplay(const int width, const int height, std::vector<std::string> &out);
 };
\ No newline at end of file
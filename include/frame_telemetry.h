@@ -0,0 +1,36 @@
+#ifndef FRAME_TELEMETRY_H
+#define FRAME_TELEMETRY_H
+
+#include <user_config.h>
+
+#if defined(MQTT)
+
+#include <iohcPacket.h>
+#include <stdint.h>
+#include <string>
+
+/* MQTT sinks for received frames, stored as a bitmask in `mqtt_frame_sinks`.
+ *
+ * Json    iown/Frame, JSON with hex strings (QoS 1)
+ * Sensor  <discovery>/sensor/iohc_frame/state, same JSON for the HA sensor
+ * Cbor    iown/Frame/cbor, compact CBOR map with integer keys:
+ *           0 raw frame (bytes), 1 rssi, 2 frequency (Hz),
+ *           3 uptime (ms), 4 decoded 1W action (text, optional) */
+enum FrameSink : uint8_t {
+  FRAME_SINK_JSON = 0x01,
+  FRAME_SINK_SENSOR = 0x02,
+  FRAME_SINK_CBOR = 0x04,
+};
+
+static constexpr char FRAME_CBOR_TOPIC[] = "iown/Frame/cbor";
+
+void loadFrameSinks();
+void setFrameSinks(uint8_t sinks);
+/* Parse a list like "json,cbor" or "none". Returns false on an unknown name. */
+bool parseFrameSinks(const std::string &list, uint8_t &sinks);
+std::string frameSinksToString(uint8_t sinks);
+void publishFrameTelemetry(const IOHC::iohcPacket *iohc);
+
+#endif // MQTT
+
+#endif // FRAME_TELEMETRY_H
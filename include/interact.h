@@ -46,27 +46,49 @@ extern "C" {
 
 #include <utils.h>
 #include <tokens.h>
-
-namespace IOHC {
-  class iohcRemote1W;
-}
+#include <iohcRemote1W.h>
 
 #if defined(ESP32)
-  #include <TickerUsESP32.h>
+  #include <timer_service.h>
   #define MAXCMDS 100
 #endif
 
+#define CMD_MAX_ARGS 4
+
 enum class ConnState { Connecting, Connected, Disconnected };
 extern ConnState mqttStatus;
-void tokenize(std::string const &str, const char delim, Tokens &out);
+
+namespace Cmd {
+
+/* One argument of a command with a schema, checked and converted before the
+ * handler runs. Only the field of its kind is set. */
+struct Arg {
+    std::string_view text;                          // as given; the whole rest for `text`
+    IOHC::iohcRemote1W::remote *device = nullptr;   // device
+    int32_t number = 0;                             // int, percent, index of the keyword
+    float temperature = 0.0f;                       // temp
+    IOHC::address node{};                           // addr
+};
+
+struct Args {
+    const TokenView *tokens = nullptr;
+    uint8_t count = 0;      // optional arguments that were left out are not counted
+    Arg arg[CMD_MAX_ARGS];
+    bool has(size_t idx) const { return idx < count; }
+    const Arg &operator[](size_t idx) const { return arg[idx]; }
+};
+
+enum class Result : uint8_t { Done, Unknown, InvalidArgs };
+
+}
 
 struct _cmdEntry {
     char cmd[15];
     char description[61];
-    void (*handler)(Tokens*);
+    const char *schema;                     // nullptr: the handler gets the raw tokens
+    void (*handler)(const TokenView *);
+    void (*typed)(const Cmd::Args &);
 };
-extern _cmdEntry* _cmdHandler[MAXCMDS];
-extern uint8_t lastEntry;
 
 
 #if defined(DEBUG)
@@ -84,17 +106,36 @@ extern bool verbosity;
 extern bool pairMode;
 extern bool scanMode;
 
-#if defined(ESP32)
-  extern TimersUS::TickerUsESP32 kbd_tick;
-#endif
-
-extern TimerHandle_t consoleTimer;
 
-
-bool addHandler(char *cmd, char *description, void (*handler)(Tokens*));
-char *cmdReceived(bool echo = false);
-void cmdFuncHandler();
+bool addHandler(char *cmd, char *description, void (*handler)(const TokenView *));
+/* Command whose arguments are checked against `schema` first, a string
+ * literal of space separated kinds, each optionally followed by '?' when it
+ * may be left out (trailing only):
+ *   device   1W device by description or six digit hex address
+ *   percent  0-100
+ *   temp     7.0 to 28.0, or 0
+ *   int      whole number
+ *   addr     six hex digits
+ *   a|b|c    one of the keywords, any case; number is its index
+ *   text     the rest of the line, spaces included
+ * The schema doubles as the usage line. */
+bool addHandler(char *cmd, char *description, const char *schema, void (*handler)(const Args &));
+/* Commands live in a fixed table indexed by a hash of their name, so the
+ * console, web (/api/command) and MQTT front ends all resolve a command in
+ * constant time through the same lookup. */
+const _cmdEntry *findHandler(const char *cmd, size_t len);
+/* Run the command named by args[0]. The shared entry point of every front
+ * end; arguments that do not match the command's schema print its usage.
+ * Commands are serialised: a call waits for the one running on another task. */
+Result dispatch(const TokenView &args);
+#if defined(CMD_BENCHMARK)
+void registerCmdBenchmark();
+void registerScanBenchmark();
+#endif
+/* Run one command line. Returns false for an unknown command. */
+bool execute(const char *cmd);
 void createCommands();
+/* Start the serial console task; lines run as soon as Enter is received. */
 void init();
 
 }
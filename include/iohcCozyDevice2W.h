@@ -40,6 +40,23 @@ namespace IOHC {
         associate,
     };
 
+    /// Heater modes, valued as sent in the setMode frame
+    enum class CozyMode : uint8_t {
+        Auto = 0x00,
+        Manual = 0x01,
+        Prog = 0x02,
+        Off = 0x04,
+        Query = 0xFF,   // no change, the heater answers with its current mode
+    };
+
+    /// Arguments of a command, already checked by the caller. Only the fields of the command are read.
+    struct CozyArgs {
+        float temperature = 0.0f;           // setTemp: 7.0 to 28.0, 0 asks for the current one
+        CozyMode mode = CozyMode::Query;    // setMode
+        bool on = false;                    // setPresence: on, setWindow: open
+        size_t device = 0;                  // setTemp, setWindow: index into addresses
+    };
+
     class iohcCozyDevice2W : public iohcDevice {
     public:
         static iohcCozyDevice2W *getInstance();
@@ -66,7 +83,7 @@ namespace IOHC {
         bool verbosity = true;
 
         bool isFake(address nodeSrc, address nodeDst) override;
-        void cmd(DeviceButton cmd, Tokens *data);
+        void cmd(DeviceButton cmd, const CozyArgs &args = {});
         bool load() override;
         bool save() override;
         static void forgePacket(iohcPacket *packet, const std::vector<uint8_t> &vector);
@@ -44,6 +44,12 @@ namespace IOHC {
         checkCmd,
     };
 
+    /// Arguments of a command, already checked by the caller. Only the fields of the command are read.
+    struct Other2WArgs {
+        uint8_t command = 0;    // custom60: command byte
+        address target{};       // getName
+    };
+
     class iohcOtherDevice2W : public iohcDevice {
     public:
         static iohcOtherDevice2W *getInstance();
@@ -59,7 +65,7 @@ namespace IOHC {
         Memorize memorizeOther2W; //2W only
 
         //            bool isFake(address nodeSrc, address nodeDst) override;
-        void cmd(Other2WButton cmd, Tokens *data);
+        void cmd(Other2WButton cmd, const Other2WArgs &args = {});
         bool load() override;
         bool save() override;
         void initializeValid();
@@ -21,6 +21,7 @@
 #include <string>
 
 #include <board-config.h>
+#include <esp_timer.h>
 
 #if defined(RADIO_SX127X)
 #include <SX1276Helpers.h>
@@ -230,6 +231,8 @@ namespace IOHC {
         uint8_t snr{}; // in dB
         float rssi{}; // -RSSI*2 of last packet received
         uint8_t lna{}; // LNA attenuation in dB
+        // Latency origin (latencyNowUs() time): DIO edge for a received frame, creation by cmd() for a sent one
+        uint32_t stampUs = static_cast<uint32_t>(esp_timer_get_time());
 
         void decode(bool verbosity = false);
         std::string decodeToString(bool verbosity = false);
@@ -27,6 +27,7 @@
 #include <board-config.h>
 #include <iohcCryptoHelpers.h>
 #include <iohcPacket.h>
+#include <iohcScanScheduler.h>
 
 #if defined(RADIO_SX127X)
         #include <SX1276Helpers.h>
@@ -34,15 +35,30 @@
 #if defined(RADIO_SX126X)
         #include <SX126xHelpers.h>
 #endif
-#if defined(ESP32)
-    #include <TickerUsESP32.h>
-#endif
+#include <timer_service.h>
 
-#define SM_GRANULARITY_US               130ULL  // Ticker function frequency in uS (100 minimum) 4 x 26µs = 104
-#define SM_GRANULARITY_MS               1       // Ticker function frequency in uS
-#define SM_PREAMBLE_RECOVERY_TIMEOUT_US 1378 // 12500   // SM_GRANULARITY_US * PREAMBLE_LSB //12500   // Maximum duration in uS of Preamble before reset of receiver
+#define SM_PREAMBLE_RECOVERY_TIMEOUT_US 12500   // Preamble without payload: check the carrier again after this many uS
+#define SM_PREAMBLE_MAX_US              2100000 // Longest preamble (1W long preamble 1920 ms) before the receiver is restarted anyway
 #define DEFAULT_SCAN_INTERVAL_US        13520   // Default uS between frequency changes
 
+// Listen before talk: the TX channel must stay clear for LBT_WINDOW_US before the first frame of a batch
+#ifndef LBT_DEFAULT_ENABLED
+#define LBT_DEFAULT_ENABLED             false
+#endif
+#ifndef LBT_RSSI_THRESHOLD_DBM
+#define LBT_RSSI_THRESHOLD_DBM          -90     // Channel busy above this RSSI
+#endif
+#define LBT_SAMPLE_US                   500     // RSSI / preamble sampling period
+#define LBT_WINDOW_US                   5000    // Clear time needed before transmitting
+#define LBT_BACKOFF_MIN_US              5000    // Random backoff after a busy sample
+#define LBT_BACKOFF_MAX_US              40000
+#define LBT_MAX_WAIT_US                 300000  // Transmit anyway after this long
+
+// Callback task lanes, see CallbackLane
+#define CALLBACK_HIGH_DEPTH             16
+#define CALLBACK_LOW_DEPTH              32
+#define CALLBACK_SESSION_WINDOW_MS      2000    // 2W frames this soon after our own TX belong to our exchange
+
 /*
     Singleton class to implement an IOHC Radio abstraction layer for controllers.
     Implements all needed functionalities to receive and send packets from/to the air, masking complexities related to frequency hopping
@@ -51,6 +67,66 @@
 namespace IOHC {
     using IohcPacketDelegate = Delegate<bool(iohcPacket *iohc)>;
 
+    /*
+        Timing summary of the last completed TX batch.
+        startSpreadUs is the time between the end of the first transmission of the first and of the
+        last frame, i.e. how far apart the addressed devices were told to start.
+    */
+    struct TxBatchReport {
+        uint16_t frames = 0;
+        bool interleaved = false;
+        int64_t startedUs = 0;
+        uint32_t startSpreadUs = 0;
+        uint32_t durationUs = 0;
+    };
+
+    /*
+        Listen-before-talk outcome of the TX batches since the last reset.
+        waitUs is the time from the batch being ready to its first transmission.
+    */
+    struct LbtStats {
+        uint32_t assessments = 0;
+        uint32_t clear = 0;             ///< channel clear at the first attempt
+        uint32_t deferred = 0;          ///< had to back off at least once, then found the channel clear
+        uint32_t forced = 0;            ///< still busy after LBT_MAX_WAIT_US, sent anyway
+        uint32_t backoffs = 0;
+        uint32_t maxWaitUs = 0;
+        uint64_t totalWaitUs = 0;
+    };
+
+    /*
+        Wakeups of the RX state machine. It only runs on DIO edges and on the deadlines it
+        schedules itself (next hop, preamble recovery), so a quiet channel costs one wakeup per hop.
+    */
+    struct RxEventStats {
+        uint32_t edges = 0;
+        uint32_t deadlines = 0;
+        uint32_t stale = 0;             ///< deadline events superseded by a later schedule
+        uint32_t preambleTimeouts = 0;
+        uint32_t ownFrames = 0;         ///< own transmissions heard by the receiver and dropped (DUAL_RADIO)
+        uint32_t frames = 0;            ///< frames read from the FIFO
+    };
+
+    /*
+        Received and sent frames reach rxCB/txCB through the callback task. Messages are passed by
+        value in two queues and the High lane is always drained first: TX confirmations and 2W
+        frames of an exchange we are part of go there, 1W repeats and sniffed 2W traffic go Low.
+        A full lane drops the frame and counts it.
+    */
+    enum class CallbackLane : uint8_t {
+        High,
+        Low,
+        Count
+    };
+
+    struct CallbackLaneStats {
+        uint32_t queued = 0;
+        uint32_t dropped = 0;
+        uint8_t depth = 0;              ///< messages waiting now
+        uint8_t highWater = 0;          ///< most messages ever waiting since the last reset
+        uint8_t capacity = 0;
+    };
+
     class iohcRadio  {
         public:
             static iohcRadio *getInstance();
@@ -67,19 +143,42 @@ namespace IOHC {
             void start(uint8_t num_freqs, uint32_t *scan_freqs, uint32_t scanTimeUs, IohcPacketDelegate rxCallback, IohcPacketDelegate txCallback);
             void send(iohcPacket *packet);
             void send(std::vector<iohcPacket*>&iohcTx);
+            /* Send a batch round-robin: every frame gets its first transmission before any repeat, all behind one long preamble */
+            void sendInterleaved(std::vector<iohcPacket*>&iohcTx);
+            const TxBatchReport& lastBatchReport() const { return batchReport; }
+            /* Clear channel assessment before every TX batch */
+            void setListenBeforeTalk(bool enabled) { lbtEnabled = enabled; }
+            bool listenBeforeTalk() const { return lbtEnabled; }
+            const LbtStats& lbtStats() const { return lbt; }
+            void resetLbtStats() { lbt = LbtStats{}; }
+            /* Decides the channel order and dwell while scanning */
+            iohcScanScheduler& scheduler() { return scanScheduler; }
             static void setRadioState(RadioState newState);
             static const char* radioStateToString(RadioState state);
             volatile static RadioState radioState;
-            static void tickerCounter(iohcRadio *radio);
+            static void processEvents(iohcRadio *radio, uint32_t events);
+            const RxEventStats& rxEventStats() const { return rxStats; }
+            /* Frames put on air, repeats included */
+            uint32_t transmissions() const { return txTransmissions; }
+            static CallbackLaneStats callbackStats(CallbackLane lane);
+            static void resetCallbackStats();
             static volatile bool txComplete;
             //static void setPreambleLength(uint16_t preambleLen);
 
         private:
             iohcRadio();
-            bool receive(bool stats);
+            bool receive();
             bool sent(iohcPacket *packet);
-            void queueSend(std::vector<iohcPacket*> &iohcTx);
+            void queueSend(std::vector<iohcPacket*> &iohcTx, bool interleaved = false);
             void startQueuedSend();
+            void sendFirst();
+            static bool channelBusy();
+            static void IRAM_ATTR onCcaTicker(void *arg);
+            void finishBatch();
+            void transmit(iohcPacket *packet);
+            bool isOwnFrame(const iohcPacket *packet);
+            void buildCarrierTable();
+            void tune(uint32_t frequency);
 
             static iohcRadio *_iohcRadio;
             static uint8_t _flags[2];
@@ -87,27 +186,70 @@ namespace IOHC {
             
             volatile static bool send_lock;
 
-            volatile uint32_t tickCounter = 0;
-            volatile uint32_t preCounter = 0;
-            volatile uint8_t txCounter = 0;
+            enum class Deadline : uint8_t {
+                None,
+                Hop,                ///< end of the dwell on the current channel
+                PreambleRecovery    ///< preamble seen, payload still due
+            };
+            void onEdge(uint32_t edgeUs);
+            void onDeadline(uint32_t now);
+            void armHop(uint32_t fromUs);
+            void scheduleDeadline(uint32_t atUs, Deadline kind);
+            TimerToken deadlineTimer{};
+            Deadline deadlineKind = Deadline::None;
+            uint32_t deadlineUs = 0;
+            uint32_t preambleStartUs = 0;
+            RxEventStats rxStats{};
+            uint32_t txTransmissions = 0;
+            volatile uint32_t lastTxMs = 0;
+            volatile bool txActive = false;
+
+            bool lbtEnabled = LBT_DEFAULT_ENABLED;
+            LbtStats lbt{};
+            int64_t ccaStartUs = 0;
+            uint16_t ccaClearSamples = 0;
+            uint16_t ccaBackoff = 0;
+            bool ccaDeferred = false;
+            volatile uint16_t txCounter = 0;
             static void IRAM_ATTR onTxTicker(void *arg);
 
             uint8_t num_freqs = 0;
             uint32_t *scan_freqs{};
             uint32_t scanTimeUs{};
             uint8_t currentFreqIdx = 0;
+            iohcScanScheduler scanScheduler;
+            volatile uint32_t dwellUs{};
 
-        #if defined(ESP8266)
-            Timers::TickerUs Sender;
-        #elif defined(ESP32)
-            TimersUS::TickerUsESP32 Sender;
-        #endif
+            // FRF bytes of the scan channels (same index) followed by the other TX channels
+            static constexpr uint8_t MAX_CARRIERS = iohcScanScheduler::MAX_CHANNELS + 3;
+            Radio::FrequencyRegs carriers[MAX_CARRIERS]{};
+            uint8_t numCarriers = 0;
+            uint32_t tunedFrequency[2]{};   // per Radio::Device
+
+            // Last frame sent by a dedicated transmitter, so the receiver does not report hearing it
+            uint8_t ownFrame[MAX_FRAME_LEN]{};
+            uint8_t ownFrameLen = 0;
+            uint32_t ownFrameUntilMs = 0;
+
+            TimerToken txTimer{};      // CCA sampling, then the repeat ticker of the current batch
             iohcPacket *iohc{};
             
             IohcPacketDelegate rxCB = nullptr;
             IohcPacketDelegate txCB = nullptr;
+            struct TxBatch {
+                std::vector<iohcPacket*> packets;
+                bool interleaved;
+            };
             std::vector<iohcPacket*> packets2send{};
-            std::queue<std::vector<iohcPacket*>> sendQueue{};
+            std::queue<TxBatch> sendQueue{};
+            bool txInterleaved = false;
+            uint16_t txRemaining = 0;
+            uint16_t txFirstSeen = 0;
+            bool txAwaitingFirstDone = false;   // the frame on air is sent for the first time
+            int64_t txFirstUs = 0;
+            uint32_t txFirstDoneUs = 0;
+            uint32_t txLastFirstDoneUs = 0;
+            TxBatchReport batchReport{};
         protected:
             static void i_preamble();
             static void i_payload();
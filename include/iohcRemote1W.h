@@ -22,6 +22,7 @@
 #include <string>
 #include <tokens.h>
 #include <blind_position.h>
+#include <cover_state_bus.h>
 
 #define IOHC_1W_REMOTE  "/1W.json"
 
@@ -46,6 +47,9 @@ namespace IOHC {
         Mode1, Mode2, Mode3, Mode4
     };
 
+    // Parse the action names accepted by group commands (open, close, stop, vent, force, position, absolute)
+    bool groupActionFromString(const std::string &action, RemoteButton &btn);
+
     class iohcRemote1W : public iohcDevice {
     public:
         struct remote {
@@ -62,14 +66,26 @@ namespace IOHC {
             BlindPosition positionTracker{};
             enum class Movement { Idle, Opening, Closing } movement{Movement::Idle};
             float lastPublishedPosition{0.0f};
-            std::string lastPublishedState{};
+            CoverState lastPublishedState{CoverState::Unknown};
             float targetPosition{-1.0f};
         };
 
+        struct groupResult {
+            uint16_t devices{};                // devices that put a frame in the batch
+            std::vector<std::string> missing;  // members that did not resolve to a device
+            uint32_t estimatedSpreadMs{};      // expected delay between first and last device starting
+        };
+
         static iohcRemote1W* getInstance();
         ~iohcRemote1W() override = default;
 
-        void cmd(RemoteButton cmd, Tokens* data);
+        /* With `collect` the frames are appended to it instead of being sent, see groupCmd */
+        void cmd(RemoteButton cmd, const TokenView *data, std::vector<iohcPacket *> *collect = nullptr);
+        /* Same with the arguments already parsed; `percent` is only used by Position and Absolute */
+        void cmd(RemoteButton cmd, remote &r, uint8_t percent = 0, std::vector<iohcPacket *> *collect = nullptr);
+        /* Device by description or six digit hex address, nullptr if unknown */
+        remote *findRemote(std::string_view descriptionOrAddress);
+        const remote *findRemote(std::string_view descriptionOrAddress) const;
         void handleRemoteAction(RemoteButton cmd, const std::string &description);
         bool load() override;
         bool save() override;
@@ -84,9 +100,17 @@ namespace IOHC {
         bool setTravelTime(const std::string &description, uint32_t travelTime);
         bool setRepeatOnNoResponse(const std::string &description, bool repeatOnNoResponse);
         void updatePositions();
+        /*
+            Resolve a group spec to device descriptions: "all", the name of a remote map entry,
+            or a comma separated list of descriptions and/or hex addresses
+        */
+        std::vector<std::string> resolveGroup(const std::string &spec) const;
+        /* Plan the command for all members as a single interleaved TX batch behind one long preamble */
+        groupResult groupCmd(RemoteButton cmd, const std::vector<std::string> &members, uint8_t percent = 0);
 
     private:
         iohcRemote1W();
+        void dispatch(std::vector<iohcPacket *> &packets, std::vector<iohcPacket *> *collect);
 
         static iohcRemote1W* _iohcRemote1W;
 
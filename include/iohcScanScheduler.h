@@ -0,0 +1,82 @@
+#ifndef IOHC_SCAN_SCHEDULER_H
+#define IOHC_SCAN_SCHEDULER_H
+
+#include <cstdint>
+
+/* Channel dwell policy for the RX frequency scan.
+ *
+ * Channels are still visited round-robin, so every channel is visited once
+ * per cycle. The cycle length stays at channels x base dwell. With the
+ * adaptive policy the dwell of each channel is at least SCAN_MIN_DWELL_PERCENT
+ * of the base dwell; the rest of the cycle is shared out in proportion to
+ * recent preamble and 2W frame hits on that channel. 1W frames barely count:
+ * their long repeated preambles span a whole scan cycle and are heard at any
+ * dwell. Scores decay slowly so the split follows where short-preamble
+ * traffic actually occurs over the last minutes. */
+
+#ifndef SCAN_MIN_DWELL_PERCENT
+#define SCAN_MIN_DWELL_PERCENT 40
+#endif
+
+// Scores lose 1/16 every SCAN_DECAY_CYCLES cycles (about 10 s with 3 channels)
+#ifndef SCAN_DECAY_CYCLES
+#define SCAN_DECAY_CYCLES 256
+#endif
+
+namespace IOHC {
+    struct ScanHop {
+        uint8_t channel;
+        uint32_t dwellUs;
+    };
+
+    class iohcScanScheduler {
+    public:
+        static constexpr uint8_t MAX_CHANNELS = 8;
+
+        enum class Policy : uint8_t {
+            Fixed,
+            Adaptive,
+        };
+
+        struct ChannelStats {
+            uint32_t preambles;
+            uint32_t frames;
+            uint32_t visits;
+            uint32_t score;
+            uint32_t dwellUs;
+        };
+
+        void begin(uint8_t channels, uint32_t baseDwellUs);
+        void setPolicy(Policy policy);
+        Policy policy() const { return _policy; }
+        uint8_t channels() const { return _channels; }
+
+        void recordPreamble(uint8_t channel);
+        void recordFrame(uint8_t channel, bool oneWay);
+
+        // The channel to listen on first, and its dwell
+        ScanHop first();
+        // Called when the dwell on the current channel has elapsed
+        ScanHop next();
+
+        ChannelStats stats(uint8_t channel) const;
+        void resetStats();
+
+    private:
+        void recomputeDwell();
+        void addScore(uint8_t channel, uint32_t weight);
+
+        Policy _policy = Policy::Adaptive;
+        uint8_t _channels = 0;
+        uint8_t _current = 0;
+        uint32_t _baseDwellUs = 0;
+        uint32_t _cycles = 0;
+        uint32_t _score[MAX_CHANNELS]{};
+        uint32_t _dwellUs[MAX_CHANNELS]{};
+        uint32_t _preambles[MAX_CHANNELS]{};
+        uint32_t _frames[MAX_CHANNELS]{};
+        uint32_t _visits[MAX_CHANNELS]{};
+    };
+}
+
+#endif // IOHC_SCAN_SCHEDULER_H
@@ -0,0 +1,47 @@
+#ifndef LATENCY_METRICS_H
+#define LATENCY_METRICS_H
+
+#include <ArduinoJson.h>
+#include <stdint.h>
+
+/* Radio latency histograms.
+ *
+ * RX stages are measured from the DIO edge seen by the ISR, TX stages from
+ * the moment the packet was built by a device's cmd(). Each stage keeps a
+ * histogram with four buckets per power of two (at most 25% wide, 12.5% on
+ * average), so percentiles are approximate while min and max are exact. */
+
+#define LATENCY_SUB_BUCKETS 4
+#define LATENCY_BUCKETS 124   // covers the full uint32_t range
+
+enum class LatencyStage : uint8_t {
+  RxWake,       // handle_interrupt_task woke up
+  RxDrained,    // frame read from the FIFO
+  RxDequeued,   // callback task picked it up
+  RxPublished,  // MQTT publish queued by msgRcvd
+  RxHandled,    // msgRcvd returned
+  TxFirst,      // first transmission of the frame
+  TxDone,       // last repeat sent
+  Count
+};
+
+struct LatencySummary {
+  uint32_t count;
+  uint32_t minUs;
+  uint32_t maxUs;
+  uint32_t avgUs;
+  uint32_t p50Us;
+  uint32_t p99Us;
+};
+
+/* Low 32 bits of esp_timer, the time base of every stamp. */
+uint32_t latencyNowUs();
+/* Safe to call from any task. Times are latencyNowUs() values; the stage took untilUs - sinceUs. */
+void recordLatency(LatencyStage stage, uint32_t sinceUs, uint32_t untilUs = latencyNowUs());
+LatencySummary getLatency(LatencyStage stage);
+void resetLatency();
+const char *latencyStageName(LatencyStage stage);
+/* One object per stage, keyed by stage name. */
+void appendLatencyMetrics(JsonObject &stages);
+
+#endif // LATENCY_METRICS_H
@@ -0,0 +1,40 @@
+#ifndef LINK_QUALITY_H
+#define LINK_QUALITY_H
+
+#include <ArduinoJson.h>
+#include <stdint.h>
+#include <vector>
+
+/* Per-device link quality.
+ *
+ * Every received frame carries the RSSI, AFC and LNA gain read at payload
+ * ready time. They are folded into a fixed table keyed by the source address:
+ * frame count, min/max RSSI since the last reset, a rolling (exponential)
+ * RSSI and AFC average and when the device was last heard. When the table is
+ * full the device heard least recently is replaced. */
+
+#define LINK_QUALITY_MAX_DEVICES 32
+// Weight of a new sample in the rolling averages is 1/LINK_QUALITY_SMOOTHING
+#define LINK_QUALITY_SMOOTHING 8
+
+struct LinkQuality {
+  uint8_t address[3];
+  uint32_t frames;
+  float rssiLast;
+  float rssiMin;
+  float rssiMax;
+  float rssiAvg;
+  float afcAvg;       // Hz
+  uint8_t lnaDb;      // LNA attenuation of the last frame
+  uint32_t frequency; // channel of the last frame
+  uint32_t lastSeenMs;
+};
+
+/* Safe to call from any task. */
+void recordLinkQuality(const uint8_t *source, float rssi, float afc, uint8_t lnaDb, uint32_t frequency);
+/* Snapshot, most recently heard first. */
+std::vector<LinkQuality> getLinkQuality();
+void resetLinkQuality();
+void appendLinkQuality(JsonArray &devices);
+
+#endif // LINK_QUALITY_H
@@ -1,9 +1,27 @@
 #ifndef LOG_BUFFER_H
 #define LOG_BUFFER_H
 #include <Arduino.h>
-#include <vector>
+#include <functional>
+
+/* Recent log messages, kept in a fixed-size byte ring of length-prefixed
+ * records. Every message gets the next ID (starting at 1); the oldest records
+ * are overwritten when the ring is full. Safe to call from any task. */
+
+#ifndef LOG_BUFFER_KB
+#define LOG_BUFFER_KB 8
+#endif
+// Longer messages are truncated
+#define LOG_MAX_MESSAGE 255
 
 void addLogMessage(const String &msg);
-std::vector<String> getLogMessages();
+// `severity` is the syslog severity the message is forwarded with (6: informational)
+void addLogMessage(const char *msg, size_t len, int severity = 6);
+
+/* Calls `emit` for every message with an ID greater than `since`, oldest
+ * first. Returns the number of requested messages that were already
+ * overwritten. */
+uint32_t readLogMessages(uint32_t since, const std::function<void(uint32_t id, const char *msg, size_t len)> &emit);
+// ID of the newest message, 0 when none was logged yet
+uint32_t lastLogId();
 
 #endif // LOG_BUFFER_H
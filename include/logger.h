@@ -0,0 +1,90 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Deferred logging.
+ *
+ * LOG_E/W/I/D/V(Module, "fmt", ...) only checks the module level and copies
+ * the format pointer plus the raw arguments into a binary ring. The format
+ * must be a string literal: its address is fixed at link time and serves as
+ * the message ID. A low priority task formats the records and hands them to
+ * the sinks (serial, the web log buffer and syslog), so a disabled message
+ * costs one compare and an enabled one a short copy, without vsnprintf.
+ *
+ * %s arguments are copied (up to LOGGER_MAX_STRING bytes); %n is not
+ * supported. When the ring is full new records are dropped and counted. */
+
+#ifndef LOGGER_RING_KB
+#define LOGGER_RING_KB 4
+#endif
+
+#ifndef LOGGER_DEFAULT_LEVEL
+#define LOGGER_DEFAULT_LEVEL LogLevel::Debug
+#endif
+
+#define LOGGER_MAX_STRING 96
+#define LOGGER_MAX_LINE 256
+
+enum class LogLevel : uint8_t {
+  None,
+  Error,
+  Warn,
+  Info,
+  Debug,
+  Verbose,
+};
+
+enum class LogModule : uint8_t {
+  Core,
+  Radio,
+  Mqtt,
+  Web,
+  Script,
+  Idf,     // ESP-IDF / Arduino core output via esp_log
+  Count
+};
+
+struct LoggerStats {
+  uint32_t written;
+  uint32_t dropped;
+  uint32_t formatted;
+};
+
+// Per-module level, indexed by LogModule
+extern volatile uint8_t logModuleLevels[static_cast<uint8_t>(LogModule::Count)];
+
+inline bool logEnabled(LogModule module, LogLevel level) {
+  return static_cast<uint8_t>(level) <= logModuleLevels[static_cast<uint8_t>(module)];
+}
+
+void logWrite(LogModule module, LogLevel level, const char *fmt, ...) __attribute__((format(printf, 3, 4)));
+void logWriteV(LogModule module, LogLevel level, const char *fmt, va_list args);
+
+/* Start the formatting task. Records written before it runs stay queued. */
+void initLogger();
+void setLogLevel(LogModule module, LogLevel level);
+LogLevel getLogLevel(LogModule module);
+const char *logModuleName(LogModule module);
+const char *logLevelName(LogLevel level);
+// Accepts a module name, case-insensitive
+bool parseLogModule(const char *name, LogModule &module);
+// Accepts a level name or its number (0-5)
+bool parseLogLevel(const char *name, LogLevel &level);
+LoggerStats getLoggerStats();
+
+#define LOG_AT(level, module, fmt, ...)                                   \
+  do {                                                                    \
+    if (logEnabled(LogModule::module, level))                             \
+      logWrite(LogModule::module, level, "" fmt, ##__VA_ARGS__);          \
+  } while (0)
+
+#define LOG_E(module, fmt, ...) LOG_AT(LogLevel::Error, module, fmt, ##__VA_ARGS__)
+#define LOG_W(module, fmt, ...) LOG_AT(LogLevel::Warn, module, fmt, ##__VA_ARGS__)
+#define LOG_I(module, fmt, ...) LOG_AT(LogLevel::Info, module, fmt, ##__VA_ARGS__)
+#define LOG_D(module, fmt, ...) LOG_AT(LogLevel::Debug, module, fmt, ##__VA_ARGS__)
+#define LOG_V(module, fmt, ...) LOG_AT(LogLevel::Verbose, module, fmt, ##__VA_ARGS__)
+
+#endif // LOGGER_H
@@ -10,19 +10,36 @@
 
 #include <AsyncMqttClient.h>
 #include <ArduinoJson.h>
+#include <iohcRemote1W.h>
 
 extern AsyncMqttClient mqttClient;
 
 void initMqtt();
 void connectToMqtt();
-void publishDiscovery(const std::string &id, const std::string &name, const std::string &key);
-void publishTravelTimeDiscovery(const std::string &id, const std::string &name,
-                                const std::string &key, uint32_t travelTime);
+/* Discovery (cover, buttons, travel time number) and topics are cached per remote and
+ * only rebuilt when its name, key, travel time or the discovery prefix change. */
+void publishDiscovery(const IOHC::iohcRemote1W::remote &r);
+void publishTravelTime(const IOHC::iohcRemote1W::remote &r);
 void handleMqttConnect();
-void publishCoverState(const std::string &id, const char *state);
-void publishCoverPosition(const std::string &id, float position);
+/* Return false when neither the client nor the outbox took the message. */
+bool publishCoverState(const uint8_t *node, const char *state);
+bool publishCoverPosition(const uint8_t *node, float position);
 void publishVersionInfo();
-void removeDiscovery(const std::string &id);
+void removeDiscovery(const uint8_t *node);
+
+/* Progress of the paced discovery publisher that runs after every (re)connect. */
+struct MqttDiscoveryProgress {
+    uint16_t total;
+    uint16_t acked;
+    uint16_t retries;       // ack timeouts, each costs an attempt
+    uint16_t refused;       // publishes the client did not accept, retried after a backoff
+    uint16_t failed;
+    uint32_t elapsedMs;
+    bool running;
+    bool aborted;
+};
+MqttDiscoveryProgress getMqttDiscoveryProgress();
+void appendMqttDiagnostics(JsonObject &root);
 
 #endif // MQTT
 
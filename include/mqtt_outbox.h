@@ -0,0 +1,67 @@
+#ifndef MQTT_OUTBOX_H
+#define MQTT_OUTBOX_H
+
+#include <user_config.h>
+
+#if defined(MQTT)
+
+#include <ArduinoJson.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Offline outbox for MQTT publishes.
+ *
+ * While the broker is unreachable (or the client refuses a publish) messages
+ * are copied into fixed-size tables in internal RAM (about 32 KB with the
+ * defaults below) instead of being lost; nothing is allocated while queuing.
+ * State topics keep only their latest value, event topics such as iown/Frame
+ * are kept in FIFO order in a ring that overwrites the oldest entry when full. After a
+ * reconnect the outbox is replayed at a limited rate. */
+
+#ifndef MQTT_OUTBOX_STATES
+#define MQTT_OUTBOX_STATES 64        // distinct last-value topics
+#endif
+#ifndef MQTT_OUTBOX_EVENTS
+#define MQTT_OUTBOX_EVENTS 32        // ring slots for FIFO events
+#endif
+#ifndef MQTT_OUTBOX_MAX_TOPIC
+#define MQTT_OUTBOX_MAX_TOPIC 80     // including the terminator; longer topics are dropped, not queued
+#endif
+#ifndef MQTT_OUTBOX_MAX_PAYLOAD
+#define MQTT_OUTBOX_MAX_PAYLOAD 256  // fits a frame JSON; larger payloads are dropped, not queued
+#endif
+#ifndef MQTT_OUTBOX_DRAIN_RATE
+#define MQTT_OUTBOX_DRAIN_RATE 25    // messages per second during replay
+#endif
+
+enum class OutboxPolicy : uint8_t {
+  LastValue,  // only the newest payload per topic is replayed
+  Fifo,       // every message is replayed in order
+};
+
+struct MqttOutboxStats {
+  uint32_t queued;     // messages that went into the outbox
+  uint32_t compacted;  // queued states replaced by a newer value
+  uint32_t dropped;    // messages lost to overflow or oversize topics and payloads
+  uint32_t replayed;   // messages published from the outbox
+  uint16_t states;     // current depth of the last-value table
+  uint16_t events;     // current depth of the FIFO ring
+  uint16_t maxDepth;
+  bool online;
+};
+
+void initMqttOutbox();
+/* Publish now when the outbox is online and empty, otherwise queue the message.
+ * Returns false when the message had to be dropped. Safe to call from any task. */
+bool outboxPublish(const char *topic, const char *payload, size_t len, uint8_t qos, bool retain,
+                   OutboxPolicy policy);
+/* Start replaying after (re)connect, once discovery has been published. */
+void resumeMqttOutbox();
+/* Queue everything from now on; called when the broker connection drops. */
+void pauseMqttOutbox();
+MqttOutboxStats getMqttOutboxStats();
+void appendMqttOutboxStats(JsonObject &root);
+
+#endif // MQTT
+
+#endif // MQTT_OUTBOX_H
@@ -0,0 +1,57 @@
+#ifndef SCRIPT_RUNNER_H
+#define SCRIPT_RUNNER_H
+
+#include <ArduinoJson.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/* Command scripts.
+ *
+ * Scripts are stored as text files in LittleFS under SCRIPT_DIR and run one
+ * at a time by a single executor task. A script holds one statement per line
+ * (';' also separates statements):
+ *
+ *   # comment
+ *   delay <ms>               wait, measured from the previous delay deadline
+ *   repeat <n> ... end       run the block n times
+ *   foreach <group> ... end  run the block for every device of a group
+ *                            ("all", a remote map name or "dev1,dev2");
+ *                            $dev is replaced by the device description
+ *   waitframe <addr|any> [timeout ms]
+ *                            wait for a frame from a 1W address (default
+ *                            timeout 10 s); a timeout aborts the script
+ *   <anything else>          a console command, e.g. "position 40 $dev" */
+
+#define SCRIPT_DIR "/scripts"
+#define SCRIPT_MAX_STEPS 128
+#define SCRIPT_QUEUE_DEPTH 4
+
+struct ScriptStatus {
+  bool running;
+  std::string name;
+  uint16_t step;      // index of the statement being executed
+  uint16_t steps;
+  uint32_t elapsedMs;
+  uint8_t queued;
+  uint32_t completed;
+  std::string lastError;
+};
+
+void initScriptRunner();
+std::vector<std::string> listScripts();
+bool loadScript(const std::string &name, std::string &body);
+/* Validates the script before writing it. */
+bool saveScript(const std::string &name, const std::string &body, std::string &error);
+bool deleteScript(const std::string &name);
+/* Queue a stored script, or script text given inline. */
+bool runScript(const std::string &name, std::string &error);
+bool runScriptText(const std::string &body, std::string &error);
+/* Abort the running script and drop queued ones. */
+void stopScripts();
+ScriptStatus getScriptStatus();
+void appendScriptStatus(JsonObject &root);
+/* Called from the RX path for every received frame. */
+void scriptFrameReceived(const uint8_t *source);
+
+#endif // SCRIPT_RUNNER_H
@@ -7,8 +7,16 @@
 
 #pragma once
 #include <Arduino.h>
+#include <ArduinoJson.h>
 
-// Initialize UDP + target IP from user_config.h
+/* Messages are queued and sent by a dedicated task, so logging never waits
+ * on DNS or the network. When the queue is full the oldest record is
+ * dropped. */
+
+// Create the sender queue and task; call once after NVS is initialised
+void startSyslogSender();
+
+// Load the settings from NVS and have the sender re-resolve the server
 void initSyslog();
 
 // Reset the UDP sender state so that configuration changes are applied
@@ -20,6 +28,10 @@ void sendSyslog(const String &msg);
 // New signature with explicit severity (0..7)
 // 0 emerg, 1 alert, 2 crit, 3 err, 4 warn, 5 notice, 6 info, 7 debug
 void sendSyslog(const String &msg, int severity);
+void sendSyslog(const char *msg, size_t len, int severity);
+
+// Sender counters for /api/syslog, as root["stats"]
+void appendSyslogStats(JsonObject &root);
 
 #endif // SYSLOG_HELPER_H
 
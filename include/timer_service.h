@@ -0,0 +1,79 @@
+#ifndef TIMER_SERVICE_H
+#define TIMER_SERVICE_H
+
+#include <Delegate.h>
+#include <stdint.h>
+#include <vector>
+
+extern "C" {
+#include "freertos/FreeRTOS.h"
+#include "esp_timer.h"
+}
+
+/* Timer service.
+ *
+ * All software timers of the firmware share one esp_timer, always armed for
+ * the earliest deadline, so there is one timer interrupt and one dispatch
+ * path however many timers run. A timer is dispatched either
+ *
+ * Immediate  from the esp_timer task, for short time critical work (TX
+ *            repeats, clear channel assessment, RX deadlines), or
+ * Worker     from the low priority "timers" task, for housekeeping that may
+ *            block for a while (MQTT heartbeat, display, WiFi).
+ *
+ * Callbacks are delegates, so they can capture what they need instead of
+ * squeezing an argument into 32 bits. Starting a timer returns a token;
+ * cancelling through a stale token (the timer already fired or the slot was
+ * reused) does nothing. A timer may cancel or restart itself from its
+ * callback.
+ *
+ * Lateness (dispatch time minus deadline) is accumulated per timer name, the
+ * name being a string literal. */
+
+#define TIMER_SERVICE_MAX_TIMERS 24
+#define TIMER_SERVICE_MAX_NAMES 16
+#define TIMER_SERVICE_STACK 4096
+
+using TimerCallback = Delegate<void()>;
+
+enum class TimerDispatch : uint8_t {
+  Immediate,
+  Worker,
+};
+
+struct TimerToken {
+  uint8_t slot = UINT8_MAX;
+  uint16_t generation = 0;
+};
+
+struct TimerStats {
+  const char *name;
+  bool worker;
+  uint32_t fires;
+  uint32_t skipped;     // periods dropped because the callback overran
+  uint32_t lateLastUs;
+  uint32_t lateMaxUs;
+  uint64_t lateTotalUs;
+};
+
+/* Creates the esp_timer and the worker task. Call once, before any timer starts. */
+void initTimerService();
+
+/* Run `callback` once after `delayUs`. */
+TimerToken timerOnce(const char *name, uint64_t delayUs, TimerCallback callback,
+                     TimerDispatch dispatch = TimerDispatch::Immediate);
+/* Run `callback` every `periodUs`, first after one period. */
+TimerToken timerEvery(const char *name, uint64_t periodUs, TimerCallback callback,
+                      TimerDispatch dispatch = TimerDispatch::Immediate);
+/* Returns false when the timer was no longer pending. Clears the token. */
+bool timerCancel(TimerToken &token);
+/* Changes the period of a timerEvery timer in place, keeping its slot and token. A pending timer next
+ * fires one new period from now, a running one one new period after its current deadline. Returns
+ * false when the timer is no longer active. */
+bool timerReschedule(const TimerToken &token, uint64_t periodUs);
+bool timerActive(const TimerToken &token);
+
+std::vector<TimerStats> getTimerStats();
+void resetTimerStats();
+
+#endif // TIMER_SERVICE_H
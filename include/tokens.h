@@ -2,5 +2,147 @@
 #define TOKENS_H
 #include <vector>
 #include <string>
+#include <string_view>
+#include <charconv>
+#include <cstdint>
+#include <cstdlib>
 using Tokens = std::vector<std::string>;
+
+#ifndef TOKENS_MAX
+#define TOKENS_MAX 16
+#endif
+
+/* Split `line` on `delim` the way std::getline does: empty fields between
+ * delimiters are kept, a trailing delimiter does not add an empty token. */
+template <typename Emit>
+inline void splitTokens(std::string_view line, char delim, Emit &&emit) {
+    size_t start = 0;
+    while (start < line.size()) {
+        const size_t end = line.find(delim, start);
+        if (end == std::string_view::npos) {
+            emit(line.substr(start));
+            return;
+        }
+        emit(line.substr(start, end - start));
+        start = end + 1;
+    }
+}
+
+/* Non-allocating tokenizer and the argument list of every command handler:
+ * holds views into the caller's buffers, which must outlive it. Tokens past
+ * TOKENS_MAX are ignored and flagged as truncated. */
+class TokenView {
+public:
+    TokenView() = default;
+    explicit TokenView(std::string_view line, char delim = ' ') { split(line, delim); }
+
+    void split(std::string_view line, char delim = ' ') {
+        _line = line;
+        _count = 0;
+        _truncated = false;
+        splitTokens(line, delim, [this](std::string_view token) { append(token); });
+    }
+
+    /* Add a token that is not part of the split line, e.g. a device name
+     * containing spaces. */
+    bool append(std::string_view token) { return insert(_count, token); }
+    bool insert(size_t idx, std::string_view token) {
+        if (_count == TOKENS_MAX || idx > _count) {
+            _truncated = true;
+            return false;
+        }
+        for (size_t i = _count; i > idx; --i) _tokens[i] = _tokens[i - 1];
+        _tokens[idx] = token;
+        _count++;
+        return true;
+    }
+
+    size_t size() const { return _count; }
+    bool empty() const { return _count == 0; }
+    bool truncated() const { return _truncated; }
+    std::string_view operator[](size_t idx) const { return idx < _count ? _tokens[idx] : std::string_view(); }
+    std::string_view at(size_t idx) const { return (*this)[idx]; }
+
+    /* Token `idx` up to the end of the split line, delimiters and tokens past
+     * TOKENS_MAX included; for names and scripts that contain spaces. */
+    std::string_view rest(size_t idx) const {
+        const std::string_view token = (*this)[idx];
+        if (token.data() < _line.data() || token.data() > _line.data() + _line.size()) return token;
+        return _line.substr(token.data() - _line.data());
+    }
+
+    /* Case-insensitive keyword match. */
+    bool is(size_t idx, std::string_view word) const {
+        const std::string_view token = (*this)[idx];
+        if (token.size() != word.size()) return false;
+        for (size_t i = 0; i < token.size(); ++i) {
+            if (lower(token[i]) != lower(word[i])) return false;
+        }
+        return true;
+    }
+
+    /* Whole token as an integer in `base`, range checked against T. */
+    template <typename T>
+    bool integer(size_t idx, T &out, int base = 10) const {
+        const std::string_view token = (*this)[idx];
+        T value{};
+        const auto res = std::from_chars(token.data(), token.data() + token.size(), value, base);
+        if (token.empty() || res.ec != std::errc() || res.ptr != token.data() + token.size()) return false;
+        out = value;
+        return true;
+    }
+
+    /* Six hex digits, either case, e.g. "b60d1a". */
+    bool hexAddress(size_t idx, uint8_t (&out)[3]) const {
+        const std::string_view token = (*this)[idx];
+        if (token.size() != 6) return false;
+        for (size_t i = 0; i < 3; ++i) {
+            const int hi = hexDigit(token[2 * i]);
+            const int lo = hexDigit(token[2 * i + 1]);
+            if (hi < 0 || lo < 0) return false;
+            out[i] = static_cast<uint8_t>((hi << 4) | lo);
+        }
+        return true;
+    }
+
+    /* Whole number 0-100. */
+    bool percent(size_t idx, uint8_t &out) const {
+        const std::string_view token = (*this)[idx];
+        unsigned value = 0;
+        const auto res = std::from_chars(token.data(), token.data() + token.size(), value);
+        if (token.empty() || res.ec != std::errc() || res.ptr != token.data() + token.size() || value > 100)
+            return false;
+        out = static_cast<uint8_t>(value);
+        return true;
+    }
+
+    /* Set-point in degrees, 7.0 to 28.0, or 0 to query the current value. */
+    bool temperature(size_t idx, float &out) const {
+        const std::string_view token = (*this)[idx];
+        char buf[12];
+        if (token.empty() || token.size() >= sizeof(buf)) return false;
+        token.copy(buf, token.size());
+        buf[token.size()] = '\0';
+        char *end;
+        const float value = strtof(buf, &end);
+        if (*end != '\0' || !(value == 0.0f || (value >= 7.0f && value <= 28.0f))) return false;
+        out = value;
+        return true;
+    }
+
+private:
+    static char lower(char c) { return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c; }
+
+    static int hexDigit(char c) {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    }
+
+    std::string_view _line;
+    std::string_view _tokens[TOKENS_MAX];
+    uint8_t _count = 0;
+    bool _truncated = false;
+};
 #endif
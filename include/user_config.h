@@ -38,6 +38,7 @@ inline std::string mqtt_user = "mosquitto";
 inline std::string mqtt_password = "";
 inline std::string mqtt_discovery_topic = "homeassistant";
 inline uint16_t mqtt_port = 1883;
+inline uint8_t mqtt_frame_sinks = 0x03;          // Received frame sinks (JSON and sensor), see frame_telemetry.h
 
 inline std::string github_release_owner = "rspaargaren";
 inline std::string github_release_repo = "iohomecontrol";
@@ -49,6 +50,8 @@ inline std::string syslog_server = ""; // Syslog server — defaults to syslog.s
 inline uint16_t syslog_port = 5144;    // Syslog server port
 inline std::string syslog_tag = "";    // Optional tag prepended to hostname for filtering
 
+//#define CMD_BENCHMARK               // Adds the tokBench console command (replaces global operator new)
+
 // Comment out the next line if no display is connected
 #define SSD1306_DISPLAY
 
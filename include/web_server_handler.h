@@ -6,16 +6,20 @@
 
 // Forward declaration if ESPAsyncWebServer is used
 class ESPAsyncWebServer;
+namespace IOHC { class iohcPacket; }
 
 #if defined(WEBSERVER)
 void setupWebServer();
 void loopWebServer(); // If any loop processing is needed for the web server
 void broadcastLog(const String &msg);
 void broadcastDevicePosition(const String &id, int position);
-void broadcastLastAddress(const String &addr);
+void broadcastLastAddress(const uint8_t *addr);
+/* Stream a received frame to /ws/frames clients whose filter matches. */
+void broadcastFrame(const IOHC::iohcPacket *iohc);
 #else
 inline void setupWebServer() {}
 inline void loopWebServer() {}
+inline void broadcastFrame(const IOHC::iohcPacket *) {}
 #endif
 
 #endif // WEB_SERVER_HANDLER_H
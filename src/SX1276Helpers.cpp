@@ -20,13 +20,15 @@
 #include <board-config.h>
 
 #if defined(RADIO_SX127X)
+#include <algorithm>
+#include <atomic>
+#include <cstring>
 #include <map>
 
 #if defined(ESP8266)
     #include <TickerUs.h>
 #elif defined(ESP32)
 #define CONFIG_DISABLE_HAL_LOCKS true
-#include <TickerUsESP32.h>
 #include <esp_task_wdt.h>
 #include <SPI.h>
 // #include <SPIeX.h>
@@ -46,19 +48,132 @@ namespace Radio {
         {250, {0x00, 0x01}} // 250KHz
     };
 
+    thread_local Device t_device = Device::Primary;
+    thread_local SpiPath t_path = SpiPath::Other;
+#if defined(DUAL_RADIO)
+    const uint8_t NSS_PINS[] = {RADIO_NSS, RADIO2_CS_PIN};
+    constexpr uint8_t DEVICE_COUNT = 2;
+#else
+    constexpr uint8_t DEVICE_COUNT = 1;
+#endif
+
+    // Register shadow, see SpiStats
+    constexpr uint8_t SHADOW_FIRST = REG_BITRATEMSB;
+    constexpr uint8_t SHADOW_LAST = REG_PLLHOP;
+    struct Shadow {
+        uint8_t value[SHADOW_LAST + 1];
+        bool valid[SHADOW_LAST + 1];
+    };
+    Shadow shadows[DEVICE_COUNT]{};
+    // Counted from the RX task, the timer task and command callers alike
+    struct SpiCounters {
+        std::atomic<uint32_t> transactions{0};
+        std::atomic<uint32_t> saved{0};
+    };
+    SpiCounters stats[static_cast<uint8_t>(SpiPath::Count)];
+
+    constexpr bool cacheable(uint8_t regAddr) {
+        if (regAddr < SHADOW_FIRST || regAddr > SHADOW_LAST) return false;
+        switch (regAddr) {
+            case REG_LNA:           // current gain when the AGC is on
+            case REG_RXCONFIG:      // self-clearing restart bits
+            case REG_RSSIVALUE:
+            case REG_AFCFEI:        // self-clearing AFC/AGC triggers
+            case REG_AFCMSB:
+            case REG_AFCLSB:
+            case REG_FEIMSB:
+            case REG_FEILSB:
+            case REG_OSC:           // RcCalStart
+            case REG_SEQCONFIG1:    // sequencer start/stop
+            case REG_IMAGECAL:      // running / temperature change flags
+            case REG_TEMP:
+            case REG_LOWBAT:
+            case REG_IRQFLAGS1:
+            case REG_IRQFLAGS2:
+                return false;
+            default:
+                return true;
+        }
+    }
+
+    inline Shadow &shadow() {
+        return shadows[static_cast<uint8_t>(t_device) % DEVICE_COUNT];
+    }
+
+    // Held from the shadow lookup to the end of the SPI access, so no other task can slip a write in
+    // between and leave the shadow disagreeing with the chip. SPIClass locks each transaction on its own,
+    // which keeps the bus sane but not the shadow. Recursive: a failed write check invalidates the shadow.
+    SemaphoreHandle_t shadowLocks[DEVICE_COUNT]{};
+
+    class ShadowLock {
+    public:
+        ShadowLock() : lock(shadowLocks[static_cast<uint8_t>(t_device) % DEVICE_COUNT]) {
+            if (lock) xSemaphoreTakeRecursive(lock, portMAX_DELAY);
+        }
+        ~ShadowLock() {
+            if (lock) xSemaphoreGiveRecursive(lock);
+        }
+    private:
+        SemaphoreHandle_t lock;
+    };
+
+    Device currentDevice() {
+        return t_device;
+    }
+
+    DeviceScope::DeviceScope(Device device, SpiPath path) : previous(t_device), previousPath(t_path) {
+        t_device = device;
+        t_path = path;
+    }
+
+    DeviceScope::~DeviceScope() {
+        t_device = previous;
+        t_path = previousPath;
+    }
+
+    SpiStats spiStats(SpiPath path) {
+        const SpiCounters &s = stats[static_cast<uint8_t>(path)];
+        return {s.transactions.load(), s.saved.load()};
+    }
+
+    void resetSpiStats() {
+        for (auto &s : stats) {
+            s.transactions = 0;
+            s.saved = 0;
+        }
+    }
+
+    void invalidateShadow() {
+        ShadowLock guard;
+        Shadow &sh = shadow();
+        std::fill(std::begin(sh.valid), std::end(sh.valid), false);
+    }
+
+/**
+ * The function `nssPin` returns the chip select of the device selected by the calling task.
+ */
+    inline uint8_t IRAM_ATTR nssPin() {
+#if defined(DUAL_RADIO)
+        return NSS_PINS[static_cast<uint8_t>(t_device)];
+#else
+        return RADIO_NSS;
+#endif
+    }
+
 /**
- * The function `SPI_beginTransaction` begins a SPI transaction and sets the RADIO_NSS pin to LOW.
+ * The function `SPI_beginTransaction` begins a SPI transaction and sets the NSS pin of the selected radio to LOW.
  */
     void IRAM_ATTR SPI_beginTransaction() {
+        stats[static_cast<uint8_t>(t_path)].transactions++;
         SPI.beginTransaction(Radio::SpiSettings);
-        digitalWrite(RADIO_NSS, LOW);
+        digitalWrite(nssPin(), LOW);
     }
 
 /**
- * The function `SPI_endTransaction` ends the SPI transaction and sets the RADIO_NSS pin to HIGH.
+ * The function `SPI_endTransaction` ends the SPI transaction and sets the NSS pin of the selected radio to HIGH.
  */
     void IRAM_ATTR SPI_endTransaction() {
-        digitalWrite(RADIO_NSS, HIGH);
+        digitalWrite(nssPin(), HIGH);
         SPI.endTransaction();
     }
 
@@ -68,6 +183,10 @@ namespace Radio {
  */
     void initHardware() {
         printf("\nSPI Init");
+        for (auto &lock : shadowLocks) {
+            if (!lock) lock = xSemaphoreCreateRecursiveMutex();
+        }
+        invalidateShadow();
 
         //gpio_pullup_en((gpio_num_t) RADIO_MISO);
 
@@ -93,7 +212,12 @@ namespace Radio {
         // SPI.setFrequency(SPI_CLK_FRQ);
         // SPI.setDataMode(SPI_MODE0);
         // SPI.setBitOrder(MSBFIRST);
+#if defined(DUAL_RADIO)
+        // Two devices on the bus: chip select is driven by software only
+        SPI.setHwCs(false);
+#else
         SPI.setHwCs(true);
+#endif
 
         // Disable SPI device
         // Disable device NRESET pin
@@ -113,6 +237,29 @@ namespace Radio {
         printf("\nRadio Chip is ready\n");
     }
 
+#if defined(DUAL_RADIO)
+/**
+ * The function `initSecondaryHardware` resets the second SX127x, sharing the SPI bus set up by
+ * `initHardware`, and puts it in standby mode.
+ */
+    void initSecondaryHardware() {
+        pinMode(RADIO2_CS_PIN, OUTPUT);
+        digitalWrite(RADIO2_CS_PIN, HIGH);
+#if defined(RADIO2_RST_PIN)
+        // Manual reset: NRESET low for more than 100 uS, then 5 mS before the chip is ready
+        pinMode(RADIO2_RST_PIN, OUTPUT);
+        digitalWrite(RADIO2_RST_PIN, LOW);
+        delayMicroseconds(200);
+        digitalWrite(RADIO2_RST_PIN, HIGH);
+        delay(6);
+#endif
+        DeviceScope secondary(Device::Secondary);
+        invalidateShadow();
+        writeByte(REG_OPMODE, RF_OPMODE_STANDBY);
+        printf("Secondary radio chip is ready\n");
+    }
+#endif
+
 void setPreambleLength(uint16_t preambleLen) {
     writeByte(REG_PREAMBLEMSB, (preambleLen >> 8) & 0xFF);
     writeByte(REG_PREAMBLELSB, preambleLen & 0xFF);
@@ -367,12 +514,32 @@ void setPreambleLength(uint16_t preambleLen) {
     }
 
     void IRAM_ATTR readBytes(uint8_t regAddr, uint8_t *out, uint8_t len) {
+        ShadowLock guard;
+        Shadow &sh = shadow();
+        bool cached = regAddr != REG_FIFO;
+        for (uint8_t idx = 0; idx < len && cached; ++idx)
+            cached = cacheable(regAddr + idx) && sh.valid[regAddr + idx];
+        if (cached) {
+            memcpy(out, &sh.value[regAddr], len);
+            stats[static_cast<uint8_t>(t_path)].saved++;
+            return;
+        }
+
         SPI_beginTransaction();
         SPI.transfer(regAddr); // Send Address
         for (uint8_t idx = 0; idx < len; ++idx) {
             out[idx] = SPI.transfer(regAddr); // Get data
         }
         SPI_endTransaction();
+
+        // Burst reads auto-increment, except on the FIFO
+        if (regAddr == REG_FIFO) return;
+        for (uint8_t idx = 0; idx < len; ++idx) {
+            if (cacheable(regAddr + idx)) {
+                sh.value[regAddr + idx] = out[idx];
+                sh.valid[regAddr + idx] = true;
+            }
+        }
     }
 
     bool IRAM_ATTR writeByte(uint8_t regAddr, uint8_t data, bool check) {
@@ -380,6 +547,24 @@ void setPreambleLength(uint16_t preambleLen) {
     }
 
     auto IRAM_ATTR writeBytes(uint8_t regAddr, uint8_t *in, uint8_t len, bool check) -> bool {
+        ShadowLock guard;
+        Shadow &sh = shadow();
+        bool unchanged = regAddr != REG_FIFO;
+        for (uint8_t idx = 0; idx < len && unchanged; ++idx)
+            unchanged = cacheable(regAddr + idx) && sh.valid[regAddr + idx] && sh.value[regAddr + idx] == in[idx];
+        if (unchanged) {
+            stats[static_cast<uint8_t>(t_path)].saved += check ? 2 : 1;
+            return true;
+        }
+        if (regAddr != REG_FIFO) {
+            for (uint8_t idx = 0; idx < len; ++idx) {
+                if (cacheable(regAddr + idx)) {
+                    sh.value[regAddr + idx] = in[idx];
+                    sh.valid[regAddr + idx] = true;
+                }
+            }
+        }
+
         SPI_beginTransaction();
         SPI.write(regAddr | SPI_Write); // Send Address with Write flag
         for (uint8_t idx = 0; idx < len; ++idx) {
@@ -394,6 +579,7 @@ void setPreambleLength(uint16_t preambleLen) {
                 uint8_t getByte = SPI.transfer(regAddr); // Get data
                 if (in[idx] != getByte) {
                     SPI_endTransaction();
+                    invalidateShadow();
                     return false;
                 }
             }
@@ -423,6 +609,17 @@ void setPreambleLength(uint16_t preambleLen) {
         return false;
     }
 
+    FrequencyRegs frequencyRegs(uint32_t frequency) {
+        /*uint32_t FRF = (newFreq * (uint32_t(1) << RADIOLIB_SX127X_DIV_EXPONENT)) / RADIOLIB_SX127X_CRYSTAL_FREQ;*/
+        const uint32_t frf = static_cast<uint32_t>((static_cast<uint64_t>(frequency) << 19) / FXOSC);
+        return {frequency, {static_cast<uint8_t>(frf >> 16), static_cast<uint8_t>(frf >> 8), static_cast<uint8_t>(frf)}};
+    }
+
+    void IRAM_ATTR setFrequency(const FrequencyRegs &regs) {
+        uint8_t out[3] = {regs.frf[0], regs.frf[1], regs.frf[2]};
+        writeBytes(REG_FRFMSB, out, 3); // If Radio is active writing LSB triggers frequency change
+    }
+
     bool IRAM_ATTR setCarrier(Carrier param, uint32_t value) {
         uint32_t tmpVal;
         uint8_t out[4];
@@ -435,12 +632,7 @@ void setPreambleLength(uint16_t preambleLen) {
 
         switch (param) {
             case Carrier::Frequency:
-                /*uint32_t FRF = (newFreq * (uint32_t(1) << RADIOLIB_SX127X_DIV_EXPONENT)) / RADIOLIB_SX127X_CRYSTAL_FREQ;*/
-                tmpVal = static_cast<uint32_t>((static_cast<float_t>(value) / FXOSC) * (1 << 19));
-                out[0] = (tmpVal & 0x00ff0000) >> 16;
-                out[1] = (tmpVal & 0x0000ff00) >> 8;
-                out[2] = (tmpVal & 0x000000ff); // If Radio is active writing LSB triggers frequency change
-                writeBytes(REG_FRFMSB, out, 3);
+                setFrequency(frequencyRegs(value));
                 break;
             case Carrier::Bandwidth:
                 bw = bwRegs(value);
@@ -494,6 +686,7 @@ void setPreambleLength(uint16_t preambleLen) {
 
     void dump() {
         uint8_t idx = 0;
+        invalidateShadow(); // show the chip, not the shadow
 
         Serial.printf("#Type\tRegister Name\tAddress[Hex]\tValue[Hex]\n");
         do {
@@ -0,0 +1,98 @@
+#include <interact.h>
+
+#if defined(CMD_BENCHMARK)
+
+#include <Arduino.h>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <sstream>
+
+/* Benchmark for the command path, from the received line to the handler
+ * call. Only built with CMD_BENCHMARK, since counting allocations needs a
+ * replacement for the global operator new. */
+
+namespace {
+
+std::atomic<bool> s_counting{false};
+std::atomic<uint32_t> s_allocs{0};
+
+constexpr uint16_t ITERATIONS = 500;
+constexpr char DEFAULT_ARGS[] = "50 Living room blind";
+// Handler the timed lines are dispatched to, so nothing is sent on air
+constexpr char NOP_COMMAND[] = "benchNop";
+
+// Tokenizers as they were before TokenView, kept here as the reference
+void legacyTokenize(std::string const &str, const char delim, Tokens &out) {
+  std::stringstream ss(str);
+  std::string s;
+  while (std::getline(ss, s, delim)) {
+    out.push_back(s);
+  }
+}
+
+void vectorTokenize(std::string_view str, const char delim, Tokens &out) {
+  size_t count = 0;
+  splitTokens(str, delim, [&count](std::string_view) { ++count; });
+  out.reserve(out.size() + count);
+  splitTokens(str, delim, [&out](std::string_view token) { out.emplace_back(token); });
+}
+
+// Handler call of the reference rows, through a pointer like the table's
+void nopTokens(Tokens *) {}
+void (*volatile s_legacyHandler)(Tokens *) = nopTokens;
+
+template <typename F>
+void measure(const char *label, F &&body) {
+  s_allocs = 0;
+  s_counting = true;
+  const uint32_t started = micros();
+  for (uint16_t i = 0; i < ITERATIONS; ++i) body();
+  const uint32_t elapsed = micros() - started;
+  s_counting = false;
+  Serial.printf("  %-24s %6.2f allocs/cmd %7.2f us/cmd\n", label,
+                static_cast<float>(s_allocs) / ITERATIONS, static_cast<float>(elapsed) / ITERATIONS);
+}
+
+} // namespace
+
+void *operator new(size_t size) {
+  if (s_counting.load(std::memory_order_relaxed)) s_allocs.fetch_add(1, std::memory_order_relaxed);
+  void *p = malloc(size ? size : 1);
+  if (!p) abort();
+  return p;
+}
+void *operator new[](size_t size) { return operator new(size); }
+void operator delete(void *p) noexcept { free(p); }
+void operator delete[](void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+void operator delete[](void *p, size_t) noexcept { free(p); }
+
+namespace Cmd {
+
+void registerCmdBenchmark() {
+  addHandler((char *) NOP_COMMAND, (char *) "Does nothing, dispatch target of tokBench", [](const TokenView *cmd)-> void {});
+  addHandler((char *) "tokBench", (char *) "Command dispatch allocations and time [args]", [](const TokenView *cmd)-> void {
+    // Time the given arguments, or those of a typical 1W command, on the no-op command
+    const std::string line = std::string(NOP_COMMAND) + ' ' +
+                             std::string(cmd->size() > 1 ? cmd->rest(1) : std::string_view(DEFAULT_ARGS));
+    const char *raw = line.c_str();
+
+    Serial.printf("Dispatching \"%s\" %u times (other tasks may add noise)\n", raw, ITERATIONS);
+    measure("stringstream (legacy)", [raw] {
+      Tokens t;
+      legacyTokenize(raw, ' ', t);
+      if (findHandler(t[0].data(), t[0].size())) s_legacyHandler(&t);
+    });
+    measure("vector<string>", [raw] {
+      Tokens t;
+      vectorTokenize(raw, ' ', t);
+      if (findHandler(t[0].data(), t[0].size())) s_legacyHandler(&t);
+    });
+    measure("Cmd::dispatch", [raw] { dispatch(TokenView(raw)); });
+  });
+}
+
+}
+
+#endif // CMD_BENCHMARK
@@ -0,0 +1,456 @@
+#include <cover_state_bus.h>
+
+#include <Arduino.h>
+
+#include <user_config.h>
+#include <iohcCryptoHelpers.h>
+#include <oled_display.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(MQTT)
+#include <mqtt_handler.h>
+#endif
+#if defined(WEBSERVER)
+#include <web_server_handler.h>
+#endif
+
+extern "C" {
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+}
+
+namespace {
+
+constexpr uint8_t SINK_COUNT = static_cast<uint8_t>(CoverSink::Count);
+constexpr uint8_t MAX_BATCH = 16;
+constexpr int16_t NO_POSITION = -1;
+
+// Default per-sink budgets in updates per second. The burst size equals the
+// rate, so a full second worth of updates can go out back to back.
+constexpr uint16_t DEFAULT_SINK_RATES[SINK_COUNT] = {20, 10, 4};
+constexpr const char *SINK_NAMES[SINK_COUNT] = {"mqtt", "websocket", "oled"};
+
+struct Slot {
+  bool used = false;
+  uint8_t node[3]{};
+  char id[7]{};
+  char name[32]{};
+  CoverState state = CoverState::Unknown;
+  float position = 0.0f;
+  uint32_t windowStartMs = 0;
+  uint32_t lastPostMs = 0;
+  uint8_t pending = 0; // one bit per sink
+  uint8_t deferred = 0; // one bit per sink: pending update already counted as deferred
+  // Last value handed to each sink, only touched by the bus task.
+  CoverState sentState[SINK_COUNT]{};
+  int16_t sentPosition[SINK_COUNT]{NO_POSITION, NO_POSITION, NO_POSITION};
+};
+
+struct SinkState {
+  CoverSinkStats stats{};
+  float tokens = 0.0f;
+  uint32_t lastRefillMs = 0;
+};
+
+struct Delivery {
+  CoverSink sink;
+  uint8_t slot;
+  uint8_t node[3];
+  char id[7];
+  char name[32];
+  CoverState state;
+  float position;
+  bool stateChanged;
+  bool positionChanged;
+};
+
+SemaphoreHandle_t s_busMutex = nullptr;
+TaskHandle_t s_busTask = nullptr;
+Slot s_slots[COVER_STATE_MAX_DEVICES];
+SinkState s_sinks[SINK_COUNT];
+uint16_t s_windowMs = COVER_STATE_WINDOW_MS;
+uint32_t s_posted = 0;
+uint32_t s_direct = 0;
+uint32_t s_evicted = 0;
+uint32_t s_flushes = 0;
+
+void lock() { xSemaphoreTake(s_busMutex, portMAX_DELAY); }
+void unlock() { xSemaphoreGive(s_busMutex); }
+
+// A full table reuses the slot idle for the longest time; a slot with updates still pending is never
+// taken. Eviction only costs the record of what was sent, so the next update goes out unconditionally.
+Slot *findSlotLocked(const uint8_t *node, bool create) {
+  Slot *freeSlot = nullptr;
+  Slot *idleSlot = nullptr;
+  const uint32_t now = millis();
+  for (auto &slot : s_slots) {
+    if (slot.used) {
+      if (memcmp(slot.node, node, sizeof(slot.node)) == 0) {
+        return &slot;
+      }
+      if (!slot.pending && (!idleSlot || now - slot.lastPostMs > now - idleSlot->lastPostMs)) {
+        idleSlot = &slot;
+      }
+    } else if (!freeSlot) {
+      freeSlot = &slot;
+    }
+  }
+  if (!create) {
+    return nullptr;
+  }
+  if (!freeSlot) {
+    if (!idleSlot) {
+      return nullptr;
+    }
+    freeSlot = idleSlot;
+    s_evicted++;
+  }
+  *freeSlot = Slot{};
+  freeSlot->used = true;
+  memcpy(freeSlot->node, node, sizeof(freeSlot->node));
+  snprintf(freeSlot->id, sizeof(freeSlot->id), "%s",
+           bytesToHexString(node, sizeof(freeSlot->node)).c_str());
+  return freeSlot;
+}
+
+void refillLocked(uint32_t now) {
+  for (auto &sink : s_sinks) {
+    const uint32_t elapsed = now - sink.lastRefillMs;
+    sink.lastRefillMs = now;
+    sink.tokens = std::min<float>(sink.stats.ratePerSec,
+                                  sink.tokens + elapsed * sink.stats.ratePerSec / 1000.0f);
+  }
+}
+
+// Pick the due updates that the sinks still have budget for. Returns the
+// number of milliseconds until the next flush is needed.
+uint32_t collectLocked(uint32_t now, Delivery *batch, uint8_t &count) {
+  uint32_t nextDueMs = portMAX_DELAY;
+  count = 0;
+  refillLocked(now);
+
+  for (uint8_t idx = 0; idx < COVER_STATE_MAX_DEVICES; ++idx) {
+    Slot &slot = s_slots[idx];
+    if (!slot.used || !slot.pending) {
+      continue;
+    }
+    const uint32_t age = now - slot.windowStartMs;
+    if (age < s_windowMs) {
+      nextDueMs = std::min<uint32_t>(nextDueMs, s_windowMs - age);
+      continue;
+    }
+    for (uint8_t s = 0; s < SINK_COUNT; ++s) {
+      if (!(slot.pending & (1u << s))) {
+        continue;
+      }
+      SinkState &sink = s_sinks[s];
+      if (count >= MAX_BATCH) {
+        return 0;
+      }
+      if (sink.tokens < 1.0f) {
+        if (!(slot.deferred & (1u << s))) {
+          slot.deferred |= 1u << s;
+          sink.stats.deferred++;
+        }
+        const uint32_t waitMs = sink.stats.ratePerSec
+                                    ? static_cast<uint32_t>((1.0f - sink.tokens) * 1000.0f / sink.stats.ratePerSec) + 1
+                                    : 1000;
+        nextDueMs = std::min(nextDueMs, waitMs);
+        continue;
+      }
+      slot.pending &= ~(1u << s);
+      slot.deferred &= ~(1u << s);
+
+      const int16_t rounded = static_cast<int16_t>(lroundf(slot.position));
+      const bool stateChanged = slot.state != CoverState::Unknown && slot.state != slot.sentState[s];
+      const bool positionChanged = rounded != slot.sentPosition[s];
+      if (!stateChanged && !positionChanged) {
+        sink.stats.merged++;
+        continue;
+      }
+      sink.tokens -= 1.0f;
+      if (stateChanged) slot.sentState[s] = slot.state;
+      slot.sentPosition[s] = rounded;
+
+      Delivery &d = batch[count++];
+      d.sink = static_cast<CoverSink>(s);
+      d.slot = idx;
+      memcpy(d.node, slot.node, sizeof(d.node));
+      memcpy(d.id, slot.id, sizeof(d.id));
+      memcpy(d.name, slot.name, sizeof(d.name));
+      d.state = slot.state;
+      d.position = slot.position;
+      d.stateChanged = stateChanged;
+      d.positionChanged = positionChanged;
+    }
+  }
+  return nextDueMs;
+}
+
+bool deliver(const Delivery &d) {
+  switch (d.sink) {
+    case CoverSink::Mqtt: {
+      bool ok = true;
+#if defined(MQTT)
+      // Queued by the MQTT outbox while the broker is unreachable
+      if (d.stateChanged) {
+        ok = publishCoverState(d.node, coverStateToString(d.state));
+      }
+      if (d.positionChanged) {
+        ok = publishCoverPosition(d.node, d.position) && ok;
+      }
+#endif
+      return ok;
+    }
+    case CoverSink::WebSocket:
+#if defined(WEBSERVER)
+      if (d.positionChanged) {
+        broadcastDevicePosition(d.id, static_cast<int>(lroundf(d.position)));
+      }
+#endif
+      return true;
+    case CoverSink::Oled:
+      if (d.positionChanged) {
+        display1WPosition(d.node, d.position, d.name);
+      }
+      return true;
+    default:
+      return false;
+  }
+}
+
+void deliverDirect(const uint8_t *node, const char *name, CoverState state, float position) {
+  Delivery d{};
+  memcpy(d.node, node, sizeof(d.node));
+  snprintf(d.id, sizeof(d.id), "%s", bytesToHexString(node, sizeof(d.node)).c_str());
+  snprintf(d.name, sizeof(d.name), "%s", name ? name : "");
+  d.state = state;
+  d.position = position;
+  d.stateChanged = state != CoverState::Unknown;
+  d.positionChanged = true;
+  for (uint8_t s = 0; s < SINK_COUNT; ++s) {
+    d.sink = static_cast<CoverSink>(s);
+    deliver(d);
+  }
+}
+
+void coverStateBusTask(void *) {
+  Delivery batch[MAX_BATCH];
+  uint32_t waitMs = portMAX_DELAY;
+
+  while (true) {
+    ulTaskNotifyTake(pdTRUE, waitMs == portMAX_DELAY ? portMAX_DELAY : pdMS_TO_TICKS(waitMs));
+
+    uint8_t count = 0;
+    lock();
+    waitMs = collectLocked(millis(), batch, count);
+    if (count) {
+      s_flushes++;
+    }
+    unlock();
+
+    for (uint8_t i = 0; i < count; ++i) {
+      const Delivery &d = batch[i];
+      const bool ok = deliver(d);
+      const uint8_t s = static_cast<uint8_t>(d.sink);
+      lock();
+      if (ok) {
+        s_sinks[s].stats.delivered++;
+      } else {
+        s_sinks[s].stats.dropped++;
+        // Forget what was sent so the next post reaches the sink again.
+        Slot &slot = s_slots[d.slot];
+        if (slot.used && memcmp(slot.node, d.node, sizeof(slot.node)) == 0) {
+          slot.sentState[s] = CoverState::Unknown;
+          slot.sentPosition[s] = NO_POSITION;
+        }
+      }
+      unlock();
+    }
+  }
+}
+
+} // namespace
+
+const char *coverStateToString(CoverState state) {
+  switch (state) {
+    case CoverState::Opening: return "OPENING";
+    case CoverState::Closing: return "CLOSING";
+    case CoverState::Stop: return "STOP";
+    case CoverState::Open: return "OPEN";
+    case CoverState::Close: return "CLOSE";
+    default: return "UNKNOWN";
+  }
+}
+
+void initCoverStateBus() {
+  if (s_busTask) {
+    return;
+  }
+
+  s_busMutex = xSemaphoreCreateMutex();
+  if (!s_busMutex) {
+    Serial.println("Failed to create cover state bus mutex");
+    return;
+  }
+
+  const uint32_t now = millis();
+  for (uint8_t s = 0; s < SINK_COUNT; ++s) {
+    s_sinks[s].stats.name = SINK_NAMES[s];
+    s_sinks[s].stats.ratePerSec = DEFAULT_SINK_RATES[s];
+    s_sinks[s].tokens = DEFAULT_SINK_RATES[s];
+    s_sinks[s].lastRefillMs = now;
+  }
+
+  if (xTaskCreatePinnedToCore(coverStateBusTask, "coverStateBus", 4096, nullptr, 2,
+                              &s_busTask, 1) != pdPASS) {
+    Serial.println("Failed to create cover state bus task");
+    vSemaphoreDelete(s_busMutex);
+    s_busMutex = nullptr;
+    s_busTask = nullptr;
+  }
+}
+
+void postCoverState(const uint8_t *node, const char *name, CoverState state, float position) {
+  if (!s_busMutex) {
+    return;
+  }
+
+  bool wake = false;
+  lock();
+  s_posted++;
+  Slot *slot = findSlotLocked(node, true);
+  if (!slot) {
+    // Every slot waits for a flush: hand this one to the sinks from the caller, uncoalesced
+    s_direct++;
+    unlock();
+    deliverDirect(node, name, state, position);
+    return;
+  }
+  if (name) {
+    strncpy(slot->name, name, sizeof(slot->name) - 1);
+    slot->name[sizeof(slot->name) - 1] = '\0';
+  }
+  if (state != CoverState::Unknown) {
+    slot->state = state;
+  }
+  slot->position = position;
+  slot->lastPostMs = millis();
+  for (uint8_t s = 0; s < SINK_COUNT; ++s) {
+    if (slot->pending & (1u << s)) {
+      s_sinks[s].stats.merged++;
+    }
+  }
+  if (!slot->pending) {
+    slot->windowStartMs = millis();
+    wake = true;
+  }
+  slot->pending = (1u << SINK_COUNT) - 1;
+  unlock();
+
+  if (wake && s_busTask) {
+    xTaskNotifyGive(s_busTask);
+  }
+}
+
+void forgetCoverState(const uint8_t *node) {
+  if (!s_busMutex) {
+    return;
+  }
+  lock();
+  if (Slot *slot = findSlotLocked(node, false)) {
+    slot->used = false;
+    slot->pending = 0;
+    slot->deferred = 0;
+  }
+  unlock();
+}
+
+void setCoverStateWindow(uint16_t windowMs) {
+  if (!s_busMutex) {
+    s_windowMs = windowMs;
+    return;
+  }
+  lock();
+  s_windowMs = windowMs;
+  unlock();
+}
+
+void setCoverSinkRate(CoverSink sink, uint16_t ratePerSec) {
+  const uint8_t s = static_cast<uint8_t>(sink);
+  if (s >= SINK_COUNT || !s_busMutex) {
+    return;
+  }
+  lock();
+  s_sinks[s].stats.ratePerSec = std::max<uint16_t>(1, ratePerSec);
+  s_sinks[s].tokens = std::min<float>(s_sinks[s].tokens, s_sinks[s].stats.ratePerSec);
+  unlock();
+}
+
+bool parseCoverSink(const char *name, CoverSink &sink) {
+  for (uint8_t s = 0; s < SINK_COUNT; ++s) {
+    if (strcasecmp(name, SINK_NAMES[s]) == 0) {
+      sink = static_cast<CoverSink>(s);
+      return true;
+    }
+  }
+  return false;
+}
+
+CoverStateBusStats getCoverStateBusStats() {
+  CoverStateBusStats stats{};
+  if (!s_busMutex) {
+    stats.windowMs = s_windowMs;
+    return stats;
+  }
+  lock();
+  stats.posted = s_posted;
+  stats.direct = s_direct;
+  stats.evicted = s_evicted;
+  stats.flushes = s_flushes;
+  stats.windowMs = s_windowMs;
+  for (const auto &slot : s_slots) {
+    if (slot.used) stats.devices++;
+  }
+  for (uint8_t s = 0; s < SINK_COUNT; ++s) {
+    stats.sinks[s] = s_sinks[s].stats;
+  }
+  unlock();
+  return stats;
+}
+
+void resetCoverStateBusStats() {
+  if (!s_busMutex) {
+    return;
+  }
+  lock();
+  s_posted = s_direct = s_evicted = s_flushes = 0;
+  for (auto &sink : s_sinks) {
+    sink.stats.delivered = sink.stats.merged = sink.stats.deferred = sink.stats.dropped = 0;
+  }
+  unlock();
+}
+
+void appendCoverStateBusStats(JsonObject &root) {
+  const CoverStateBusStats stats = getCoverStateBusStats();
+  JsonObject bus = root["cover_bus"].to<JsonObject>();
+  bus["window_ms"] = stats.windowMs;
+  bus["devices"] = stats.devices;
+  bus["posted"] = stats.posted;
+  bus["direct"] = stats.direct;
+  bus["evicted"] = stats.evicted;
+  bus["flushes"] = stats.flushes;
+  JsonObject sinks = bus["sinks"].to<JsonObject>();
+  for (const auto &sink : stats.sinks) {
+    JsonObject s = sinks[sink.name ? sink.name : "?"].to<JsonObject>();
+    s["rate"] = sink.ratePerSec;
+    s["delivered"] = sink.delivered;
+    s["merged"] = sink.merged;
+    s["deferred"] = sink.deferred;
+    s["dropped"] = sink.dropped;
+  }
+}
@@ -48,34 +48,43 @@ bool Line::isValid() {
 }
 
 void Line::update(const std::string &pRightText) {
-    rightText = pRightText;
+    if (rightText != pRightText) {
+        rightText = pRightText;
+        renderedWidth = -1;
+    }
     ticker.reset();
 }
 
-std::string Line::getKey() const {
+const std::string &Line::getKey() const {
     return leftText;
 }
 
-std::string Line::get(const int width) {
+const std::string &Line::get(const int width) {
     const auto elipses = "..";
     const auto leftLen = static_cast<int>(leftText.length());
     const auto rightLen = static_cast<int>(rightText.length());
     const auto maxLeftLen = std::max(0, width - rightLen - 1); // count one character for space between left and right
 
+    // The scroller has to tick every call, even when the cached text is reused
     const auto window = scroller.getWindow(leftLen, maxLeftLen);
+    if (window.start == renderedStart && width == renderedWidth) {
+        return rendered;
+    }
 
-    const std::string addition = leftLen > window.end ? elipses : "";
-    const auto text = leftText.substr(window.start, window.cnt - addition.length());
-
-    const std::string fillText(width - window.cnt - rightLen, ' ');
-
-    return text + addition + fillText + rightText;
+    const size_t additionLen = leftLen > window.end ? 2 : 0;
+    rendered.assign(leftText, window.start, window.cnt - additionLen);
+    if (additionLen) rendered += elipses;
+    rendered.append(std::max(0, width - window.cnt - rightLen), ' ');
+    rendered += rightText;
+    renderedStart = window.start;
+    renderedWidth = width;
+    return rendered;
 }
 
 DisplayBuffer::DisplayBuffer(): scroller(40, 20) {
 }
 
-Line* DisplayBuffer::find(const std::string key) {
+Line* DisplayBuffer::find(const std::string &key) {
     for(auto &line: lines) {
         if (line.getKey() == key) {
             return &line;
@@ -94,33 +103,37 @@ void DisplayBuffer::addLine(const std::string &leftText, const std::string &righ
 }
 
 void DisplayBuffer::purge() {
-    std::vector<Line> newLines;
-    for(auto &line: lines) {
-        if (line.isValid()) {
-            newLines.push_back(line);
-        }
-    }
-    lines.clear();
-    lines = newLines;
+    lines.erase(std::remove_if(lines.begin(), lines.end(), [](Line &line) { return !line.isValid(); }),
+                lines.end());
 }
 
 void DisplayBuffer::clear() {
     lines.clear();
 }
 
-std::vector<std::string> DisplayBuffer::getTextToDisplay(const int width, const int height) {
+bool DisplayBuffer::getTextToDisplay(const int width, const int height, std::vector<std::string> &out) {
     purge();
 
     const auto lineCnt = lines.size();
     const auto window = scroller.getWindow(lineCnt, height - 1);
-
-    std::vector<std::string> toDisplay;
+    const size_t count = window.cnt + (window.cnt < lineCnt ? 1 : 0);
+
+    bool changed = out.size() != count;
+    out.resize(count);
+    size_t idx = 0;
+    auto set = [&](const std::string &text) {
+        if (out[idx] != text) {
+            out[idx] = text;
+            changed = true;
+        }
+        ++idx;
+    };
     for(int i=window.start; i<window.end; i++) {
-        toDisplay.push_back(lines.at(i).get(width));
+        set(lines.at(i).get(width));
     }
     if (window.cnt < lineCnt) {
-        Line line("", std::string(".. +") + std::to_string(lineCnt - window.cnt) + " lines");
-        toDisplay.push_back(line.get(width));
+        const std::string more = ".. +" + std::to_string(lineCnt - window.cnt) + " lines";
+        set(std::string(std::max(0, width - static_cast<int>(more.length())), ' ') + more);
     }
-    return toDisplay;
+    return changed;
 }
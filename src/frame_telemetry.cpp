@@ -0,0 +1,208 @@
+#include <frame_telemetry.h>
+
+#if defined(MQTT)
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+#include <iohcCryptoHelpers.h>
+#include <iohcRemoteMap.h>
+#include <mqtt_outbox.h>
+#include <nvs_helpers.h>
+#include <utils.h>
+
+#include <cmath>
+#include <cstring>
+#include <sstream>
+
+namespace {
+
+constexpr struct {
+  const char *name;
+  uint8_t flag;
+} SINK_NAMES[] = {
+  {"json", FRAME_SINK_JSON},
+  {"sensor", FRAME_SINK_SENSOR},
+  {"cbor", FRAME_SINK_CBOR},
+};
+
+// Minimal CBOR (RFC 8949) writer for the handful of types a frame needs.
+class CborWriter {
+public:
+  CborWriter(uint8_t *buf, size_t cap) : _buf(buf), _cap(cap) {}
+
+  void map(size_t entries) { head(5, entries); }
+  void uint(uint64_t value) { head(0, value); }
+  void sint(int64_t value) {
+    if (value < 0) head(1, static_cast<uint64_t>(-1 - value));
+    else head(0, static_cast<uint64_t>(value));
+  }
+  void bytes(const uint8_t *data, size_t len) {
+    head(2, len);
+    raw(data, len);
+  }
+  void text(const char *str) {
+    const size_t len = strlen(str);
+    head(3, len);
+    raw(reinterpret_cast<const uint8_t *>(str), len);
+  }
+
+  size_t size() const { return _overflow ? 0 : _len; }
+
+private:
+  void head(uint8_t major, uint64_t value) {
+    major <<= 5;
+    if (value < 24) {
+      put(major | value);
+    } else if (value <= 0xFF) {
+      put(major | 24);
+      put(value);
+    } else if (value <= 0xFFFF) {
+      put(major | 25);
+      for (int shift = 8; shift >= 0; shift -= 8) put(value >> shift);
+    } else if (value <= 0xFFFFFFFF) {
+      put(major | 26);
+      for (int shift = 24; shift >= 0; shift -= 8) put(value >> shift);
+    } else {
+      put(major | 27);
+      for (int shift = 56; shift >= 0; shift -= 8) put(value >> shift);
+    }
+  }
+  void put(uint8_t b) {
+    if (_len < _cap) _buf[_len++] = b;
+    else _overflow = true;
+  }
+  void raw(const uint8_t *data, size_t len) {
+    for (size_t i = 0; i < len; ++i) put(data[i]);
+  }
+
+  uint8_t *_buf;
+  size_t _cap;
+  size_t _len = 0;
+  bool _overflow = false;
+};
+
+// Action name of a 1W command frame, nullptr for anything else.
+const char *oneWayAction(const IOHC::iohcPacket *iohc) {
+  if (iohc->payload.packet.header.CtrlByte1.asStruct.Protocol != 1 ||
+      iohc->payload.packet.header.cmd != 0x00) {
+    return nullptr;
+  }
+  const uint16_t main = (iohc->payload.packet.msg.p0x00_14.main[0] << 8) |
+                        iohc->payload.packet.msg.p0x00_14.main[1];
+  switch (main) {
+    case 0x0000: return "open";
+    case 0xC800: return "close";
+    case 0xD200: return "stop";
+    case 0xD803: return "vent";
+    case 0x6400: return "force";
+    default: return "unknown";
+  }
+}
+
+void publishJson(const IOHC::iohcPacket *iohc, const char *action) {
+  JsonDocument doc;
+
+  doc["type"] = action ? "1W" : "Cozy";
+  doc["from"] = bytesToHexString(iohc->payload.packet.header.target, 3);
+  doc["to"] = bytesToHexString(iohc->payload.packet.header.source, 3);
+  doc["cmd"] = to_hex_str(iohc->payload.packet.header.cmd).c_str();
+  doc["_data"] = bytesToHexString(iohc->payload.buffer + 9, iohc->buffer_length - 9);
+  if (const auto *map = IOHC::iohcRemoteMap::getInstance()->find(iohc->payload.packet.header.source)) {
+    doc["remote"] = map->name;
+  }
+  if (action) {
+    doc["action"] = action;
+  }
+
+  std::string message;
+  size_t messageSize = serializeJson(doc, message);
+  if (mqtt_frame_sinks & FRAME_SINK_JSON) {
+    outboxPublish("iown/Frame", message.c_str(), messageSize, 1, false, OutboxPolicy::Fifo);
+  }
+  if (mqtt_frame_sinks & FRAME_SINK_SENSOR) {
+    outboxPublish((mqtt_discovery_topic + "/sensor/iohc_frame/state").c_str(), message.c_str(), messageSize, 0,
+                  false, OutboxPolicy::LastValue);
+  }
+}
+
+void publishCbor(const IOHC::iohcPacket *iohc, const char *action) {
+  uint8_t buf[sizeof(iohc->payload.buffer) + 48];
+  CborWriter cbor(buf, sizeof(buf));
+  cbor.map(action ? 5 : 4);
+  cbor.uint(0);
+  cbor.bytes(iohc->payload.buffer, iohc->buffer_length);
+  cbor.uint(1);
+  cbor.sint(lroundf(iohc->rssi));
+  cbor.uint(2);
+  cbor.uint(iohc->frequency);
+  cbor.uint(3);
+  cbor.uint(millis());
+  if (action) {
+    cbor.uint(4);
+    cbor.text(action);
+  }
+  if (const size_t len = cbor.size()) {
+    outboxPublish(FRAME_CBOR_TOPIC, reinterpret_cast<const char *>(buf), len, 0, false, OutboxPolicy::Fifo);
+  }
+}
+
+} // namespace
+
+void loadFrameSinks() {
+  uint16_t stored;
+  if (nvs_read_u16(NVS_KEY_MQTT_FRAME_SINKS, stored)) {
+    mqtt_frame_sinks = static_cast<uint8_t>(stored);
+  }
+}
+
+void setFrameSinks(uint8_t sinks) {
+  mqtt_frame_sinks = sinks;
+  nvs_write_u16(NVS_KEY_MQTT_FRAME_SINKS, sinks);
+}
+
+bool parseFrameSinks(const std::string &list, uint8_t &sinks) {
+  sinks = 0;
+  if (list == "none") {
+    return true;
+  }
+  std::stringstream ss(list);
+  std::string item;
+  while (std::getline(ss, item, ',')) {
+    bool known = false;
+    for (const auto &sink : SINK_NAMES) {
+      if (item == sink.name) {
+        sinks |= sink.flag;
+        known = true;
+      }
+    }
+    if (!known) {
+      return false;
+    }
+  }
+  return true;
+}
+
+std::string frameSinksToString(uint8_t sinks) {
+  std::string out;
+  for (const auto &sink : SINK_NAMES) {
+    if (sinks & sink.flag) {
+      if (!out.empty()) out += ",";
+      out += sink.name;
+    }
+  }
+  return out.empty() ? "none" : out;
+}
+
+void publishFrameTelemetry(const IOHC::iohcPacket *iohc) {
+  const char *action = oneWayAction(iohc);
+  // JSON is only built when one of its sinks is enabled
+  if (mqtt_frame_sinks & (FRAME_SINK_JSON | FRAME_SINK_SENSOR)) {
+    publishJson(iohc, action);
+  }
+  if (mqtt_frame_sinks & FRAME_SINK_CBOR) {
+    publishCbor(iohc, action);
+  }
+}
+
+#endif // MQTT
@@ -23,167 +23,165 @@
 #include <wifi_helper.h>
 #include <oled_display.h>
 #include <iohcCryptoHelpers.h>
+#include <cover_state_bus.h>
+#include <script_runner.h>
+#include <logger.h>
+#include <latency_metrics.h>
 #include <algorithm>
 #include <cstdlib>
+#include <freertos/semphr.h>
 #if defined(MQTT)
 #include <mqtt_handler.h>
+#include <frame_telemetry.h>
 #endif
 #include <nvs_helpers.h>
 
 ConnState mqttStatus = ConnState::Disconnected;
 
-_cmdEntry* _cmdHandler[MAXCMDS];
-uint8_t lastEntry = 0;
-
-
-void tokenize(std::string const &str, const char delim, Tokens &out) {
-  std::stringstream ss(str);
-  std::string s;
-  while (std::getline(ss, s, delim)) {
-    out.push_back(s);
-  }
-}
-
 
 namespace Cmd {
 bool verbosity = true;
 bool pairMode = false;
 bool scanMode = false;
-#if defined(ESP32)
-TimersUS::TickerUsESP32 kbd_tick;
-#endif
-TimerHandle_t consoleTimer;
 
-static char _rxbuffer[512];
-static uint8_t _len = 0;
-static uint8_t _avail = 0;
+// Console line reader. The UART receive callback wakes the console task,
+// which edits the line in place and runs it as soon as Enter arrives.
+static constexpr size_t CONSOLE_LINE_MAX = 255;
+static constexpr uint32_t CONSOLE_IDLE_POLL_MS = 1000; // fallback if an RX event is missed
+static TaskHandle_t _consoleTask = nullptr;
+static char _line[CONSOLE_LINE_MAX + 1];
+static size_t _lineLen = 0;
+static uint8_t _escape = 0; // bytes left of an ANSI escape sequence to swallow
+static bool _lastWasCR = false;
+// Console, web, MQTT and scripts run commands from their own tasks; handlers touch the remotes
+// and the radio send queue, so one command runs at a time. Recursive: a handler may dispatch.
+static SemaphoreHandle_t _cmdMutex = nullptr;
 /**
  * The function `createCommands()` initializes and adds various command handlers for controlling
  * different devices and functionalities.
  */
 void createCommands() {
+    if (!_cmdMutex)
+        _cmdMutex = xSemaphoreCreateRecursiveMutex();
     // Atlantic 2W
-    Cmd::addHandler((char *) "powerOn", (char *) "Permit to retrieve paired devices", [](Tokens *cmd)-> void {
-        IOHC::iohcCozyDevice2W::getInstance()->cmd(IOHC::DeviceButton::powerOn, nullptr);
-    });
-    Cmd::addHandler((char *) "setTemp", (char *) "7.0 to 28.0 - 0 get actual temp", [](Tokens *cmd)-> void {
-        IOHC::iohcCozyDevice2W::getInstance()->cmd(IOHC::DeviceButton::setTemp, cmd /*cmd->at(1).c_str()*/);
-    });
-    Cmd::addHandler((char *) "setMode", (char *) "auto prog manual off - FF to get actual mode",
-                    [](Tokens *cmd)-> void {
-                        IOHC::iohcCozyDevice2W::getInstance()->cmd(IOHC::DeviceButton::setMode, cmd /*cmd->at(1).c_str()*/);
+    Cmd::addHandler((char *) "powerOn", (char *) "Permit to retrieve paired devices", [](const TokenView *cmd)-> void {
+        IOHC::iohcCozyDevice2W::getInstance()->cmd(IOHC::DeviceButton::powerOn);
+    });
+    Cmd::addHandler((char *) "setTemp", (char *) "7.0 to 28.0 - 0 get actual temp", "temp int?", [](const Args &args)-> void {
+        IOHC::CozyArgs cozy;
+        cozy.temperature = args[0].temperature;
+        if (args.has(1)) cozy.device = static_cast<size_t>(args[1].number);
+        IOHC::iohcCozyDevice2W::getInstance()->cmd(IOHC::DeviceButton::setTemp, cozy);
+    });
+    Cmd::addHandler((char *) "setMode", (char *) "auto prog manual off - FF to get actual mode", "auto|prog|manual|off|ff",
+                    [](const Args &args)-> void {
+                        // Same order as the schema keywords
+                        static constexpr IOHC::CozyMode MODES[] = {IOHC::CozyMode::Auto, IOHC::CozyMode::Prog,
+                                                                   IOHC::CozyMode::Manual, IOHC::CozyMode::Off,
+                                                                   IOHC::CozyMode::Query};
+                        IOHC::CozyArgs cozy;
+                        cozy.mode = MODES[args[0].number];
+                        IOHC::iohcCozyDevice2W::getInstance()->cmd(IOHC::DeviceButton::setMode, cozy);
                     });
-    Cmd::addHandler((char *) "setPresence", (char *) "on off", [](Tokens *cmd)-> void {
-        IOHC::iohcCozyDevice2W::getInstance()->cmd(IOHC::DeviceButton::setPresence, cmd /*cmd->at(1).c_str()*/);
+    Cmd::addHandler((char *) "setPresence", (char *) "on off", "on|off", [](const Args &args)-> void {
+        IOHC::CozyArgs cozy;
+        cozy.on = args[0].number == 0;
+        IOHC::iohcCozyDevice2W::getInstance()->cmd(IOHC::DeviceButton::setPresence, cozy);
     });
-    Cmd::addHandler((char *) "setWindow", (char *) "open close", [](Tokens *cmd)-> void {
-        IOHC::iohcCozyDevice2W::getInstance()->cmd(IOHC::DeviceButton::setWindow, cmd /*cmd->at(1).c_str()*/);
+    Cmd::addHandler((char *) "setWindow", (char *) "open close", "open|close int?", [](const Args &args)-> void {
+        IOHC::CozyArgs cozy;
+        cozy.on = args[0].number == 0;
+        if (args.has(1)) cozy.device = static_cast<size_t>(args[1].number);
+        IOHC::iohcCozyDevice2W::getInstance()->cmd(IOHC::DeviceButton::setWindow, cozy);
     });
-    Cmd::addHandler((char *) "midnight", (char *) "Synchro Paired", [](Tokens *cmd)-> void {
-        IOHC::iohcCozyDevice2W::getInstance()->cmd(IOHC::DeviceButton::midnight, nullptr);
+    Cmd::addHandler((char *) "midnight", (char *) "Synchro Paired", [](const TokenView *cmd)-> void {
+        IOHC::iohcCozyDevice2W::getInstance()->cmd(IOHC::DeviceButton::midnight);
     });
-    Cmd::addHandler((char *) "associate", (char *) "Synchro Paired", [](Tokens *cmd)-> void {
-        IOHC::iohcCozyDevice2W::getInstance()->cmd(IOHC::DeviceButton::associate, nullptr);
+    Cmd::addHandler((char *) "associate", (char *) "Synchro Paired", [](const TokenView *cmd)-> void {
+        IOHC::iohcCozyDevice2W::getInstance()->cmd(IOHC::DeviceButton::associate);
     });
-    Cmd::addHandler((char *) "custom", (char *) "test unknown commands", [](Tokens *cmd)-> void {
+    Cmd::addHandler((char *) "custom", (char *) "test unknown commands", [](const TokenView *cmd)-> void {
         /*scanMode = true;*/
-        IOHC::iohcOtherDevice2W::getInstance()->cmd(IOHC::Other2WButton::custom, cmd /*cmd->at(1).c_str()*/);
+        IOHC::iohcOtherDevice2W::getInstance()->cmd(IOHC::Other2WButton::custom /*cmd->at(1).c_str()*/);
     });
-    Cmd::addHandler((char *) "custom60", (char *) "test 0x60 commands", [](Tokens *cmd)-> void {
+    Cmd::addHandler((char *) "custom60", (char *) "test 0x60 commands", "int", [](const Args &args)-> void {
         /*scanMode = true;*/
-        IOHC::iohcOtherDevice2W::getInstance()->cmd(IOHC::Other2WButton::custom60, cmd /*cmd->at(1).c_str()*/);
+        IOHC::Other2WArgs other;
+        other.command = static_cast<uint8_t>(args[0].number);
+        IOHC::iohcOtherDevice2W::getInstance()->cmd(IOHC::Other2WButton::custom60, other);
     });
     // 1W
-    Cmd::addHandler((char *) "pair", (char *) "1W put device in pair mode", [](Tokens *cmd)-> void {
-        IOHC::iohcRemote1W::getInstance()->cmd(IOHC::RemoteButton::Pair, cmd);
+    Cmd::addHandler((char *) "pair", (char *) "1W put device in pair mode", "device", [](const Args &args)-> void {
+        IOHC::iohcRemote1W::getInstance()->cmd(IOHC::RemoteButton::Pair, *args[0].device);
     });
-    Cmd::addHandler((char *) "add", (char *) "1W add controller to device", [](Tokens *cmd)-> void {
-        IOHC::iohcRemote1W::getInstance()->cmd(IOHC::RemoteButton::Add, cmd);
+    Cmd::addHandler((char *) "add", (char *) "1W add controller to device", "device", [](const Args &args)-> void {
+        IOHC::iohcRemote1W::getInstance()->cmd(IOHC::RemoteButton::Add, *args[0].device);
     });
-    Cmd::addHandler((char *) "remove", (char *) "1W remove controller from device", [](Tokens *cmd)-> void {
-        IOHC::iohcRemote1W::getInstance()->cmd(IOHC::RemoteButton::Remove, cmd);
+    Cmd::addHandler((char *) "remove", (char *) "1W remove controller from device", "device", [](const Args &args)-> void {
+        IOHC::iohcRemote1W::getInstance()->cmd(IOHC::RemoteButton::Remove, *args[0].device);
     });
-    Cmd::addHandler((char *) "open", (char *) "1W open device", [](Tokens *cmd)-> void {
-        IOHC::iohcRemote1W::getInstance()->cmd(IOHC::RemoteButton::Open, cmd);
+    Cmd::addHandler((char *) "open", (char *) "1W open device", "device", [](const Args &args)-> void {
+        IOHC::iohcRemote1W::getInstance()->cmd(IOHC::RemoteButton::Open, *args[0].device);
     });
-    Cmd::addHandler((char *) "close", (char *) "1W close device", [](Tokens *cmd)-> void {
-        IOHC::iohcRemote1W::getInstance()->cmd(IOHC::RemoteButton::Close, cmd);
+    Cmd::addHandler((char *) "close", (char *) "1W close device", "device", [](const Args &args)-> void {
+        IOHC::iohcRemote1W::getInstance()->cmd(IOHC::RemoteButton::Close, *args[0].device);
     });
-    Cmd::addHandler((char *) "stop", (char *) "1W stop device", [](Tokens *cmd)-> void {
-        IOHC::iohcRemote1W::getInstance()->cmd(IOHC::RemoteButton::Stop, cmd);
+    Cmd::addHandler((char *) "stop", (char *) "1W stop device", "device", [](const Args &args)-> void {
+        IOHC::iohcRemote1W::getInstance()->cmd(IOHC::RemoteButton::Stop, *args[0].device);
     });
-    Cmd::addHandler((char *) "position", (char *) "1W set position 0-100", [](Tokens *cmd)-> void {
-        IOHC::iohcRemote1W::getInstance()->cmd(IOHC::RemoteButton::Position, cmd);
+    Cmd::addHandler((char *) "position", (char *) "1W set position 0-100", "device percent", [](const Args &args)-> void {
+        IOHC::iohcRemote1W::getInstance()->cmd(IOHC::RemoteButton::Position, *args[0].device, args[1].number);
     });
-    Cmd::addHandler((char *) "absolute", (char *) "1W set absolute position 0-100", [](Tokens *cmd)-> void {
-        IOHC::iohcRemote1W::getInstance()->cmd(IOHC::RemoteButton::Absolute, cmd);
+    Cmd::addHandler((char *) "absolute", (char *) "1W set absolute position 0-100", "device percent", [](const Args &args)-> void {
+        IOHC::iohcRemote1W::getInstance()->cmd(IOHC::RemoteButton::Absolute, *args[0].device, args[1].number);
     });
-    Cmd::addHandler((char *) "vent", (char *) "1W vent device", [](Tokens *cmd)-> void {
-        IOHC::iohcRemote1W::getInstance()->cmd(IOHC::RemoteButton::Vent, cmd);
+    Cmd::addHandler((char *) "vent", (char *) "1W vent device", "device", [](const Args &args)-> void {
+        IOHC::iohcRemote1W::getInstance()->cmd(IOHC::RemoteButton::Vent, *args[0].device);
     });
-    Cmd::addHandler((char *) "force", (char *) "1W force device open", [](Tokens *cmd)-> void {
-        IOHC::iohcRemote1W::getInstance()->cmd(IOHC::RemoteButton::ForceOpen, cmd);
+    Cmd::addHandler((char *) "force", (char *) "1W force device open", "device", [](const Args &args)-> void {
+        IOHC::iohcRemote1W::getInstance()->cmd(IOHC::RemoteButton::ForceOpen, *args[0].device);
     });
-    Cmd::addHandler((char *) "mode1", (char *) "1W Mode1", [](Tokens *cmd)-> void {
-        IOHC::iohcRemote1W::getInstance()->cmd(IOHC::RemoteButton::Mode1, cmd);
+    Cmd::addHandler((char *) "mode1", (char *) "1W Mode1", "device", [](const Args &args)-> void {
+        IOHC::iohcRemote1W::getInstance()->cmd(IOHC::RemoteButton::Mode1, *args[0].device);
     });
-    Cmd::addHandler((char *) "mode2", (char *) "1W Mode2", [](Tokens *cmd)-> void {
-        IOHC::iohcRemote1W::getInstance()->cmd(IOHC::RemoteButton::Mode2, cmd);
+    Cmd::addHandler((char *) "mode2", (char *) "1W Mode2", "device", [](const Args &args)-> void {
+        IOHC::iohcRemote1W::getInstance()->cmd(IOHC::RemoteButton::Mode2, *args[0].device);
     });
-    Cmd::addHandler((char *) "mode3", (char *) "1W Mode3", [](Tokens *cmd)-> void {
-        IOHC::iohcRemote1W::getInstance()->cmd(IOHC::RemoteButton::Mode3, cmd);
+    Cmd::addHandler((char *) "mode3", (char *) "1W Mode3", "device", [](const Args &args)-> void {
+        IOHC::iohcRemote1W::getInstance()->cmd(IOHC::RemoteButton::Mode3, *args[0].device);
     });
-    Cmd::addHandler((char *) "mode4", (char *) "1W Mode4", [](Tokens *cmd)-> void {
-        IOHC::iohcRemote1W::getInstance()->cmd(IOHC::RemoteButton::Mode4, cmd);
+    Cmd::addHandler((char *) "mode4", (char *) "1W Mode4", "device", [](const Args &args)-> void {
+        IOHC::iohcRemote1W::getInstance()->cmd(IOHC::RemoteButton::Mode4, *args[0].device);
     });
-    Cmd::addHandler((char *) "new1W", (char *) "Add new 1W device", [](Tokens *cmd)-> void {
+    Cmd::addHandler((char *) "new1W", (char *) "Add new 1W device", [](const TokenView *cmd)-> void {
         if (cmd->size() < 2) {
             Serial.println("Usage: new1W <name>");
             return;
         }
-        std::string name = cmd->at(1);
-        for (size_t i = 2; i < cmd->size(); ++i) {
-            name += " " + cmd->at(i);
-        }
-        IOHC::iohcRemote1W::getInstance()->addRemote(name);
+        IOHC::iohcRemote1W::getInstance()->addRemote(std::string(cmd->rest(1)));
     });
-    Cmd::addHandler((char *) "del1W", (char *) "Remove 1W device", [](Tokens *cmd)-> void {
-        if (cmd->size() < 2) {
-            Serial.println("Usage: del1W <description>");
-            return;
-        }
-        IOHC::iohcRemote1W::getInstance()->removeRemote(cmd->at(1));
+    Cmd::addHandler((char *) "del1W", (char *) "Remove 1W device", "device", [](const Args &args)-> void {
+        const std::string description = args[0].device->description;
+        IOHC::iohcRemote1W::getInstance()->removeRemote(description);
     });
-    Cmd::addHandler((char *) "edit1W", (char *) "Edit 1W device name", [](Tokens *cmd)-> void {
-        if (cmd->size() < 3) {
-            Serial.println("Usage: edit1W <description> <name>");
-            return;
-        }
-        std::string name = cmd->at(2);
-        for (size_t i = 3; i < cmd->size(); ++i) {
-            name += " " + cmd->at(i);
-        }
-        IOHC::iohcRemote1W::getInstance()->renameRemote(cmd->at(1), name);
+    Cmd::addHandler((char *) "edit1W", (char *) "Edit 1W device name", "device text", [](const Args &args)-> void {
+        const std::string description = args[0].device->description;
+        IOHC::iohcRemote1W::getInstance()->renameRemote(description, std::string(args[1].text));
     });
-    Cmd::addHandler((char *) "time1W", (char *) "Set 1W device travel time", [](Tokens *cmd)-> void {
-        if (cmd->size() < 3) {
-            Serial.println("Usage: time1W <description> <seconds>");
+    Cmd::addHandler((char *) "time1W", (char *) "Set 1W device travel time", "device int", [](const Args &args)-> void {
+        if (args[1].number <= 0) {
+            Serial.println("Travel time must be at least one second");
             return;
         }
-        uint32_t t = strtoul(cmd->at(2).c_str(), nullptr, 10);
-        IOHC::iohcRemote1W::getInstance()->setTravelTime(cmd->at(1), t);
+        IOHC::iohcRemote1W::getInstance()->setTravelTime(args[0].device->description, args[1].number);
     });
-    Cmd::addHandler((char *) "repeat1W", (char *) "Set 1W device retry on no response", [](Tokens *cmd)-> void {
-        if (cmd->size() < 3) {
-            Serial.println("Usage: repeat1W <description> <0|1>");
-            return;
-        }
-        std::string value = cmd->at(2);
-        std::transform(value.begin(), value.end(), value.begin(), ::tolower);
-        bool enabled = value == "1" || value == "true" || value == "yes" || value == "on";
-        IOHC::iohcRemote1W::getInstance()->setRepeatOnNoResponse(cmd->at(1), enabled);
+    Cmd::addHandler((char *) "repeat1W", (char *) "Set 1W device retry on no response", "device 0|1|false|true|no|yes|off|on",
+                    [](const Args &args)-> void {
+        // Every second keyword switches it on
+        const bool enabled = args[1].number % 2;
+        IOHC::iohcRemote1W::getInstance()->setRepeatOnNoResponse(args[0].device->description, enabled);
     });
-    Cmd::addHandler((char *) "list1W", (char *) "List 1W devices", [](Tokens *cmd)-> void {
+    Cmd::addHandler((char *) "list1W", (char *) "List 1W devices", [](const TokenView *cmd)-> void {
         const auto &remotes = IOHC::iohcRemote1W::getInstance()->getRemotes();
         for (const auto &r : remotes) {
             Serial.printf("%s: %s %u %s repeatOnNoResponse=%s\n",
@@ -194,124 +192,356 @@ void createCommands() {
                           r.repeatOnNoResponse ? "true" : "false");
         }
     });
+    Cmd::addHandler((char *) "group", (char *) "1W group <action> [0-100] <all|remote|dev,dev>", [](const TokenView *cmd)-> void {
+        if (cmd->size() < 3) {
+            const auto &report = IOHC::iohcRadio::getInstance()->lastBatchReport();
+            Serial.println("Usage: group <open|close|stop|vent|force|position|absolute> [0-100] <all|remote name|dev1,dev2>");
+            Serial.printf("Last TX batch: %u frame(s)%s, start spread %u ms, total %u ms\n",
+                          report.frames, report.interleaved ? " interleaved" : "",
+                          report.startSpreadUs / 1000, report.durationUs / 1000);
+            return;
+        }
+        IOHC::RemoteButton btn;
+        const std::string action(cmd->at(1));
+        if (!IOHC::groupActionFromString(action, btn)) {
+            Serial.printf("Unknown group action %s\n", action.c_str());
+            return;
+        }
+        size_t first = 2;
+        uint8_t percent = 0;
+        if (btn == IOHC::RemoteButton::Position || btn == IOHC::RemoteButton::Absolute) {
+            if (cmd->size() < 4 || !cmd->percent(2, percent)) {
+                Serial.println("Usage: group position|absolute <0-100> <group>");
+                return;
+            }
+            first = 3;
+        }
+        const std::string spec(cmd->rest(first));
+
+        auto *remote1W = IOHC::iohcRemote1W::getInstance();
+        auto result = remote1W->groupCmd(btn, remote1W->resolveGroup(spec), percent);
+        for (const auto &missing : result.missing) {
+            Serial.printf("Group member %s not found\n", missing.c_str());
+        }
+        Serial.printf("Group %s: %u device(s) in one batch, expected start spread %u ms\n",
+                      spec.c_str(), result.devices, result.estimatedSpreadMs);
+    });
     // Remote map
-    Cmd::addHandler((char *) "newRemote", (char *) "Create remote with address and name", [](Tokens *cmd)-> void {
+    Cmd::addHandler((char *) "newRemote", (char *) "Create remote with address and name", [](const TokenView *cmd)-> void {
         if (cmd->size() < 3) {
             Serial.println("Usage: newRemote <address> <name>");
             return;
         }
         IOHC::address node{};
-        if (hexStringToBytes(cmd->at(1), node) != sizeof(IOHC::address)) {
+        if (!cmd->hexAddress(1, node)) {
             Serial.println("Invalid address");
             return;
         }
-        std::string name = cmd->at(2);
-        for (size_t i = 3; i < cmd->size(); ++i) {
-            name += " " + cmd->at(i);
-        }
-        IOHC::iohcRemoteMap::getInstance()->add(node, name);
+        IOHC::iohcRemoteMap::getInstance()->add(node, std::string(cmd->rest(2)));
     });
-    Cmd::addHandler((char *) "editRemote", (char *) "Edit remote name", [](Tokens *cmd)-> void {
+    Cmd::addHandler((char *) "editRemote", (char *) "Edit remote name", [](const TokenView *cmd)-> void {
         if (cmd->size() < 2) {
             Serial.println("Usage: editRemote <address> <name>");
             return;
         }
         IOHC::address node{};
-        if (hexStringToBytes(cmd->at(1), node) != sizeof(IOHC::address)) {
+        if (!cmd->hexAddress(1, node)) {
             Serial.println("Invalid address");
             return;
         }
-        std::string name = cmd->at(2);
-        for (size_t i = 3; i < cmd->size(); ++i) {
-            name += " " + cmd->at(i);
-        }
-        IOHC::iohcRemoteMap::getInstance()->renameDevice(node, name);
+        IOHC::iohcRemoteMap::getInstance()->renameDevice(node, std::string(cmd->rest(2)));
     });
-    Cmd::addHandler((char *) "linkRemote", (char *) "Link device to remote", [](Tokens *cmd)-> void {
+    Cmd::addHandler((char *) "linkRemote", (char *) "Link device to remote", [](const TokenView *cmd)-> void {
         if (cmd->size() < 3) {
             Serial.println("Usage: linkRemote <address> <device>");
             return;
         }
         IOHC::address node{};
-        if (hexStringToBytes(cmd->at(1), node) != sizeof(IOHC::address)) {
+        if (!cmd->hexAddress(1, node)) {
             Serial.println("Invalid address");
             return;
         }
-        IOHC::iohcRemoteMap::getInstance()->linkDevice(node, cmd->at(2));
+        IOHC::iohcRemoteMap::getInstance()->linkDevice(node, std::string(cmd->at(2)));
     });
-    Cmd::addHandler((char *) "unlinkRemote", (char *) "Remove device from remote", [](Tokens *cmd)-> void {
+    Cmd::addHandler((char *) "unlinkRemote", (char *) "Remove device from remote", [](const TokenView *cmd)-> void {
         if (cmd->size() < 3) {
             Serial.println("Usage: unlinkRemote <address> <device>");
             return;
         }
         IOHC::address node{};
-        if (hexStringToBytes(cmd->at(1), node) != sizeof(IOHC::address)) {
+        if (!cmd->hexAddress(1, node)) {
             Serial.println("Invalid address");
             return;
         }
-        IOHC::iohcRemoteMap::getInstance()->unlinkDevice(node, cmd->at(2));
+        IOHC::iohcRemoteMap::getInstance()->unlinkDevice(node, std::string(cmd->at(2)));
     });
-    Cmd::addHandler((char *) "delRemote", (char *) "Remove remote", [](Tokens *cmd)-> void {
+    Cmd::addHandler((char *) "delRemote", (char *) "Remove remote", [](const TokenView *cmd)-> void {
         if (cmd->size() < 2) {
             Serial.println("Usage: delRemote <address>");
             return;
         }
         IOHC::address node{};
-        if (hexStringToBytes(cmd->at(1), node) != sizeof(IOHC::address)) {
+        if (!cmd->hexAddress(1, node)) {
             Serial.println("Invalid address");
             return;
         }
         IOHC::iohcRemoteMap::getInstance()->remove(node);
     });
     // Other 2W
-    Cmd::addHandler((char *) "discovery", (char *) "Send discovery on air", [](Tokens *cmd)-> void {
-        IOHC::iohcOtherDevice2W::getInstance()->cmd(IOHC::Other2WButton::discovery, nullptr);
+    Cmd::addHandler((char *) "discovery", (char *) "Send discovery on air", [](const TokenView *cmd)-> void {
+        IOHC::iohcOtherDevice2W::getInstance()->cmd(IOHC::Other2WButton::discovery);
     });
-    Cmd::addHandler((char *) "getName", (char *) "Name Of A Device", [](Tokens *cmd)-> void {
-        IOHC::iohcOtherDevice2W::getInstance()->cmd(IOHC::Other2WButton::getName, cmd);
+    Cmd::addHandler((char *) "getName", (char *) "Name Of A Device", "addr", [](const Args &args)-> void {
+        IOHC::Other2WArgs other;
+        memcpy(other.target, args[0].node, sizeof(other.target));
+        IOHC::iohcOtherDevice2W::getInstance()->cmd(IOHC::Other2WButton::getName, other);
     });
-    Cmd::addHandler((char *) "scanMode", (char *) "scanMode", [](Tokens *cmd)-> void {
+    Cmd::addHandler((char *) "scanMode", (char *) "scanMode", [](const TokenView *cmd)-> void {
         scanMode = true;
-        IOHC::iohcOtherDevice2W::getInstance()->cmd(IOHC::Other2WButton::checkCmd, nullptr);
+        IOHC::iohcOtherDevice2W::getInstance()->cmd(IOHC::Other2WButton::checkCmd);
     });
-    Cmd::addHandler((char *) "scanDump", (char *) "Dump Scan Results", [](Tokens *cmd)-> void {
+    Cmd::addHandler((char *) "scanDump", (char *) "Dump Scan Results", [](const TokenView *cmd)-> void {
         scanMode = false;
         IOHC::iohcOtherDevice2W::getInstance()->scanDump();
     });
     Cmd::addHandler((char *) "verbose", (char *) "Toggle verbose output on packets list",
-                    [](Tokens *cmd)-> void { verbosity = !verbosity; });
+                    [](const TokenView *cmd)-> void { verbosity = !verbosity; });
 
-    Cmd::addHandler((char *) "pairMode", (char *) "pairMode", [](Tokens *cmd)-> void { pairMode = !pairMode; });
+    Cmd::addHandler((char *) "pairMode", (char *) "pairMode", [](const TokenView *cmd)-> void { pairMode = !pairMode; });
 
     // Utils
-    Cmd::addHandler((char *) "dump", (char *) "Dump Transceiver registers", [](Tokens *cmd)-> void {
+    Cmd::addHandler((char *) "dump", (char *) "Dump Transceiver registers", [](const TokenView *cmd)-> void {
         Radio::dump();
 //        Serial.printf("*%d packets in memory\t", nextPacket);
 //        Serial.printf("*%d devices discovered\n\n", sysTable->size());
     });
     /*    
-    //    Cmd::addHandler((char *)"dump2", (char *)"Dump Transceiver registers 1Col", [](Tokens*cmd)->void {Radio::dump2(); Serial.printf("*%d packets in memory\t", nextPacket); Serial.printf("*%d devices discovered\n\n", sysTable->size());});
-    Cmd::addHandler((char *) "list1W", (char *) "List received packets", [](Tokens *cmd)-> void {
+    //    Cmd::addHandler((char *)"dump2", (char *)"Dump Transceiver registers 1Col", [](const TokenView *cmd)->void {Radio::dump2(); Serial.printf("*%d packets in memory\t", nextPacket); Serial.printf("*%d devices discovered\n\n", sysTable->size());});
+    Cmd::addHandler((char *) "list1W", (char *) "List received packets", [](const TokenView *cmd)-> void {
         for (uint8_t i = 0; i < nextPacket; i++) msgRcvd(radioPackets[i]);
         sysTable->dump1W();
     });
-    Cmd::addHandler((char *) "save", (char *) "Saves Objects table", [](Tokens *cmd)-> void {
+    Cmd::addHandler((char *) "save", (char *) "Saves Objects table", [](const TokenView *cmd)-> void {
         sysTable->save(true); });
-    Cmd::addHandler((char *) "erase", (char *) "Erase received packets", [](Tokens *cmd)-> void {
+    Cmd::addHandler((char *) "erase", (char *) "Erase received packets", [](const TokenView *cmd)-> void {
         for (uint8_t i = 0; i < nextPacket; i++) free(radioPackets[i]);
         nextPacket = 0;
     });
     Cmd::addHandler((char *) "send", (char *) "Send packet from cmd line",
-                    [](Tokens *cmd)-> void { txUserBuffer(cmd); });
+                    [](const TokenView *cmd)-> void { txUserBuffer(cmd); });
 */
-    Cmd::addHandler((char *) "ls", (char *) "List filesystem", [](Tokens *cmd)-> void { listFS(); });
-    Cmd::addHandler((char *) "cat", (char *) "Print file content", [](Tokens *cmd)-> void { cat(cmd->at(1).c_str()); });
-    Cmd::addHandler((char *) "rm", (char *) "Remove file", [](Tokens *cmd)-> void { rm(cmd->at(1).c_str()); });
-    Cmd::addHandler((char *) "lastAddr", (char *) "Show last received address", [](Tokens *cmd)-> void {
+    Cmd::addHandler((char *) "ls", (char *) "List filesystem", [](const TokenView *cmd)-> void { listFS(); });
+    Cmd::addHandler((char *) "cat", (char *) "Print file content", [](const TokenView *cmd)-> void { cat(std::string(cmd->at(1)).c_str()); });
+    Cmd::addHandler((char *) "rm", (char *) "Remove file", [](const TokenView *cmd)-> void { rm(std::string(cmd->at(1)).c_str()); });
+    Cmd::addHandler((char *) "lastAddr", (char *) "Show last received address", [](const TokenView *cmd)-> void {
         Serial.println(bytesToHexString(IOHC::lastFromAddress, sizeof(IOHC::lastFromAddress)).c_str());
     });
+    Cmd::addHandler((char *) "coverBus", (char *) "Cover state bus stats, [reset|<window ms>|rate <sink> <n>]", [](const TokenView *cmd)-> void {
+        if (cmd->size() > 1) {
+            if (cmd->at(1) == "reset") {
+                resetCoverStateBusStats();
+            } else if (cmd->at(1) == "rate") {
+                CoverSink sink;
+                int rate;
+                if (cmd->size() < 4 || !parseCoverSink(std::string(cmd->at(2)).c_str(), sink) || !cmd->integer(3, rate)) {
+                    Serial.println("Usage: coverBus rate <mqtt|websocket|oled> <updates per second>");
+                    return;
+                }
+                setCoverSinkRate(sink, static_cast<uint16_t>(std::clamp(rate, 1, 1000)));
+            } else {
+                int window;
+                if (!cmd->integer(1, window)) {
+                    Serial.println("Usage: coverBus [reset|<window ms>|rate <sink> <n>]");
+                    return;
+                }
+                setCoverStateWindow(static_cast<uint16_t>(std::clamp(window, 0, 5000)));
+            }
+        }
+        CoverStateBusStats stats = getCoverStateBusStats();
+        Serial.printf("Window %u ms, %u devices, posted %u, direct %u, evicted %u, flushes %u\n",
+                      stats.windowMs, stats.devices, stats.posted, stats.direct, stats.evicted, stats.flushes);
+        for (const auto &sink : stats.sinks) {
+            Serial.printf("  %-9s %3u/s delivered %u merged %u deferred %u dropped %u\n",
+                          sink.name, sink.ratePerSec, sink.delivered, sink.merged, sink.deferred, sink.dropped);
+        }
+    });
+    Cmd::addHandler((char *) "script", (char *) "list|show|run|del <name>, exec <a; b>, stop, status", [](const TokenView *cmd)-> void {
+        const std::string_view sub = cmd->size() > 1 ? cmd->at(1) : "status";
+        const std::string arg(cmd->at(2));
+        std::string error;
+        if (sub == "list") {
+            for (const auto &name : listScripts()) Serial.printf("  %s\n", name.c_str());
+        } else if (sub == "show") {
+            std::string body;
+            if (loadScript(arg, body)) Serial.printf("%s\n", body.c_str());
+            else Serial.println("Unknown script");
+        } else if (sub == "run") {
+            if (!runScript(arg, error)) Serial.printf("Script %s: %s\n", arg.c_str(), error.c_str());
+        } else if (sub == "exec") {
+            // Rest of the line is the script, statements separated by ';'
+            if (!runScriptText(std::string(cmd->rest(2)), error)) Serial.printf("Script: %s\n", error.c_str());
+        } else if (sub == "del") {
+            Serial.println(deleteScript(arg) ? "Script deleted" : "Unknown script");
+        } else if (sub == "stop") {
+            stopScripts();
+        } else {
+            const ScriptStatus status = getScriptStatus();
+            Serial.printf("%s %s step %u/%u, %u ms, %u queued, %u completed%s%s\n",
+                          status.running ? "Running" : "Idle", status.name.c_str(), status.step, status.steps,
+                          status.elapsedMs, status.queued, status.completed,
+                          status.lastError.empty() ? "" : ", last error: ", status.lastError.c_str());
+        }
+    });
+    Cmd::addHandler((char *) "logLevel", (char *) "Log level per module [module|all] [level]", [](const TokenView *cmd)-> void {
+        LogLevel level;
+        LogModule module = LogModule::Count;
+        const bool all = cmd->size() > 1 && cmd->at(1) == "all";
+        if (cmd->size() > 1 && !all && !parseLogModule(std::string(cmd->at(1)).c_str(), module)) {
+            Serial.println("Usage: logLevel [core|radio|mqtt|web|script|idf|all] [none|error|warn|info|debug|verbose]");
+            return;
+        }
+        if (cmd->size() > 2) {
+            if (!parseLogLevel(std::string(cmd->at(2)).c_str(), level)) {
+                Serial.println("Usage: logLevel [module|all] <none|error|warn|info|debug|verbose>");
+                return;
+            }
+            for (uint8_t i = 0; i < static_cast<uint8_t>(LogModule::Count); ++i) {
+                if (all || static_cast<LogModule>(i) == module) setLogLevel(static_cast<LogModule>(i), level);
+            }
+        }
+        for (uint8_t i = 0; i < static_cast<uint8_t>(LogModule::Count); ++i) {
+            const auto m = static_cast<LogModule>(i);
+            if (module == LogModule::Count || m == module)
+                Serial.printf("  %-7s %s\n", logModuleName(m), logLevelName(getLogLevel(m)));
+        }
+        const LoggerStats stats = getLoggerStats();
+        Serial.printf("Records %u written, %u dropped, %u formatted\n", stats.written, stats.dropped, stats.formatted);
+    });
+    Cmd::addHandler((char *) "scanPolicy", (char *) "Scan dwell per channel [fixed|adaptive|reset]", [](const TokenView *cmd)-> void {
+        auto &scheduler = IOHC::iohcRadio::getInstance()->scheduler();
+        if (cmd->size() > 1) {
+            if (cmd->at(1) == "fixed") scheduler.setPolicy(IOHC::iohcScanScheduler::Policy::Fixed);
+            else if (cmd->at(1) == "adaptive") scheduler.setPolicy(IOHC::iohcScanScheduler::Policy::Adaptive);
+            else if (cmd->at(1) == "reset") scheduler.resetStats();
+            else {
+                Serial.println("Usage: scanPolicy [fixed|adaptive|reset]");
+                return;
+            }
+        }
+        uint32_t freqs[] = FREQS2SCAN;
+        Serial.printf("Scan policy %s\n",
+                      scheduler.policy() == IOHC::iohcScanScheduler::Policy::Fixed ? "fixed" : "adaptive");
+        for (uint8_t i = 0; i < scheduler.channels(); ++i) {
+            const auto stats = scheduler.stats(i);
+            Serial.printf("  %u.%03u MHz  dwell %5u us  visits %u  preambles %u  frames %u\n",
+                          freqs[i] / 1000000, (freqs[i] / 1000) % 1000, stats.dwellUs,
+                          stats.visits, stats.preambles, stats.frames);
+        }
+        const auto &events = IOHC::iohcRadio::getInstance()->rxEventStats();
+        Serial.printf("RX wakeups: %u edges, %u deadlines (%u stale), %u preamble timeouts\n",
+                      events.edges, events.deadlines, events.stale, events.preambleTimeouts);
+#if defined(DUAL_RADIO)
+        Serial.printf("Own transmissions heard and dropped: %u\n", events.ownFrames);
+#endif
+    });
+    Cmd::addHandler((char *) "lbt", (char *) "Listen before talk [on|off|reset]", [](const TokenView *cmd)-> void {
+        auto *radio = IOHC::iohcRadio::getInstance();
+        if (cmd->size() > 1) {
+            if (cmd->at(1) == "on") radio->setListenBeforeTalk(true);
+            else if (cmd->at(1) == "off") radio->setListenBeforeTalk(false);
+            else if (cmd->at(1) == "reset") radio->resetLbtStats();
+            else {
+                Serial.println("Usage: lbt [on|off|reset]");
+                return;
+            }
+        }
+        const auto &stats = radio->lbtStats();
+        Serial.printf("Listen before talk %s, busy above %d dBm\n", radio->listenBeforeTalk() ? "on" : "off",
+                      LBT_RSSI_THRESHOLD_DBM);
+        Serial.printf("Batches %u: %u clear, %u deferred (%u backoffs), %u sent while busy\n",
+                      stats.assessments, stats.clear, stats.deferred, stats.backoffs, stats.forced);
+        if (stats.assessments)
+            Serial.printf("Wait before TX: avg %u us, max %u us\n",
+                          static_cast<unsigned>(stats.totalWaitUs / stats.assessments), stats.maxWaitUs);
+    });
+    Cmd::addHandler((char *) "spiStats", (char *) "SPI transactions issued and saved by the register shadow [reset]", [](const TokenView *cmd)-> void {
+        auto *radio = IOHC::iohcRadio::getInstance();
+        // Frame counters at the last reset, for the per frame figures
+        static uint32_t rxFramesBase = 0, txFramesBase = 0;
+        if (cmd->size() > 1) {
+            if (cmd->at(1) != "reset") {
+                Serial.println("Usage: spiStats [reset]");
+                return;
+            }
+            Radio::resetSpiStats();
+            rxFramesBase = radio->rxEventStats().frames;
+            txFramesBase = radio->transmissions();
+        }
+        const struct {
+            const char *name;
+            Radio::SpiPath path;
+            uint32_t frames;
+        } paths[] = {
+            {"RX", Radio::SpiPath::Rx, radio->rxEventStats().frames - rxFramesBase},
+            {"TX", Radio::SpiPath::Tx, radio->transmissions() - txFramesBase},
+            {"other", Radio::SpiPath::Other, 0},
+        };
+        for (const auto &p : paths) {
+            const auto stats = Radio::spiStats(p.path);
+            Serial.printf("  %-5s %8u transactions, %8u saved", p.name, stats.transactions, stats.saved);
+            if (p.frames)
+                Serial.printf(" (%.1f / %.1f per frame, %u frames)", static_cast<float>(stats.transactions) / p.frames,
+                              static_cast<float>(stats.saved) / p.frames, p.frames);
+            Serial.println();
+        }
+    });
+    Cmd::addHandler((char *) "callbacks", (char *) "Callback task lanes: queued, dropped, high-water [reset]", [](const TokenView *cmd)-> void {
+        if (cmd->size() > 1) {
+            if (cmd->at(1) != "reset") {
+                Serial.println("Usage: callbacks [reset]");
+                return;
+            }
+            IOHC::iohcRadio::resetCallbackStats();
+        }
+        for (const auto lane : {IOHC::CallbackLane::High, IOHC::CallbackLane::Low}) {
+            const auto stats = IOHC::iohcRadio::callbackStats(lane);
+            Serial.printf("  %-4s %8u queued %6u dropped  depth %u/%u  high-water %u\n",
+                          lane == IOHC::CallbackLane::High ? "high" : "low", stats.queued, stats.dropped,
+                          stats.depth, stats.capacity, stats.highWater);
+        }
+    });
+    Cmd::addHandler((char *) "latency", (char *) "Radio latency per stage, RX from the DIO edge, TX from cmd() [reset]", [](const TokenView *cmd)-> void {
+        if (cmd->size() > 1) {
+            if (cmd->at(1) != "reset") {
+                Serial.println("Usage: latency [reset]");
+                return;
+            }
+            resetLatency();
+        }
+        Serial.printf("  %-12s %8s %9s %9s %9s %9s %9s\n", "stage", "count", "min", "avg", "p50", "p99", "max");
+        for (uint8_t i = 0; i < static_cast<uint8_t>(LatencyStage::Count); ++i) {
+            const auto stage = static_cast<LatencyStage>(i);
+            const auto s = getLatency(stage);
+            Serial.printf("  %-12s %8u %6u us %6u us %6u us %6u us %6u us\n", latencyStageName(stage), s.count,
+                          s.minUs, s.avgUs, s.p50Us, s.p99Us, s.maxUs);
+        }
+    });
+    Cmd::addHandler((char *) "timers", (char *) "Timer service: lateness per timer [reset]", [](const TokenView *cmd)-> void {
+        if (cmd->size() > 1) {
+            if (cmd->at(1) != "reset") {
+                Serial.println("Usage: timers [reset]");
+                return;
+            }
+            resetTimerStats();
+        }
+        Serial.printf("  %-16s %-9s %8s %8s %8s %8s %7s\n", "timer", "dispatch", "fires", "late avg", "last", "max", "skipped");
+        for (const auto &t : getTimerStats()) {
+            Serial.printf("  %-16s %-9s %8u %6u us %5u us %5u us %7u\n", t.name, t.worker ? "worker" : "immediate", t.fires,
+                          t.fires ? static_cast<unsigned>(t.lateTotalUs / t.fires) : 0u, t.lateLastUs, t.lateMaxUs, t.skipped);
+        }
+    });
 #if defined(MQTT)
-    Cmd::addHandler((char *) "mqttIp", (char *) "Set MQTT server IP", [](Tokens *cmd)-> void {
+    Cmd::addHandler((char *) "mqttIp", (char *) "Set MQTT server IP", [](const TokenView *cmd)-> void {
         if (cmd->size() < 2) {
             Serial.println("Usage: mqttIp <ip>");
             return;
@@ -324,7 +554,7 @@ void createCommands() {
         mqttClient.setServer(mqtt_server.c_str(), mqtt_port);
         connectToMqtt();
     });
-    Cmd::addHandler((char *) "mqttUser", (char *) "Set MQTT username", [](Tokens *cmd)-> void {
+    Cmd::addHandler((char *) "mqttUser", (char *) "Set MQTT username", [](const TokenView *cmd)-> void {
         if (cmd->size() < 2) {
             Serial.println("Usage: mqttUser <username>");
             return;
@@ -337,7 +567,7 @@ void createCommands() {
         mqttClient.setCredentials(mqtt_user.c_str(), mqtt_password.c_str());
         connectToMqtt();
     });
-    Cmd::addHandler((char *) "mqttId", (char *) "Set MQTT client ID", [](Tokens *cmd)-> void {
+    Cmd::addHandler((char *) "mqttId", (char *) "Set MQTT client ID", [](const TokenView *cmd)-> void {
         if (cmd->size() < 2) {
             Serial.println("Usage: mqttId <id>");
             return;
@@ -350,7 +580,7 @@ void createCommands() {
         mqttClient.setClientId(mqtt_client_id.c_str());
         connectToMqtt();
     });
-    Cmd::addHandler((char *) "mqttPass", (char *) "Set MQTT password", [](Tokens *cmd)-> void {
+    Cmd::addHandler((char *) "mqttPass", (char *) "Set MQTT password", [](const TokenView *cmd)-> void {
         if (cmd->size() < 2) {
             Serial.println("Usage: mqttPass <password>");
             return;
@@ -363,13 +593,13 @@ void createCommands() {
         mqttClient.setCredentials(mqtt_user.c_str(), mqtt_password.c_str());
         connectToMqtt();
     });
-    Cmd::addHandler((char *) "mqttPort", (char *) "Set MQTT port", [](Tokens *cmd)-> void {
+    Cmd::addHandler((char *) "mqttPort", (char *) "Set MQTT port", [](const TokenView *cmd)-> void {
         if (cmd->size() < 2) {
             Serial.println("Usage: mqttPort <port>");
             return;
         }
-        int port = atoi(cmd->at(1).c_str());
-        if (port <= 0 || port > 65535) {
+        int port = 0;
+        if (!cmd->integer(1, port) || port <= 0 || port > 65535) {
             Serial.println("Invalid port value");
             return;
         }
@@ -381,7 +611,7 @@ void createCommands() {
         mqttClient.setServer(mqtt_server.c_str(), mqtt_port);
         connectToMqtt();
     });
-    Cmd::addHandler((char *) "mqttDiscovery", (char *) "Set MQTT discovery topic", [](Tokens *cmd)-> void {
+    Cmd::addHandler((char *) "mqttDiscovery", (char *) "Set MQTT discovery topic", [](const TokenView *cmd)-> void {
         if (cmd->size() < 2) {
             Serial.println("Usage: mqttDiscovery <topic>");
             return;
@@ -393,28 +623,45 @@ void createCommands() {
         if (mqttStatus == ConnState::Connected)
             handleMqttConnect();
     });
+    Cmd::addHandler((char *) "mqttFrames", (char *) "Frame sinks json,sensor,cbor or none", [](const TokenView *cmd)-> void {
+        if (cmd->size() < 2) {
+            Serial.printf("Frame sinks: %s\n", frameSinksToString(mqtt_frame_sinks).c_str());
+            return;
+        }
+        uint8_t sinks;
+        if (!parseFrameSinks(std::string(cmd->at(1)), sinks)) {
+            Serial.println("Usage: mqttFrames <json,sensor,cbor|none>");
+            return;
+        }
+        setFrameSinks(sinks);
+        Serial.printf("Frame sinks: %s\n", frameSinksToString(sinks).c_str());
+    });
 #endif
-    Cmd::addHandler((char *) "wifiClear", (char *) "Clear configured WiFi settings and restart device", [](Tokens *cmd)-> void {
+    Cmd::addHandler((char *) "wifiClear", (char *) "Clear configured WiFi settings and restart device", [](const TokenView *cmd)-> void {
         clearWifi();
     });
+#if defined(CMD_BENCHMARK)
+    registerCmdBenchmark();
+    registerScanBenchmark();
+#endif
 /*
-    Cmd::addHandler((char *) "list2W", (char *) "List received packets", [](Tokens *cmd)-> void {
+    Cmd::addHandler((char *) "list2W", (char *) "List received packets", [](const TokenView *cmd)-> void {
         for (uint8_t i = 0; i < nextPacket; i++) msgRcvd(radioPackets[i]);
         sysTable->dump2W();
     });
 */    // Unnecessary just for test
-    Cmd::addHandler((char *) "discover28", (char *) "discover28", [](Tokens *cmd)-> void {
-        IOHC::iohcOtherDevice2W::getInstance()->cmd(IOHC::Other2WButton::discover28, nullptr);
+    Cmd::addHandler((char *) "discover28", (char *) "discover28", [](const TokenView *cmd)-> void {
+        IOHC::iohcOtherDevice2W::getInstance()->cmd(IOHC::Other2WButton::discover28);
     });
 
-    Cmd::addHandler((char *) "discover2A", (char *) "discover2A", [](Tokens *cmd)-> void {
-        IOHC::iohcOtherDevice2W::getInstance()->cmd(IOHC::Other2WButton::discover2A, nullptr);
+    Cmd::addHandler((char *) "discover2A", (char *) "discover2A", [](const TokenView *cmd)-> void {
+        IOHC::iohcOtherDevice2W::getInstance()->cmd(IOHC::Other2WButton::discover2A);
     });
 /*
-    Cmd::addHandler((char *) "fake0", (char *) "fake0", [](Tokens *cmd)-> void {
+    Cmd::addHandler((char *) "fake0", (char *) "fake0", [](const TokenView *cmd)-> void {
         IOHC::iohcCozyDevice2W::getInstance()->cmd(IOHC::DeviceButton::fake0, nullptr);
     });
-    Cmd::addHandler((char *) "ack", (char *) "ack33", [](Tokens *cmd)-> void {
+    Cmd::addHandler((char *) "ack", (char *) "ack33", [](const TokenView *cmd)-> void {
         IOHC::iohcCozyDevice2W::getInstance()->cmd(IOHC::DeviceButton::ack, nullptr);
     });
 */
@@ -454,90 +701,277 @@ void createCommands() {
     */
 }
 
-bool addHandler(char *cmd, char *description, void (*handler)(Tokens*)) {
-  for (uint8_t idx = 0; idx < MAXCMDS; ++idx) {
-    if (_cmdHandler[idx] != nullptr) {
-    } else {
-      void *alloc = malloc(sizeof(struct _cmdEntry));
-      if (!alloc)
-        return false;
-
-      _cmdHandler[idx] = static_cast<_cmdEntry *>(alloc);
-      memset(alloc, 0, sizeof(struct _cmdEntry));
-      strncpy(_cmdHandler[idx]->cmd, cmd,
-              strlen(cmd) < sizeof(_cmdHandler[idx]->cmd) ? strlen(cmd)
-                                                          : sizeof(_cmdHandler[idx]->cmd) - 1);
-      strncpy(_cmdHandler[idx]->description, description,
-              strlen(cmd) < sizeof(_cmdHandler[idx]->description)
-                  ? strlen(description)
-                  : sizeof(_cmdHandler[idx]->description) - 1);
-      _cmdHandler[idx]->handler = handler;
-
-      if (idx > lastEntry)
-        lastEntry = idx;
-      return true;
-    }
+// Open addressing table of indices into _cmdEntries, 0 marks a free slot.
+// Twice as many slots as commands keeps probe sequences short.
+static constexpr uint16_t CMD_HASH_SLOTS = 256;
+static_assert(CMD_HASH_SLOTS >= 2 * MAXCMDS && (CMD_HASH_SLOTS & (CMD_HASH_SLOTS - 1)) == 0,
+              "CMD_HASH_SLOTS must be a power of two of at least twice MAXCMDS");
+static _cmdEntry _cmdEntries[MAXCMDS];
+static uint8_t _cmdCount = 0;
+static uint8_t _cmdIndex[CMD_HASH_SLOTS];
+
+static uint32_t cmdHash(const char *cmd, size_t len) {
+  uint32_t hash = 2166136261u; // FNV-1a
+  for (size_t i = 0; i < len; ++i) {
+    hash ^= static_cast<uint8_t>(cmd[i]);
+    hash *= 16777619u;
   }
-  return false;
+  return hash;
 }
 
-char *cmdReceived(bool echo) {
-  _avail = Serial.available();
-  if (_avail) {
-    _len += Serial.readBytes(&_rxbuffer[_len], _avail);
-    if (echo) {
-      _rxbuffer[_len] = '\0';
-      Serial.printf("%s", &_rxbuffer[_len - _avail]);
-    }
+const _cmdEntry *findHandler(const char *cmd, size_t len) {
+  for (uint32_t slot = cmdHash(cmd, len);; ++slot) {
+    const uint8_t idx = _cmdIndex[slot & (CMD_HASH_SLOTS - 1)];
+    if (!idx)
+      return nullptr;
+    const _cmdEntry &entry = _cmdEntries[idx - 1];
+    if (strlen(entry.cmd) == len && memcmp(entry.cmd, cmd, len) == 0)
+      return &entry;
   }
-  if (_rxbuffer[_len - 1] == 0x0a) {
-    _rxbuffer[_len - 2] = '\0';
-    _len = 0;
-    return _rxbuffer;
+}
+
+static bool addEntry(const _cmdEntry &added) {
+  if (_cmdCount >= MAXCMDS)
+    return false;
+
+  _cmdEntry &entry = _cmdEntries[_cmdCount];
+  entry = added;
+  _cmdCount++;
+
+  // A name registered twice keeps dispatching to its first handler
+  const size_t len = strlen(entry.cmd);
+  if (findHandler(entry.cmd, len))
+    return true;
+  uint32_t slot = cmdHash(entry.cmd, len);
+  while (_cmdIndex[slot & (CMD_HASH_SLOTS - 1)])
+    ++slot;
+  _cmdIndex[slot & (CMD_HASH_SLOTS - 1)] = _cmdCount;
+  return true;
+}
+
+static _cmdEntry makeEntry(const char *cmd, const char *description) {
+  _cmdEntry entry{};
+  snprintf(entry.cmd, sizeof(entry.cmd), "%s", cmd);
+  snprintf(entry.description, sizeof(entry.description), "%s", description);
+  return entry;
+}
+
+bool addHandler(char *cmd, char *description, void (*handler)(const TokenView *)) {
+  _cmdEntry entry = makeEntry(cmd, description);
+  entry.handler = handler;
+  return addEntry(entry);
+}
+
+bool addHandler(char *cmd, char *description, const char *schema, void (*handler)(const Args &)) {
+  _cmdEntry entry = makeEntry(cmd, description);
+  entry.schema = schema;
+  entry.typed = handler;
+  return addEntry(entry);
+}
+
+// Check the tokens after the command name against one schema kind
+static bool parseArg(std::string_view kind, const TokenView &tokens, size_t idx, Arg &arg) {
+  arg = Arg{};
+  arg.text = tokens[idx];
+  if (kind == "device")
+    return (arg.device = IOHC::iohcRemote1W::getInstance()->findRemote(arg.text)) != nullptr;
+  if (kind == "percent") {
+    uint8_t percent;
+    if (!tokens.percent(idx, percent))
+      return false;
+    arg.number = percent;
+    return true;
   }
-  return nullptr;
+  if (kind == "temp")
+    return tokens.temperature(idx, arg.temperature);
+  if (kind == "int")
+    return tokens.integer(idx, arg.number);
+  if (kind == "addr")
+    return tokens.hexAddress(idx, arg.node);
+  if (kind == "text") {
+    arg.text = tokens.rest(idx);
+    return true;
+  }
+  // Keyword list
+  int32_t choice = 0;
+  bool found = false;
+  splitTokens(kind, '|', [&](std::string_view word) {
+    if (!found && tokens.is(idx, word))
+      found = true;
+    else if (!found)
+      choice++;
+  });
+  arg.number = choice;
+  return found;
+}
+
+static bool parseArgs(const char *schema, const TokenView &tokens, Args &args) {
+  args.tokens = &tokens;
+  args.count = 0;
+  size_t idx = 1;
+  bool ok = true;
+  bool rest = false;
+  splitTokens(schema, ' ', [&](std::string_view kind) {
+    const bool optional = !kind.empty() && kind.back() == '?';
+    if (optional)
+      kind.remove_suffix(1);
+    if (!ok || args.count == CMD_MAX_ARGS || idx >= tokens.size()) {
+      ok = ok && optional && args.count < CMD_MAX_ARGS;
+      return;
+    }
+    ok = parseArg(kind, tokens, idx++, args.arg[args.count]);
+    rest = kind == "text";
+    args.count++;
+  });
+  return ok && (rest || idx == tokens.size());
 }
 
-void cmdFuncHandler() {
-  constexpr char delim = ' ';
-  Tokens segments;
+static Result dispatchLocked(const TokenView &args) {
+  const _cmdEntry *entry = findHandler(args[0].data(), args[0].size());
+  if (!entry)
+    return Result::Unknown;
+  if (!entry->schema) {
+    entry->handler(&args);
+    return Result::Done;
+  }
+  Args parsed;
+  if (!parseArgs(entry->schema, args, parsed)) {
+    Serial.printf("Usage: %s", entry->cmd);
+    splitTokens(entry->schema, ' ', [](std::string_view kind) {
+      if (kind.back() == '?')
+        Serial.printf(" [%.*s]", static_cast<int>(kind.size() - 1), kind.data());
+      else
+        Serial.printf(" <%.*s>", static_cast<int>(kind.size()), kind.data());
+    });
+    Serial.println();
+    return Result::InvalidArgs;
+  }
+  entry->typed(parsed);
+  return Result::Done;
+}
 
-  char *cmd = cmdReceived(true);
-  if (!cmd)
-    return;
-  if (!strlen(cmd))
-    return;
+Result dispatch(const TokenView &args) {
+  if (!_cmdMutex)
+    return dispatchLocked(args);
+  xSemaphoreTakeRecursive(_cmdMutex, portMAX_DELAY);
+  const Result result = dispatchLocked(args);
+  xSemaphoreGiveRecursive(_cmdMutex);
+  return result;
+}
 
-  tokenize(cmd, delim, segments);
-  if (strcmp((char *)"help", segments[0].c_str()) == 0) {
+bool execute(const char *cmd) {
+  // Handlers get views of the receive buffer, nothing is copied
+  const TokenView view(cmd);
+  if (view.empty())
+    return true;
+  if (view[0] == "help") {
     Serial.printf("\nRegistered commands:\n");
-    for (uint8_t idx = 0; idx <= lastEntry; ++idx) {
-      if (_cmdHandler[idx] == nullptr)
-        continue;
-      Serial.printf("- %s\t%s\n", _cmdHandler[idx]->cmd, _cmdHandler[idx]->description);
-    }
+    for (uint8_t idx = 0; idx < _cmdCount; ++idx)
+      Serial.printf("- %s\t%s\n", _cmdEntries[idx].cmd, _cmdEntries[idx].description);
     Serial.printf("- %s\t%s\n\n", (char *)"help", (char *)"This command");
     Serial.printf("\n");
-    return;
+    return true;
   }
-  for (uint8_t idx = 0; idx <= lastEntry; ++idx) {
-    if (_cmdHandler[idx] == nullptr)
-      continue;
-    if (strcmp(_cmdHandler[idx]->cmd, segments[0].c_str()) == 0) {
-      _cmdHandler[idx]->handler(&segments);
-      return;
-    }
+  if (dispatch(view) == Result::Unknown) {
+    Serial.printf("*> Unknown <*\n");
+    return false;
   }
-  Serial.printf("*> Unknown <*\n");
+  return true;
 }
 
-void init() {
-//#if defined(MQTT)
-//initMqtt();
-//#endif
+// Feed one received byte to the line editor. Returns true when a complete
+// line is ready in _line.
+static bool editLine(char c) {
+  if (_escape) {
+    // ESC [ <final>: arrow keys and friends are ignored
+    if (_escape == 2 && c != '[')
+      _escape = 0;
+    else if (_escape == 1 && (c < 0x40 || c > 0x7e))
+      return false; // parameter bytes, wait for the final byte
+    else
+      _escape--;
+    return false;
+  }
 
-//  initWifi();
+  const bool wasCR = _lastWasCR;
+  _lastWasCR = c == '\r';
+  switch (c) {
+    case '\n':
+      if (wasCR)
+        return false; // second half of CRLF
+      // fall through
+    case '\r':
+      Serial.print("\r\n");
+      _line[_lineLen] = '\0';
+      _lineLen = 0;
+      return true;
+    case '\b':
+    case 0x7f:
+      if (_lineLen) {
+        _lineLen--;
+        Serial.print("\b \b");
+      }
+      return false;
+    case 0x03: // Ctrl-C drops the line
+      _lineLen = 0;
+      Serial.print("^C\r\n");
+      return false;
+    case 0x15: // Ctrl-U erases the line
+      while (_lineLen) {
+        _lineLen--;
+        Serial.print("\b \b");
+      }
+      return false;
+    case 0x17: // Ctrl-W erases the last word
+      while (_lineLen && _line[_lineLen - 1] == ' ') {
+        _lineLen--;
+        Serial.print("\b \b");
+      }
+      while (_lineLen && _line[_lineLen - 1] != ' ') {
+        _lineLen--;
+        Serial.print("\b \b");
+      }
+      return false;
+    case 0x1b:
+      _escape = 2;
+      return false;
+    default:
+      break;
+  }
+  if (static_cast<uint8_t>(c) < 0x20)
+    return false;
+  if (_lineLen >= CONSOLE_LINE_MAX) {
+    Serial.print('\a'); // line full, drop the character
+    return false;
+  }
+  _line[_lineLen++] = c;
+  Serial.print(c);
+  return false;
+}
 
-  kbd_tick.attach_ms(500, cmdFuncHandler);
+static void consoleTask(void *) {
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(CONSOLE_IDLE_POLL_MS));
+    int c;
+    while ((c = Serial.read()) >= 0) {
+      if (editLine(static_cast<char>(c)))
+        execute(_line);
+    }
+  }
+}
+
+void init() {
+  if (_consoleTask)
+    return;
+  if (xTaskCreatePinnedToCore(consoleTask, "console", 8192, nullptr, 1, &_consoleTask, tskNO_AFFINITY) != pdPASS) {
+    Serial.println("Failed to create console task");
+    _consoleTask = nullptr;
+    return;
+  }
+  // Wake the console task from the UART event, no polling in between
+  Serial.onReceive([]() {
+    if (_consoleTask)
+      xTaskNotifyGive(_consoleTask);
+  });
 }
 }
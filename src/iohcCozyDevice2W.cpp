@@ -74,7 +74,7 @@ namespace IOHC {
     }
 
     /// Emulates device button press
-    void iohcCozyDevice2W::cmd(DeviceButton cmd, Tokens *data) {
+    void iohcCozyDevice2W::cmd(DeviceButton cmd, const CozyArgs &args) {
         if (!_radioInstance) {
             Serial.println("NO RADIO INSTANCE");
             _radioInstance = IOHC::iohcRadio::getInstance();
@@ -124,13 +124,13 @@ namespace IOHC {
             case DeviceButton::setTemp: {
                 std::vector<uint8_t> toSend = {0x0C, 0x61, 0x01, 0x03, 0xFF, 0x00};
 
-                int temp = 10 * std::stof(data->at(1));
+                if (args.device >= addresses.size()) {
+                    Serial.printf("setTemp: no device %u\n", static_cast<unsigned>(args.device));
+                    break;
+                }
+                int temp = 10 * args.temperature;
                 toSend[4] = temp;
 
-                int addr = 0;
-                if (data->size() == 2) addr = 0;
-                else addr = std::stoi(data->at(2));
-
                 auto* packet = new iohcPacket;
                 forgePacket(packet, toSend);
 
@@ -141,7 +141,7 @@ namespace IOHC {
                 packet->payload.packet.header.CtrlByte1.asStruct.StartFrame = 1;
 
                 memcpy(packet->payload.packet.header.source, gateway, 3);
-                memcpy(packet->payload.packet.header.target, addresses.at(addr).data()/* 0 Master_to*/, 3);
+                memcpy(packet->payload.packet.header.target, addresses.at(args.device).data()/* 0 Master_to*/, 3);
 
                 packet->delayed = 50;
 
@@ -152,14 +152,9 @@ namespace IOHC {
                 break;
             }
             case DeviceButton::setMode: {
-                std::vector<uint8_t> toSend = {0x0C, 0x61, 0x01, 0x00, 0xFF};
-
-                const char *dat = data->at(1).c_str();
-                if (strcasecmp(dat, "auto") == 0) toSend[4] = 0x00;
-                if (strcasecmp(dat, "manual") == 0) toSend[4] = 0x01;
-                if (strcasecmp(dat, "prog") == 0) toSend[4] = 0x02;
-                // if (strcasecmp(data, "special") == 0) toSend[4] = 0x03;
-                if (strcasecmp(dat, "off") == 0) toSend[4] = 0x04; // TODO if mode off, disable setPresence
+                std::vector<uint8_t> toSend = {0x0C, 0x61, 0x01, 0x00, static_cast<uint8_t>(args.mode)};
+                // 0x03 would be "special"
+                // TODO if mode off, disable setPresence
 
                 // int addr = 0;
                 // if (data->size() == 2) addr = 0;
@@ -192,11 +187,7 @@ namespace IOHC {
                 break;
             }
             case DeviceButton::setPresence: {
-                std::vector<uint8_t> toSend = {0x0C, 0x61, 0x01, 0x10, 0xFF};
-
-                const char *dat = data->at(1).c_str();
-                if (strcasecmp(dat, "on") == 0) toSend[4] = 0x01;
-                if (strcasecmp(dat, "off") == 0) toSend[4] = 0x00;
+                std::vector<uint8_t> toSend = {0x0C, 0x61, 0x01, 0x10, static_cast<uint8_t>(args.on ? 0x01 : 0x00)};
 
                 auto* packet = new iohcPacket;
                 forgePacket(packet, toSend);
@@ -215,15 +206,12 @@ namespace IOHC {
                 break;
             }
             case DeviceButton::setWindow: {
-                std::vector<uint8_t> toSend = {0x0C, 0x61, 0x01, 0x0E, 0xFF};
-
-                const char *dat = data->at(1).c_str();
-                if (strcasecmp(dat, "open") == 0) toSend[4] = 0x01;
-                if (strcasecmp(dat, "close") == 0) toSend[4] = 0x00;
+                std::vector<uint8_t> toSend = {0x0C, 0x61, 0x01, 0x0E, static_cast<uint8_t>(args.on ? 0x01 : 0x00)};
 
-                int addr = 0;
-                if (data->size() == 2) addr = 0;
-                else addr = std::stoi(data->at(2));
+                if (args.device >= addresses.size()) {
+                    Serial.printf("setWindow: no device %u\n", static_cast<unsigned>(args.device));
+                    break;
+                }
 
                 auto* packet = new iohcPacket;
                 forgePacket(packet, toSend);
@@ -235,7 +223,7 @@ namespace IOHC {
                 packet->payload.packet.header.CtrlByte1.asStruct.StartFrame = 1;
 
                 memcpy(packet->payload.packet.header.source, gateway, 3);
-                memcpy(packet->payload.packet.header.target, addresses.at(addr).data()/* 0 Master_to*/, 3);
+                memcpy(packet->payload.packet.header.target, addresses.at(args.device).data()/* 0 Master_to*/, 3);
 
                 packet->delayed = 50;
 
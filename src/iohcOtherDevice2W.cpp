@@ -70,7 +70,7 @@ namespace IOHC {
         packet->lock = false;
     }
 
-    void iohcOtherDevice2W::cmd(Other2WButton cmd, Tokens *data) {
+    void iohcOtherDevice2W::cmd(Other2WButton cmd, const Other2WArgs &args) {
         if (!_radioInstance) {
             Serial.println("NO RADIO INSTANCE");
             _radioInstance = iohcRadio::getInstance();
@@ -105,11 +105,6 @@ namespace IOHC {
 
                 // const char* dat = data->at(1).c_str();
 
-                int value = std::stol(data->at(1).c_str(), nullptr, 16);
-                address target;
-                target[0] = static_cast<uint8_t>(value >> 16);
-                target[1] = static_cast<uint8_t>(value >> 8);
-                target[2] = static_cast<uint8_t>(value);
                 // uint8_t target[3] = {0x08, 0x42, 0xE3};
                 // toSend[3] = custom;
 
@@ -123,7 +118,7 @@ namespace IOHC {
 //                packet->payload.packet.header.CtrlByte1.asByte += toSend.size();
 
                 memcpy(packet->payload.packet.header.source, fake_gateway, 3);
-                memcpy(packet->payload.packet.header.target, target, 3);
+                memcpy(packet->payload.packet.header.target, args.target, 3);
 
 //                memcpy(packet->payload.buffer + 9, toSend.data(), toSend.size());
 //                packet->buffer_length = toSend.size() + 9;
@@ -177,12 +172,8 @@ namespace IOHC {
             case Other2WButton::custom60: {
                 std::vector<uint8_t> toSend = {0x0C, 0x60, 0x01, 0xFF};
                 // Accepted command {0x0C, 0x61, 0x01, 0xFF, FF};
-                const char *dat = data->at(1).c_str();
-
                 //                for (int custom = 0; custom < 256; custom++) {
-                int custom = std::stoi(data->at(1));
-
-                toSend[3] = custom; //custom;
+                toSend[3] = args.command; //custom;
 
                 auto *packet = new iohcPacket;
                 forgePacket(packet, toSend);
@@ -18,10 +18,14 @@
 #include <map>
 #include "esp_log.h"
 #include <queue>
+#include <algorithm>
+#include <cstring>
 
 #include <iohcRadio.h>
 #include <utility>
 #include <log_buffer.h>
+#include <logger.h>
+#include <latency_metrics.h>
 #define LONG_PREAMBLE_MS 1920
 #define SHORT_PREAMBLE_MS 40
 
@@ -35,34 +39,64 @@ namespace IOHC {
 
 
     TaskHandle_t handle_interrupt;
+    // Notification bits of handle_interrupt_task
+    constexpr uint32_t EVENT_EDGE = 0x01;       // DIO edge, time in lastEdgeUs
+    constexpr uint32_t EVENT_DEADLINE = 0x02;   // deadlineTimer expired
+    constexpr uint32_t EVENT_RESUME = 0x04;     // back to scanning (start, end of TX)
+    constexpr uint32_t EVENT_TX_DONE = 0x08;    // the edge also flagged txComplete, logged by the task
+    volatile uint32_t lastEdgeUs = 0;
+    volatile uint32_t txDoneUs = 0;             // last TX done interrupt, for the batch start spread
+    uint32_t lastWakeUs = 0;                    // handle_interrupt_task woke up, for the RX latency
+    portMUX_TYPE ownFrameMux = portMUX_INITIALIZER_UNLOCKED;
+    constexpr uint32_t OWN_FRAME_WINDOW_MS = 1000;
+
+    // Low 32 bits of the esp_timer clock: differences stay exact across the wrap
+    inline uint32_t IRAM_ATTR nowUs() {
+        return static_cast<uint32_t>(esp_timer_get_time());
+    }
+
+#if defined(DUAL_RADIO)
+    // The secondary radio transmits; the primary never leaves RX and keeps scanning during a batch
+    constexpr Radio::Device TX_DEVICE = Radio::Device::Secondary;
+    constexpr bool DEDICATED_TX = true;
+#else
+    constexpr Radio::Device TX_DEVICE = Radio::Device::Primary;
+    constexpr bool DEDICATED_TX = false;
+#endif
+
+    // radioState describes the receiver; a dedicated transmitter leaves it alone
+    inline void enterTxState() {
+        if (!DEDICATED_TX) iohcRadio::setRadioState(iohcRadio::RadioState::TX);
+    }
     TaskHandle_t callbackTask = NULL;
-    QueueHandle_t callbackQueue = NULL;
-    struct Callback {
+    // Passed by value: no allocation per frame, the packet itself is handed over
+    struct CallbackMessage {
         IohcPacketDelegate *callback;
         iohcPacket *packet;
+        bool received;
     };
+    constexpr uint8_t CALLBACK_LANES = static_cast<uint8_t>(CallbackLane::Count);
+    constexpr uint8_t CALLBACK_DEPTHS[CALLBACK_LANES] = {CALLBACK_HIGH_DEPTH, CALLBACK_LOW_DEPTH};
+    QueueHandle_t callbackLanes[CALLBACK_LANES]{};
+    CallbackLaneStats callbackLaneStats[CALLBACK_LANES]{};
+    portMUX_TYPE callbackMux = portMUX_INITIALIZER_UNLOCKED;
 
 
     /**
-     * The function `handle_interrupt_task` waits for a notification and then calls the `tickerCounter`
-     * function if certain conditions are met.
+     * The function `handle_interrupt_task` runs the RX state machine. It sleeps until a DIO edge,
+     * a deadline of the state machine or a resume request, so it does not wake up while the air is quiet
+     * other than to hop.
      *
-     * @param pvParameters The `pvParameters` parameter in the `handle_interrupt_task` function is a void
-     * pointer that can be used to pass any data or object to the task when it is created. In this specific
-     * function, it is being cast to a pointer of type `iohcRadio` and then passed to the
+     * @param pvParameters The `iohcRadio` instance.
      */
     void IRAM_ATTR handle_interrupt_task(void *pvParameters) {
-        static uint32_t thread_notification;
-        const TickType_t xMaxBlockTime = pdMS_TO_TICKS(655 * 4); // 218.4 );
+        uint32_t events = 0;
         while (true) {
-            thread_notification = ulTaskNotifyTake(pdTRUE, xMaxBlockTime/*xNoDelay*/); // Attendre la notification
-            if (thread_notification &&
-                (iohcRadio::radioState == iohcRadio::RadioState::PAYLOAD ||
-                 iohcRadio::radioState == iohcRadio::RadioState::PREAMBLE)) {
-                iohcRadio::tickerCounter((iohcRadio *) pvParameters);
+            if (xTaskNotifyWait(0, UINT32_MAX, &events, portMAX_DELAY) == pdTRUE) {
+                Radio::DeviceScope scope(Radio::Device::Primary, Radio::SpiPath::Rx);
+                iohcRadio::processEvents((iohcRadio *) pvParameters, events);
             }
         }
-
     }
 
     /**
@@ -70,10 +104,13 @@ namespace IOHC {
      * the interrupt service routine is complete.
      */
     void IRAM_ATTR handle_interrupt_fromisr() {
+        lastEdgeUs = nowUs();
         bool preamble = digitalRead(RADIO_PREAMBLE_DETECTED);
         bool payload = digitalRead(RADIO_PACKET_AVAIL);
-        iohcRadio::txComplete = true;
-        ets_printf("TX: TX-RX DONE detected, flag set\n");
+        if (!DEDICATED_TX) {
+            txDoneUs = lastEdgeUs;
+            iohcRadio::txComplete = true;
+        }
 
 
         if (payload) {
@@ -95,30 +132,59 @@ namespace IOHC {
 
         // Notify de RX state machine
         BaseType_t xHigherPriorityTaskWoken = pdFALSE;
-        vTaskNotifyGiveFromISR(handle_interrupt, &xHigherPriorityTaskWoken);
+        xTaskNotifyFromISR(handle_interrupt, DEDICATED_TX ? EVENT_EDGE : EVENT_EDGE | EVENT_TX_DONE, eSetBits,
+                           &xHigherPriorityTaskWoken);
         portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
     }
 
+#if defined(DUAL_RADIO)
+    /**
+     * DIO0 of the secondary radio: PacketSent, the only interrupt it raises.
+     */
+    void IRAM_ATTR handle_tx_interrupt_fromisr() {
+        txDoneUs = nowUs();
+        iohcRadio::txComplete = true;
+    }
+#endif
+
+    /**
+     * Delivers queued frames to their callback, re-checking the High lane before every Low message.
+     * Producers notify the task after queueing.
+     */
     void callbackTaskLoop(void *parameters) {
-        Callback *callback = NULL;
+        CallbackMessage message{};
+        QueueHandle_t high = callbackLanes[static_cast<uint8_t>(CallbackLane::High)];
+        QueueHandle_t low = callbackLanes[static_cast<uint8_t>(CallbackLane::Low)];
         while (true) {
-            if (xQueueReceive(callbackQueue, &callback, portMAX_DELAY) == pdPASS && callback != NULL) {
-                (*callback->callback)(callback->packet);
-                delete callback->packet;
-                vPortFree(callback);
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            while (xQueueReceive(high, &message, 0) == pdPASS || xQueueReceive(low, &message, 0) == pdPASS) {
+                if (message.received) recordLatency(LatencyStage::RxDequeued, message.packet->stampUs);
+                (*message.callback)(message.packet);
+                if (message.received) recordLatency(LatencyStage::RxHandled, message.packet->stampUs);
+                delete message.packet;
             }
         }
     }
 
     iohcRadio::iohcRadio() {
         Radio::initHardware();
-        Radio::calibrate();
-
-        Radio::initRegisters(MAX_FRAME_LEN);
-        Radio::setCarrier(Radio::Carrier::Deviation, 19200);
-        Radio::setCarrier(Radio::Carrier::Bitrate, 38400);
-        Radio::setCarrier(Radio::Carrier::Bandwidth, 250);
-        Radio::setCarrier(Radio::Carrier::Modulation, Radio::Modulation::FSK);
+#if defined(DUAL_RADIO)
+        Radio::initSecondaryHardware();
+        const Radio::Device devices[] = {Radio::Device::Primary, Radio::Device::Secondary};
+#else
+        const Radio::Device devices[] = {Radio::Device::Primary};
+#endif
+        // Both radios get the same modem configuration
+        for (const auto device : devices) {
+            Radio::DeviceScope scope(device);
+            Radio::calibrate();
+
+            Radio::initRegisters(MAX_FRAME_LEN);
+            Radio::setCarrier(Radio::Carrier::Deviation, 19200);
+            Radio::setCarrier(Radio::Carrier::Bitrate, 38400);
+            Radio::setCarrier(Radio::Carrier::Bandwidth, 250);
+            Radio::setCarrier(Radio::Carrier::Modulation, Radio::Modulation::FSK);
+        }
 
         // Attach interrupts to Preamble detected and end of packet sent/received
         /* TODO this is wrongly named and/or assigned, but work like that*/
@@ -130,25 +196,31 @@ namespace IOHC {
         attachInterrupt(RADIO_DIO0_PIN, handle_interrupt_fromisr, RISING); //CHANGE); //
         //        attachInterrupt(RADIO_DIO1_PIN, handle_interrupt_fromisr, RISING); // CHANGE); //
         attachInterrupt(RADIO_DIO2_PIN, handle_interrupt_fromisr, RISING); //CHANGE); //
+#if defined(DUAL_RADIO)
+        attachInterrupt(RADIO2_DIO0_PIN, handle_tx_interrupt_fromisr, RISING);
+#endif
 #elif defined(CC1101)
         attachInterrupt(RADIO_PREAMBLE_DETECTED, i_preamble, RISING);
 #endif
 
-        callbackQueue = xQueueCreate(20, sizeof(struct Callback *));
+        for (uint8_t lane = 0; lane < CALLBACK_LANES; ++lane) {
+            callbackLanes[lane] = xQueueCreate(CALLBACK_DEPTHS[lane], sizeof(CallbackMessage));
+            callbackLaneStats[lane].capacity = CALLBACK_DEPTHS[lane];
+        }
         auto callbackTaskCode = xTaskCreatePinnedToCore(callbackTaskLoop, "CallbackTask", 4096, NULL, 5, &callbackTask, 0);
-        if (callbackTaskCode != pdPASS || callbackQueue == NULL) {
-            printf("ERROR: Can't create callback-task or corresponding queue %d\n", callbackTaskCode);
+        if (callbackTaskCode != pdPASS || !callbackLanes[0] || !callbackLanes[1]) {
+            LOG_E(Radio, "Can't create callback-task or corresponding queue %d", callbackTaskCode);
             // sx127x_destroy(device);
             return;
         }
 
         // start state machine
-        printf("Starting Interrupt Handler...\n");
+        LOG_I(Radio, "Starting Interrupt Handler...");
         BaseType_t task_code = xTaskCreatePinnedToCore(handle_interrupt_task, "handle_interrupt_task", 8192,
                                                        this /*nullptr*//*device*/, /*tskIDLE_PRIORITY*/4,
                                                        &handle_interrupt, /*tskNO_AFFINITY*/xPortGetCoreID());
         if (task_code != pdPASS) {
-            printf("ERROR STATEMACHINE Can't create task %d\n", task_code);
+            LOG_E(Radio, "STATEMACHINE Can't create task %d", task_code);
             // sx127x_destroy(device);
             return;
         }
@@ -191,98 +263,190 @@ namespace IOHC {
         this->num_freqs = num_freqs;
         this->scan_freqs = scan_freqs;
         this->scanTimeUs = scanTimeUs ? scanTimeUs : DEFAULT_SCAN_INTERVAL_US;
+        this->scanScheduler.begin(num_freqs, this->scanTimeUs);
+        this->dwellUs = this->scanScheduler.first().dwellUs;
         this->rxCB = std::move(rxCallback);
         this->txCB = std::move(txCallback);
 
+        buildCarrierTable();
+
         Radio::clearBuffer();
         Radio::clearFlags();
         /* We always start at freq[0] the 1W/2W channel*/
-        Radio::setCarrier(Radio::Carrier::Frequency, scan_freqs[0]); //868950000);
+        tune(scan_freqs[0]); //868950000);
         // Radio::calibrate();
         Radio::setRx();
+        setRadioState(RadioState::RX);
+        xTaskNotify(handle_interrupt, EVENT_RESUME, eSetBits);
     }
 
 /**
- * The `tickerCounter` function in C++ handles various radio operations based on different conditions
- * and configurations for SX127X and CC1101 radios.
- * 
- * @param radio The `radio` parameter in the `iohcRadio::tickerCounter` function is a pointer to an
- * instance of the `iohcRadio` class. This pointer is used to access and modify the properties and
- * methods of the `iohcRadio` object within the function. The function uses this pointer
- * 
- * @return In the provided code snippet, the function `tickerCounter` is returning different values
- * based on the conditions met within the function. Here is a breakdown of the possible return
- * scenarios:
+ * Compute the FRF register bytes of every scan channel, in scan order, and of the
+ * TX channels that are not scanned, so hops and TX never convert a frequency again.
+ */
+    void iohcRadio::buildCarrierTable() {
+        const uint32_t txFreqs[] = {CHANNEL1, CHANNEL2, CHANNEL3};
+        numCarriers = 0;
+        for (uint8_t i = 0; i < num_freqs && numCarriers < iohcScanScheduler::MAX_CHANNELS; ++i)
+            carriers[numCarriers++] = Radio::frequencyRegs(scan_freqs[i]);
+        for (uint32_t freq : txFreqs) {
+            bool known = false;
+            for (uint8_t i = 0; i < numCarriers && !known; ++i)
+                known = carriers[i].frequency == freq;
+            if (!known && numCarriers < MAX_CARRIERS)
+                carriers[numCarriers++] = Radio::frequencyRegs(freq);
+        }
+        tunedFrequency[0] = tunedFrequency[1] = 0;
+    }
+
+/**
+ * Switch the carrier of the selected radio to `frequency`, using the precomputed registers when the
+ * frequency is in the table. Does nothing when the radio is already tuned to it.
+ */
+    void IRAM_ATTR iohcRadio::tune(uint32_t frequency) {
+        uint32_t &tuned = tunedFrequency[static_cast<uint8_t>(Radio::currentDevice())];
+        if (frequency == tuned) return;
+        tuned = frequency;
+        for (uint8_t i = 0; i < numCarriers; ++i) {
+            if (carriers[i].frequency == frequency) {
+                Radio::setFrequency(carriers[i]);
+                return;
+            }
+        }
+        Radio::setFrequency(Radio::frequencyRegs(frequency));
+    }
+
+/**
+ * The `processEvents` function runs the RX state machine for the notification bits collected by
+ * `handle_interrupt_task`: DIO edges (timestamped in the ISR), expiry of the single deadline timer and
+ * resume requests. Timeouts are measured from those timestamps rather than counted in ticks.
+ *
+ * @param radio The `iohcRadio` instance.
+ * @param events EVENT_* bits.
  */
-    void IRAM_ATTR iohcRadio::tickerCounter(iohcRadio *radio) {
-        // Not need to put in IRAM as we reuse task for µs instead ISR
+    void IRAM_ATTR iohcRadio::processEvents(iohcRadio *radio, uint32_t events) {
+        lastWakeUs = nowUs();
 #if defined(RADIO_SX127X)
-        Radio::readBytes(REG_IRQFLAGS1, _flags, sizeof(_flags));
+        if (events & EVENT_TX_DONE) {
+            LOG_V(Radio, "TX: TX-RX DONE detected, flag set");
+        }
+        if (events & EVENT_EDGE) {
+            ++radio->rxStats.edges;
+            radio->onEdge(lastEdgeUs);
+        }
+        if (events & EVENT_RESUME) {
+            radio->armHop(nowUs());
+        }
+        if (events & EVENT_DEADLINE) {
+            ++radio->rxStats.deadlines;
+            radio->onDeadline(nowUs());
+        }
+#elif defined(CC1101)
+        if (__g_preamble){
+            radio->receive();
+            return;
+        }
+#endif
+    }
 
-        // If Int of PayLoad
-        if (radioState == iohcRadio::RadioState::PAYLOAD) {
+    void IRAM_ATTR iohcRadio::onEdge(uint32_t edgeUs) {
+        if (radioState == RadioState::PAYLOAD) {
+            Radio::readBytes(REG_IRQFLAGS1, _flags, sizeof(_flags));
             // if TX ready?
             if (_flags[0] & RF_IRQFLAGS1_TXREADY) {
                 Radio::clearFlags();
-                if (radioState != iohcRadio::RadioState::TX) {
+                if (radioState != RadioState::TX) {
                     Radio::setRx();
-                    radio->setRadioState(iohcRadio::RadioState::RX);
+                    setRadioState(RadioState::RX);
                 }
-                // radio->sent(radio->packets2send[radio->txCounter]); // Put after Workaround to permit MQTT sending. No more needed
+                // Scanning resumes with EVENT_RESUME once the whole batch is sent
                 return;
             }
             // if in RX mode?
-            radio->receive(false);
+            receive();
             Radio::clearFlags();
-            radio->tickCounter = 0;
-            radio->preCounter = 0;
+            setRadioState(RadioState::RX);
+            // A fresh dwell on the channel that just carried a frame
+            armHop(edgeUs);
             return;
         }
 
-        if (radioState == iohcRadio::RadioState::PREAMBLE) {
-            radio->tickCounter = 0;
-            radio->preCounter = radio->preCounter + 1;
-            //radio->preCounter += 1;
-
-            //            if (_flags[0] & RF_IRQFLAGS1_SYNCADDRESSMATCH) radio->preCounter = 0;
-            // In case of Sync received resets the preamble duration
-            if ((radio->preCounter * SM_GRANULARITY_US) >= SM_PREAMBLE_RECOVERY_TIMEOUT_US) {
-                // Avoid hanging on a too long preamble detect
-                Radio::clearFlags();
-                radio->preCounter = 0;
+        if (radioState == RadioState::PREAMBLE) {
+            if (deadlineKind != Deadline::PreambleRecovery) {
+                preambleStartUs = edgeUs;
+                scanScheduler.recordPreamble(currentFreqIdx);
+                scheduleDeadline(edgeUs + SM_PREAMBLE_RECOVERY_TIMEOUT_US, Deadline::PreambleRecovery);
             }
+            return;
         }
 
-        if (radioState != iohcRadio::RadioState::RX) return;
-
-        //if (++radio->tickCounter * SM_GRANULARITY_US < radio->scanTimeUs) return;
-        radio->tickCounter = radio->tickCounter + 1;
-        if (radio->tickCounter * SM_GRANULARITY_US < radio->scanTimeUs) return;
+        // Preamble gone without a payload
+        if (radioState == RadioState::RX && deadlineKind == Deadline::PreambleRecovery)
+            armHop(edgeUs);
+    }
 
-        radio->tickCounter = 0;
+    void IRAM_ATTR iohcRadio::onDeadline(uint32_t now) {
+        // A deadline moved after the timer had already fired
+        if (deadlineKind == Deadline::None || static_cast<int32_t>(now - deadlineUs) < 0) {
+            ++rxStats.stale;
+            return;
+        }
+        const Deadline kind = deadlineKind;
+        const uint32_t due = deadlineUs;
+        deadlineKind = Deadline::None;
+
+        if (kind == Deadline::PreambleRecovery) {
+            if (radioState != RadioState::PREAMBLE) return;
+            // Keep listening while a carrier is present: 1W long preambles last up to 1.9 s
+            Radio::readBytes(REG_IRQFLAGS1, _flags, sizeof(_flags));
+            if ((_flags[0] & RF_IRQFLAGS1_RSSI) && now - preambleStartUs < SM_PREAMBLE_MAX_US) {
+                scheduleDeadline(now + SM_PREAMBLE_RECOVERY_TIMEOUT_US, Deadline::PreambleRecovery);
+                return;
+            }
+            // Avoid hanging on a preamble that never turned into a frame
+            ++rxStats.preambleTimeouts;
+            Radio::clearFlags();
+            setRadioState(RadioState::RX);
+            armHop(now);
+            return;
+        }
 
-        if (radio->num_freqs == 1) return;
+        // No hopping during a TX batch; EVENT_RESUME restarts it
+        if (radioState != RadioState::RX || (txActive && !DEDICATED_TX)) return;
 
-        radio->currentFreqIdx += 1;
-        if (radio->currentFreqIdx >= radio->num_freqs)
-            radio->currentFreqIdx = 0;
+        const ScanHop hop = scanScheduler.next();
+        currentFreqIdx = hop.channel;
+        dwellUs = hop.dwellUs;
 
-        Radio::setCarrier(Radio::Carrier::Frequency, radio->scan_freqs[radio->currentFreqIdx]);
+        // Scan channels sit at their own index in the table: one burst write, no lookup
+        tunedFrequency[0] = carriers[hop.channel].frequency;
+        Radio::setFrequency(carriers[hop.channel]);
 
-#elif defined(CC1101)
-        if (__g_preamble){
-            radio->receive();
-            radio->tickCounter = 0;
-            radio->preCounter = 0;
-            return;
-        }
+        // The next dwell counts from this deadline, not from when the task got to run
+        uint32_t next = due + hop.dwellUs;
+        if (static_cast<int32_t>(next - now) <= 0) next = now + hop.dwellUs;
+        scheduleDeadline(next, Deadline::Hop);
+    }
 
-        if (radioState != iohcRadio::RadioState::RX)
-            return;
+    void IRAM_ATTR iohcRadio::armHop(uint32_t fromUs) {
+        if (num_freqs > 1 && (!txActive || DEDICATED_TX))
+            scheduleDeadline(fromUs + dwellUs, Deadline::Hop);
+        else
+            scheduleDeadline(0, Deadline::None);
+    }
 
-        if ((++radio->tickCounter * SM_GRANULARITY_US) < radio->scanTimeUs)
-            return;
-#endif
+    /**
+     * Arm the single deadline timer. Only called from `handle_interrupt_task`, which owns the
+     * deadline state.
+     */
+    void IRAM_ATTR iohcRadio::scheduleDeadline(uint32_t atUs, Deadline kind) {
+        timerCancel(deadlineTimer);
+        deadlineKind = kind;
+        deadlineUs = atUs;
+        if (kind == Deadline::None) return;
+        const int32_t delay = static_cast<int32_t>(atUs - nowUs());
+        deadlineTimer = timerOnce("radio_deadline", delay > 0 ? delay : 1,
+                                  [] { xTaskNotify(handle_interrupt, EVENT_DEADLINE, eSetBits); });
     }
 
     /**
@@ -308,45 +472,190 @@ namespace IOHC {
     }
     */
 
-void iohcRadio::queueSend(std::vector<iohcPacket *> &iohcTx) {
+void iohcRadio::queueSend(std::vector<iohcPacket *> &iohcTx, bool interleaved) {
     if (iohcTx.empty()) {
         return;
     }
-    sendQueue.push(std::move(iohcTx));
-    ets_printf("TX: Queued send batch. Queue depth=%d\n", static_cast<int>(sendQueue.size()));
+    sendQueue.push({std::move(iohcTx), interleaved});
+    LOG_D(Radio, "TX: Queued send batch. Queue depth=%d", static_cast<int>(sendQueue.size()));
+}
+
+/**
+ * True when the receiver picked up a frame the transmitter sent within the last OWN_FRAME_WINDOW_MS.
+ */
+bool iohcRadio::isOwnFrame(const iohcPacket *packet) {
+    portENTER_CRITICAL(&ownFrameMux);
+    const bool own = ownFrameLen == packet->buffer_length &&
+                     static_cast<int32_t>(ownFrameUntilMs - millis()) > 0 &&
+                     memcmp(ownFrame, packet->payload.buffer, ownFrameLen) == 0;
+    portEXIT_CRITICAL(&ownFrameMux);
+    return own;
+}
+
+/**
+ * Load the current packet in the FIFO and start transmitting it. Keeps track of the first
+ * transmission of every frame of the batch to report the start spread.
+ */
+void iohcRadio::transmit(iohcPacket *packet) {
+    Radio::setStandby();
+    Radio::clearFlags();
+    // Only PacketSent of this frame may complete it: during CCA the dedicated transmitter listens, and
+    // a frame it decoded there raised DIO0 as well
+    txComplete = false;
+    if (packet->frequency) tune(packet->frequency);
+    Radio::writeBytes(REG_FIFO, packet->payload.buffer, packet->buffer_length);
+    Radio::setTx();
+    txTransmissions++;
+    lastTxMs = millis();
+
+    if (DEDICATED_TX) {
+        portENTER_CRITICAL(&ownFrameMux);
+        ownFrameLen = std::min<uint8_t>(packet->buffer_length, MAX_FRAME_LEN);
+        memcpy(ownFrame, packet->payload.buffer, ownFrameLen);
+        ownFrameUntilMs = millis() + OWN_FRAME_WINDOW_MS;
+        portEXIT_CRITICAL(&ownFrameMux);
+    }
+
+    if (txCounter >= txFirstSeen) {
+        recordLatency(LatencyStage::TxFirst, packet->stampUs);
+        if (txFirstSeen == 0) {
+            txFirstUs = esp_timer_get_time();
+        }
+        txFirstSeen = txCounter + 1;
+        txAwaitingFirstDone = true;
+    }
 }
 
 void iohcRadio::startQueuedSend() {
-    if (radioState == RadioState::TX || packets2send.size() > 0 || sendQueue.empty()) {
+    if (txActive || packets2send.size() > 0 || sendQueue.empty()) {
         return;
     }
+    Radio::DeviceScope scope(TX_DEVICE, Radio::SpiPath::Tx);
 
-    packets2send = std::move(sendQueue.front());
+    packets2send = std::move(sendQueue.front().packets);
+    txInterleaved = sendQueue.front().interleaved;
     sendQueue.pop();
     txCounter = 0;
+    txRemaining = packets2send.size();
+    txFirstSeen = 0;
+    txAwaitingFirstDone = false;
     txComplete = false;
-    ets_printf("TX: Preparing %d packet(s)\n", packets2send.size());
-    setRadioState(RadioState::TX);
+    txActive = true;
+    LOG_D(Radio, "TX: Preparing %u packet(s)%s", static_cast<unsigned>(packets2send.size()), txInterleaved ? " interleaved" : "");
+    enterTxState();
+
+    if (lbtEnabled) {
+        // Listen on the TX channel first; sendFirst() runs from onCcaTicker once it is clear
+        tune(packets2send[txCounter]->frequency);
+        if (DEDICATED_TX) Radio::setRx();
+        ccaStartUs = esp_timer_get_time();
+        ccaClearSamples = 0;
+        ccaBackoff = 0;
+        ccaDeferred = false;
+        lbt.assessments++;
+        txTimer = timerEvery("radio_cca", LBT_SAMPLE_US, [this] { onCcaTicker(this); });
+        return;
+    }
+    sendFirst();
+}
 
+/**
+ * Start the current batch: first frame with the long preamble, then the repeat ticker.
+ */
+void iohcRadio::sendFirst() {
+    enterTxState();
     auto packet = packets2send[txCounter];
 
     // 🟢 Set long preamble for first packet
     Radio::setPreambleLength(LONG_PREAMBLE_MS);
-    ets_printf("TX: Using LONG preamble (%d ms)\n", LONG_PREAMBLE_MS);
+    LOG_D(Radio, "TX: Using LONG preamble (%d ms)", LONG_PREAMBLE_MS);
 
     // Send first packet immediately
-    Radio::setStandby();
-    Radio::clearFlags();
-    Radio::writeBytes(REG_FIFO, packet->payload.buffer, packet->buffer_length);
-    Radio::setTx();
+    transmit(packet);
     //packetStamp = esp_timer_get_time();
     //packet->decode(true); //false);
     //IOHC::lastSendCmd = packet->payload.packet.header.cmd;
 
-    ets_printf("TX: Sent first packet (%d repeats) at %llu us\n", packet->repeat, esp_timer_get_time());
+    LOG_D(Radio, "TX: Sent first packet (%d repeats) at %lld us", packet->repeat, esp_timer_get_time());
 
     // Start ticker for repeats (short preamble)
-    Sender.attach_ms(packet->repeatTime, &iohcRadio::onTxTicker, (void*)this);
+    timerCancel(txTimer);
+    txTimer = timerEvery("radio_tx", packet->repeatTime * 1000ULL, [this] { onTxTicker(this); });
+}
+
+/**
+ * A preamble being received or an RSSI above LBT_RSSI_THRESHOLD_DBM means another
+ * transmitter is on the air.
+ */
+bool IRAM_ATTR iohcRadio::channelBusy() {
+    // The receiver state only describes the TX channel when both share one radio
+    if (!DEDICATED_TX && radioState == RadioState::PREAMBLE) return true;
+    const int16_t rssi = -static_cast<int16_t>(Radio::readByte(REG_RSSIVALUE)) / 2;
+    return rssi > LBT_RSSI_THRESHOLD_DBM;
+}
+
+/**
+ * Clear channel assessment, every LBT_SAMPLE_US while a batch waits. The channel has to be
+ * clear for LBT_WINDOW_US in a row; a busy sample restarts the window after a random backoff.
+ * After LBT_MAX_WAIT_US the batch is sent regardless.
+ */
+void IRAM_ATTR iohcRadio::onCcaTicker(void *arg) {
+    auto *radio = (iohcRadio *)arg;
+    Radio::DeviceScope scope(TX_DEVICE, Radio::SpiPath::Tx);
+    if (radio->ccaBackoff > 0) {
+        radio->ccaBackoff--;
+        return;
+    }
+
+    const auto waitedUs = static_cast<uint32_t>(esp_timer_get_time() - radio->ccaStartUs);
+    if (!channelBusy()) {
+        if (++radio->ccaClearSamples * LBT_SAMPLE_US < LBT_WINDOW_US) return;
+        if (radio->ccaDeferred) radio->lbt.deferred++;
+        else radio->lbt.clear++;
+    } else if (waitedUs < LBT_MAX_WAIT_US) {
+        radio->ccaClearSamples = 0;
+        radio->ccaDeferred = true;
+        radio->lbt.backoffs++;
+        radio->ccaBackoff = (LBT_BACKOFF_MIN_US + esp_random() % (LBT_BACKOFF_MAX_US - LBT_BACKOFF_MIN_US)) / LBT_SAMPLE_US;
+        return;
+    } else {
+        radio->lbt.forced++;
+        LOG_W(Radio, "TX: Channel still busy after %u us, sending anyway", static_cast<unsigned>(waitedUs));
+    }
+
+    radio->lbt.totalWaitUs += waitedUs;
+    if (waitedUs > radio->lbt.maxWaitUs) radio->lbt.maxWaitUs = waitedUs;
+    timerCancel(radio->txTimer);
+    radio->sendFirst();
+}
+
+void iohcRadio::finishBatch() {
+    batchReport.frames = txFirstSeen;
+    batchReport.interleaved = txInterleaved;
+    batchReport.startedUs = txFirstUs;
+    batchReport.startSpreadUs = txLastFirstDoneUs - txFirstDoneUs;
+    batchReport.durationUs = static_cast<uint32_t>(esp_timer_get_time() - txFirstUs);
+    LOG_D(Radio, "TX: All packets sent. %u frame(s), start spread %u us, total %u us. Stopping Ticker.",
+          static_cast<unsigned>(batchReport.frames), static_cast<unsigned>(batchReport.startSpreadUs),
+          static_cast<unsigned>(batchReport.durationUs));
+
+    timerCancel(txTimer);
+    packets2send.clear();
+    txInterleaved = false;
+    if (DEDICATED_TX) {
+        // The receiver never stopped scanning
+        Radio::setStandby();
+        txActive = false;
+        startQueuedSend();
+        return;
+    }
+    tune(scan_freqs[currentFreqIdx]);
+    Radio::setRx();
+    setRadioState(RadioState::RX);
+    txActive = false;
+    startQueuedSend();
+    if (!txActive)
+        xTaskNotify(handle_interrupt, EVENT_RESUME, eSetBits);
 }
 
 void iohcRadio::send(iohcPacket *packet) {
@@ -359,33 +668,66 @@ void iohcRadio::send(std::vector<iohcPacket *> &iohcTx) {
     startQueuedSend();
 }
 
+void iohcRadio::sendInterleaved(std::vector<iohcPacket *> &iohcTx) {
+    queueSend(iohcTx, true);
+    startQueuedSend();
+}
+
 
  
 void iohcRadio::onTxTicker(void *arg) {
     iohcRadio *radio = (iohcRadio *)arg;
+    Radio::DeviceScope scope(TX_DEVICE, Radio::SpiPath::Tx);
     auto packet = radio->packets2send[radio->txCounter];
 
     // 🩵 Fallback: Check IRQFLAGS2 (0x3F) for PacketSent in FSK mode
     uint8_t irqFlags2 = Radio::readByte(0x3F); // REG_IRQFLAGS2
     if (irqFlags2 & 0x08) { // Bit 3 == PacketSent (TXDONE in FSK)
-        ets_printf("FSK: Detected PacketSent (TXDONE) via register (ISR missed?)\n");
+        LOG_W(Radio, "FSK: Detected PacketSent (TXDONE) via register (ISR missed?)");
         Radio::writeByte(0x3F, 0x08); // Clear PacketSent bit
+        txDoneUs = nowUs();
         iohcRadio::txComplete = true;
     }
 
     // ⏳ Wait for TXDONE
     if (!radio->txComplete) {
-        ets_printf("TX: Waiting for TXDONE... (state=%s)\n", radioStateToString(radio->radioState));
+        LOG_V(Radio, "TX: Waiting for TXDONE... (state=%s)", radioStateToString(radio->radioState));
         return;
     }
 
     // ✅ TXDONE received
-    ESP_LOGD("RADIO", "TXDONE flag set, ready to send repeat or next packet.\n");
+    LOG_V(Radio, "TXDONE flag set, ready to send repeat or next packet.");
 
+    // A device starts once its first frame is on air: the long preamble of the first one counts
+    if (radio->txAwaitingFirstDone) {
+        radio->txAwaitingFirstDone = false;
+        radio->txLastFirstDoneUs = txDoneUs;
+        if (radio->txFirstSeen == 1) radio->txFirstDoneUs = radio->txLastFirstDoneUs;
+    }
+
+    if (radio->txInterleaved) {
+        // 🔀 Round-robin: account for this transmission, then move on to the next frame still having repeats
+        if (packet->repeat > 0) {
+            packet->repeat--;
+        } else {
+            radio->sent(packet);
+            radio->packets2send[radio->txCounter] = nullptr;
+            radio->txRemaining--;
+        }
+        if (radio->txRemaining == 0) {
+            radio->finishBatch();
+            return;
+        }
+        const size_t count = radio->packets2send.size();
+        do {
+            radio->txCounter = (radio->txCounter + 1) % count;
+        } while (radio->packets2send[radio->txCounter] == nullptr);
+        packet = radio->packets2send[radio->txCounter];
+    }
     // 🔁 Repeat logic
-    if (packet->repeat > 0) {
+    else if (packet->repeat > 0) {
         packet->repeat--;
-        ets_printf("TX: Repeating current packet (%d repeats left)\n", packet->repeat);
+        LOG_V(Radio, "TX: Repeating current packet (%d repeats left)", packet->repeat);
     } else {
         // inform callback we finished sending this packet, this transfers ownership of the packet to the callback queue
         radio->sent(packet);
@@ -395,57 +737,73 @@ void iohcRadio::onTxTicker(void *arg) {
 
         // 🛑 Check if all packets are sent
         if (radio->txCounter == radio->packets2send.size()) {
-            ets_printf("TX: All packets sent. Stopping Ticker.\n");
-            radio->Sender.detach();
-            radio->packets2send.clear();
-            Radio::setRx();
-            radio->setRadioState(RadioState::RX);
-            radio->startQueuedSend();
+            radio->finishBatch();
             return;
         }
 
         packet = radio->packets2send[radio->txCounter];
-        ets_printf("TX: Moving to next packet %d/%d (repeat=%d)\n",
-                    radio->txCounter + 1,
-                    radio->packets2send.size(),
-                    packet->repeat);
+        LOG_D(Radio, "TX: Moving to next packet %d/%u (repeat=%d)",
+              radio->txCounter + 1,
+              static_cast<unsigned>(radio->packets2send.size()),
+              packet->repeat);
     }
 
-    radio->txComplete = false;
-
     //Radio::setRx();
-    radio->setRadioState(RadioState::TX); // Stay TX until done
+    enterTxState(); // Stay TX until done
 
     // 📡 Send next packet (short preamble)
     Radio::setPreambleLength(SHORT_PREAMBLE_MS);
-    Radio::setStandby();
-    Radio::clearFlags();
-    Radio::writeBytes(REG_FIFO, packet->payload.buffer, packet->buffer_length);
-    Radio::setTx();
+    radio->transmit(packet);
     //packetStamp = esp_timer_get_time();
     //packet->decode(true); //false);
     //IOHC::lastSendCmd = packet->payload.packet.header.cmd;
 
-    ets_printf("TX: Sent packet %d/%d at %llu us\n",
-               radio->txCounter + 1,
-               radio->packets2send.size(),
-               esp_timer_get_time());
+    LOG_V(Radio, "TX: Sent packet %d/%u at %lld us",
+          radio->txCounter + 1,
+          static_cast<unsigned>(radio->packets2send.size()),
+          esp_timer_get_time());
 }
 
-bool queueCallback(IohcPacketDelegate* callback, iohcPacket* packet) {
-    Callback *callbackData = (Callback*) pvPortMalloc(sizeof(Callback));
-    if (callbackData == NULL) {
-        return false;
-    }
+/**
+ * Hand a frame to the callback task. On false the lane was full and the caller still owns the packet.
+ */
+bool queueCallback(IohcPacketDelegate* callback, iohcPacket* packet, CallbackLane lane, bool received) {
+    const auto idx = static_cast<uint8_t>(lane);
+    const CallbackMessage message{callback, packet, received};
+    const bool queued = xQueueSendToBack(callbackLanes[idx], &message, 0) == pdPASS;
+    const auto depth = static_cast<uint8_t>(uxQueueMessagesWaiting(callbackLanes[idx]));
+
+    portENTER_CRITICAL(&callbackMux);
+    CallbackLaneStats &stats = callbackLaneStats[idx];
+    if (queued) stats.queued++;
+    else stats.dropped++;
+    if (depth > stats.highWater) stats.highWater = depth;
+    const uint32_t dropped = stats.dropped;
+    portEXIT_CRITICAL(&callbackMux);
+
+    if (queued) xTaskNotifyGive(callbackTask);
+    else LOG_W(Radio, "Callback lane %s full, frame dropped (%u so far)", lane == CallbackLane::High ? "high" : "low",
+               static_cast<unsigned>(dropped));
+    return queued;
+}
 
-    callbackData->callback = callback;
-    callbackData->packet = packet;
+CallbackLaneStats iohcRadio::callbackStats(CallbackLane lane) {
+    const auto idx = static_cast<uint8_t>(lane);
+    portENTER_CRITICAL(&callbackMux);
+    CallbackLaneStats stats = callbackLaneStats[idx];
+    portEXIT_CRITICAL(&callbackMux);
+    stats.depth = callbackLanes[idx] ? static_cast<uint8_t>(uxQueueMessagesWaiting(callbackLanes[idx])) : 0;
+    return stats;
+}
 
-    if (xQueueSendToBack(callbackQueue, &callbackData, 0) != pdPASS) {
-        vPortFree(callbackData);
-        return false;
+void iohcRadio::resetCallbackStats() {
+    portENTER_CRITICAL(&callbackMux);
+    for (auto &stats : callbackLaneStats) {
+        stats.queued = 0;
+        stats.dropped = 0;
+        stats.highWater = 0;
     }
-    return true;
+    portEXIT_CRITICAL(&callbackMux);
 }
 
 /**
@@ -462,47 +820,51 @@ bool queueCallback(IohcPacketDelegate* callback, iohcPacket* packet) {
         bool ret = false;
         if (packet) {
             packetStamp = esp_timer_get_time();
-            packet->decode(true);
-            addLogMessage(String(packet->decodeToString(true).c_str()));
+            // The frame dump prints and allocates, keep it off the TX timer unless asked for
+            if (logEnabled(LogModule::Radio, LogLevel::Debug)) {
+                packet->decode(true);
+                addLogMessage(String(packet->decodeToString(true).c_str()));
+            }
         }
-        if (txCB && !queueCallback(&txCB, packet)) {
+        if (packet) recordLatency(LatencyStage::TxDone, packet->stampUs);
+        if (txCB && !queueCallback(&txCB, packet, CallbackLane::High, false)) {
             delete packet;
         }
         return ret;
     }
 
-    //    static uint8_t RF96lnaMap[] = { 0, 0, 6, 12, 24, 36, 48, 48 };
+    // LNA attenuation in dB per LnaGain code (REG_LNA bits 7-5)
+    static constexpr uint8_t RF96lnaMap[] = { 0, 0, 6, 12, 24, 36, 48, 48 };
 /**
  * The `iohcRadio::receive` function in C++ toggles an LED, reads radio data, processes it, and
- * triggers a callback function.
- * 
- * @param stats The `stats` parameter in the `iohcRadio::receive` function is a boolean parameter that
- * is used to determine whether to gather additional statistics during the radio reception process. If
- * `stats` is set to `true`, the function will collect and process additional information such as RSSI
- * (Received Signal
+ * triggers a callback function. RSSI, AFC and LNA gain of every frame are captured in one burst
+ * read at payload ready time.
  * 
  * @return The function `iohcRadio::receive` is returning a boolean value `true`.
  */
-    bool IRAM_ATTR iohcRadio::receive(bool stats = false) {
+    bool IRAM_ATTR iohcRadio::receive() {
         digitalWrite(RX_LED, digitalRead(RX_LED) ^ 1);
         // bool frmErr = false;
         auto iohc = new iohcPacket;
         iohc->buffer_length = 0;
-        iohc->frequency = scan_freqs[currentFreqIdx];
+        iohc->frequency = tunedFrequency[0];
+        rxStats.frames++;
 
         _g_payload_millis = esp_timer_get_time();
         packetStamp = _g_payload_millis;
 #if defined(RADIO_SX127X)
-        if (stats) {
-            iohc->rssi = static_cast<float>(Radio::readByte(REG_RSSIVALUE)) / -2.0f;
-            int16_t thres = Radio::readByte(REG_RSSITHRESH);
-            iohc->snr = iohc->rssi > thres ? 0 : (thres - iohc->rssi);
-            //            iohc->lna = RF96lnaMap[ (Radio::readByte(REG_LNA) >> 5) & 0x7 ];
-            int16_t f = (uint16_t) Radio::readByte(REG_AFCMSB);
-            f = (f << 8) | (uint16_t) Radio::readByte(REG_AFCLSB);
+        {
+            // REG_LNA .. REG_AFCLSB in a single transaction; none of these registers has read side effects
+            uint8_t regs[REG_AFCLSB - REG_LNA + 1];
+            Radio::readBytes(REG_LNA, regs, sizeof(regs));
+            iohc->rssi = static_cast<float>(regs[REG_RSSIVALUE - REG_LNA]) / -2.0f;
+            // Margin above the RSSI detection threshold
+            const float thres = static_cast<float>(regs[REG_RSSITHRESH - REG_LNA]) / -2.0f;
+            iohc->snr = iohc->rssi > thres ? static_cast<uint8_t>(iohc->rssi - thres) : 0;
+            iohc->lna = RF96lnaMap[(regs[0] >> 5) & 0x7];
+            const auto f = static_cast<int16_t>((regs[REG_AFCMSB - REG_LNA] << 8) | regs[REG_AFCLSB - REG_LNA]);
             //            iohc->afc = f * (32000000.0 / 524288.0); // static_cast<float>(1 << 19));
             iohc->afc = /*(int32_t)*/f * 61.0;
-            //            iohc->rssiAt = micros();
         }
 #elif defined(CC1101)
         __g_preamble = false;
@@ -523,6 +885,9 @@ bool queueCallback(IohcPacketDelegate* callback, iohcPacket* packet) {
         while (Radio::dataAvail()) {
             iohc->payload.buffer[iohc->buffer_length++] = Radio::readByte(REG_FIFO);
         }
+        iohc->stampUs = lastEdgeUs;
+        recordLatency(LatencyStage::RxWake, lastEdgeUs, lastWakeUs);
+        recordLatency(LatencyStage::RxDrained, lastEdgeUs);
 
 #elif defined(CC1101)
         uint8_t lenghtFrameCoded = 0xFF;
@@ -583,10 +948,23 @@ bool queueCallback(IohcPacketDelegate* callback, iohcPacket* packet) {
 #endif
 
         // Radio::clearFlags();
-        iohc->decode(true); //stats);
-        addLogMessage(String(iohc->decodeToString(true).c_str()));
+        if (DEDICATED_TX && isOwnFrame(iohc)) {
+            rxStats.ownFrames++;
+            delete iohc;
+            digitalWrite(RX_LED, false);
+            return true;
+        }
+        if (iohc->buffer_length > 0)
+            scanScheduler.recordFrame(currentFreqIdx, iohc->payload.packet.header.CtrlByte1.asStruct.Protocol);
+        if (logEnabled(LogModule::Radio, LogLevel::Debug)) {
+            iohc->decode(true); //stats);
+            addLogMessage(String(iohc->decodeToString(true).c_str()));
+        }
 
-        if (rxCB && !queueCallback(&rxCB, iohc)) {
+        // 2W frames shortly after our own TX are the answers of an exchange we started
+        const bool session = iohc->buffer_length > 0 && !iohc->payload.packet.header.CtrlByte1.asStruct.Protocol &&
+                             millis() - lastTxMs < CALLBACK_SESSION_WINDOW_MS;
+        if (rxCB && !queueCallback(&rxCB, iohc, session ? CallbackLane::High : CallbackLane::Low, true)) {
             delete iohc;
         }
         digitalWrite(RX_LED, false);
@@ -636,6 +1014,6 @@ bool queueCallback(IohcPacketDelegate* callback, iohcPacket* packet) {
         radioState = newState;
         // Optional debug:
         //printf("State changed to: %d\n", static_cast<int>(newState));
-        ets_printf("State: %s\n", radioStateToString(newState));
+        LOG_V(Radio, "State: %s", radioStateToString(newState));
     }
 }
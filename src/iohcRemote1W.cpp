@@ -21,20 +21,20 @@
 #include <iohcCryptoHelpers.h>
 #include <esp_system.h>
 #include <oled_display.h>
-#include <TickerUsESP32.h>
+#include <timer_service.h>
 #include <nvs_helpers.h>
 #include <cmath>
 #include <algorithm>
+#include <utility>
+#include <cover_state_bus.h>
+#include <iohcRemoteMap.h>
 #if defined(MQTT)
 #include <mqtt_handler.h>
 #endif
-#if defined(WEBSERVER)
-#include <web_server_handler.h>
-#endif
 
 namespace IOHC {
     iohcRemote1W* iohcRemote1W::_iohcRemote1W = nullptr;
-    static TimersUS::TickerUsESP32 positionTicker;
+    static TimerToken positionTicker;
     static constexpr uint32_t DEFAULT_TRAVEL_TIME_SEC = 10;
 
     static void positionTickerCallback() {
@@ -64,13 +64,46 @@ namespace IOHC {
         }
     }
 
+    // Hand the current state of a remote to the cover state bus, which takes
+    // care of coalescing and fanning it out to MQTT, WebSocket and OLED.
+    static void postRemoteState(iohcRemote1W::remote &r, CoverState state) {
+        const float pos = r.positionTracker.getPosition();
+        postCoverState(r.node, r.name.c_str(), state, pos);
+        if (state != CoverState::Unknown) {
+            r.lastPublishedState = state;
+        }
+        r.lastPublishedPosition = pos;
+    }
+
+    bool groupActionFromString(const std::string &action, RemoteButton &btn) {
+        if (action == "open") btn = RemoteButton::Open;
+        else if (action == "close") btn = RemoteButton::Close;
+        else if (action == "stop") btn = RemoteButton::Stop;
+        else if (action == "vent") btn = RemoteButton::Vent;
+        else if (action == "force") btn = RemoteButton::ForceOpen;
+        else if (action == "position") btn = RemoteButton::Position;
+        else if (action == "absolute") btn = RemoteButton::Absolute;
+        else return false;
+        return true;
+    }
+
     iohcRemote1W::iohcRemote1W() = default;
 
+    // A group collects the frames of all its members instead of sending one batch per device
+    void iohcRemote1W::dispatch(std::vector<iohcPacket *> &packets, std::vector<iohcPacket *> *collect) {
+        if (collect) {
+            collect->insert(collect->end(), packets.begin(), packets.end());
+            packets.clear();
+            return;
+        }
+        _radioInstance->send(packets);
+    }
+
     iohcRemote1W* iohcRemote1W::getInstance() {
         if (!_iohcRemote1W) {
             _iohcRemote1W = new iohcRemote1W();
             _iohcRemote1W->load();
-            positionTicker.attach_ms(1000, positionTickerCallback);
+            positionTicker = timerEvery("cover_position", 1000000ULL, positionTickerCallback, TimerDispatch::Worker);
         }
         return _iohcRemote1W;
     }
@@ -100,9 +133,9 @@ namespace IOHC {
 
     std::vector<uint8_t> frame;
 
-    void iohcRemote1W::cmd(RemoteButton cmd, Tokens* data) {
+    void iohcRemote1W::cmd(RemoteButton cmd, const TokenView *data, std::vector<iohcPacket *> *collect) {
         if (data->size() == 1) {return; }
-        std::string description = data->at(1).c_str();
+        const std::string description(data->at(1));
 
         auto it = std::find_if( remotes.begin(), remotes.end(),  [&] ( const remote &r  ) {
                  return description == r.description;
@@ -113,8 +146,30 @@ namespace IOHC {
             return;
         }
 
-        // auto&[node, sequence, key, type, manufacturer, description] = *it;
-        remote& r = *it;
+        // Position and absolute take 0-100 after the device, or first when only the value and device are given
+        uint8_t percent = 0;
+        if ((cmd == RemoteButton::Position || cmd == RemoteButton::Absolute) &&
+            !data->percent(data->size() > 2 ? 2 : 0, percent)) {
+            printf("ERROR %s needs a position 0-100\n", remoteButtonToString(cmd));
+            return;
+        }
+        this->cmd(cmd, *it, percent, collect);
+    }
+
+    const iohcRemote1W::remote *iohcRemote1W::findRemote(std::string_view descriptionOrAddress) const {
+        uint8_t node[3];
+        const bool isAddress = TokenView(descriptionOrAddress).hexAddress(0, node);
+        auto it = std::find_if(remotes.begin(), remotes.end(), [&](const remote &r) {
+            return r.description == descriptionOrAddress || (isAddress && memcmp(r.node, node, sizeof(node)) == 0);
+        });
+        return it != remotes.end() ? &*it : nullptr;
+    }
+
+    iohcRemote1W::remote *iohcRemote1W::findRemote(std::string_view descriptionOrAddress) {
+        return const_cast<remote *>(std::as_const(*this).findRemote(descriptionOrAddress));
+    }
+
+    void iohcRemote1W::cmd(RemoteButton cmd, remote &r, uint8_t percent, std::vector<iohcPacket *> *collect) {
         r.positionTracker.update();
 /*
         int value = 0;
@@ -188,11 +243,11 @@ namespace IOHC {
                     // if (typn) packet->payload.packet.header.CtrlByte2.asStruct.LPM = 0; //TODO only first is LPM
                     digitalWrite(RX_LED, digitalRead(RX_LED) ^ 1);
 //                }
-                _radioInstance->send(packets2send);
+                dispatch(packets2send, collect);
                 display1WAction(r.node, remoteButtonToString(cmd), "TX", r.name.c_str());
 
                 Serial.printf("%s position: %.0f%%\n", r.name.c_str(), r.positionTracker.getPosition());
-                display1WPosition(r.node, r.positionTracker.getPosition(), r.name.c_str());
+                postRemoteState(r, CoverState::Unknown);
 
                 r.paired = true;
                 break;
@@ -236,12 +291,12 @@ namespace IOHC {
 
                     digitalWrite(RX_LED, digitalRead(RX_LED) ^ 1);
 //                }
-                _radioInstance->send(packets2send);
+                dispatch(packets2send, collect);
                 //printf("\n");
                 display1WAction(r.node, remoteButtonToString(cmd), "TX", r.name.c_str());
 
                 Serial.printf("%s position: %.0f%%\n", r.name.c_str(), r.positionTracker.getPosition());
-                display1WPosition(r.node, r.positionTracker.getPosition(), r.name.c_str());
+                postRemoteState(r, CoverState::Unknown);
 
                 r.paired = false;
                 break;
@@ -286,10 +341,10 @@ namespace IOHC {
 
                     digitalWrite(RX_LED, digitalRead(RX_LED) ^ 1);
 //                }
-                _radioInstance->send(packets2send);
+                dispatch(packets2send, collect);
                 display1WAction(r.node, remoteButtonToString(cmd), "TX", r.name.c_str());
                 Serial.printf("%s position: %.0f%%\n", r.name.c_str(), r.positionTracker.getPosition());
-                display1WPosition(r.node, r.positionTracker.getPosition(), r.name.c_str());
+                postRemoteState(r, CoverState::Unknown);
                 r.paired = true;
                 break;
             }
@@ -321,15 +376,7 @@ namespace IOHC {
                             r.positionTracker.startOpening();
                             r.movement = remote::Movement::Opening;
                             r.targetPosition = 100.0f;
-#if defined(MQTT)
-                            {
-                                std::string id = bytesToHexString(r.node, sizeof(r.node));
-                                publishCoverState(id, "OPENING");
-                                publishCoverPosition(id, r.positionTracker.getPosition());
-                                r.lastPublishedState = "OPENING";
-                                r.lastPublishedPosition = r.positionTracker.getPosition();
-                            }
-#endif
+                            postRemoteState(r, CoverState::Opening);
                             break;
                         case RemoteButton::Close:
                             packet->payload.packet.msg.p0x00_14.main[0] = 0xc8;
@@ -337,15 +384,7 @@ namespace IOHC {
                             r.positionTracker.startClosing();
                             r.movement = remote::Movement::Closing;
                             r.targetPosition = 0.0f;
-#if defined(MQTT)
-                            {
-                                std::string id = bytesToHexString(r.node, sizeof(r.node));
-                                publishCoverState(id, "CLOSING");
-                                publishCoverPosition(id, r.positionTracker.getPosition());
-                                r.lastPublishedState = "CLOSING";
-                                r.lastPublishedPosition = r.positionTracker.getPosition();
-                            }
-#endif
+                            postRemoteState(r, CoverState::Closing);
                             break;
                         case RemoteButton::Stop:
                             packet->payload.packet.msg.p0x00_14.main[0] = 0xd2;
@@ -353,15 +392,7 @@ namespace IOHC {
                             r.positionTracker.stop();
                             r.movement = remote::Movement::Idle;
                             r.targetPosition = r.positionTracker.getPosition();
-#if defined(MQTT)
-                            {
-                                std::string id = bytesToHexString(r.node, sizeof(r.node));
-                                publishCoverState(id, "STOP");
-                                publishCoverPosition(id, r.positionTracker.getPosition());
-                                r.lastPublishedState = "STOP";
-                                r.lastPublishedPosition = r.positionTracker.getPosition();
-                            }
-#endif
+                            postRemoteState(r, CoverState::Stop);
                             break;
                         case RemoteButton::Vent:
                             packet->payload.packet.msg.p0x00_14.main[0] = 0xd8;
@@ -372,9 +403,6 @@ namespace IOHC {
                             packet->payload.packet.msg.p0x00_14.main[1] = 0x00;
                             break;
                         case RemoteButton::Position: {
-                            int index = (data->size() > 2) ? 2 : 0;
-                            int percent = atoi(data->at(index).c_str());
-                            percent = std::clamp(percent, 0, 100);
                             uint8_t val = static_cast<uint8_t>((100 - percent) * 2);
                             packet->payload.packet.msg.p0x00_14.main[0] = val;
                             packet->payload.packet.msg.p0x00_14.main[1] = 0x00;
@@ -382,27 +410,11 @@ namespace IOHC {
                             if (percent > current + 0.5f) {
                                 r.positionTracker.startOpening();
                                 r.movement = remote::Movement::Opening;
-                                #if defined(MQTT)
-                                {
-                                    std::string id = bytesToHexString(r.node, sizeof(r.node));
-                                    publishCoverState(id, "OPENING");
-                                    publishCoverPosition(id, r.positionTracker.getPosition());
-                                    r.lastPublishedState = "OPENING";
-                                    r.lastPublishedPosition = r.positionTracker.getPosition();
-                                }
-                                #endif
+                                postRemoteState(r, CoverState::Opening);
                             } else if (percent < current - 0.5f) {
                                 r.positionTracker.startClosing();
                                 r.movement = remote::Movement::Closing;
-                                #if defined(MQTT)
-                                {
-                                    std::string id = bytesToHexString(r.node, sizeof(r.node));
-                                    publishCoverState(id, "CLOSING");
-                                    publishCoverPosition(id, r.positionTracker.getPosition());
-                                    r.lastPublishedState = "CLOSING";
-                                    r.lastPublishedPosition = r.positionTracker.getPosition();
-                                }
-                                #endif
+                                postRemoteState(r, CoverState::Closing);
                             } else {
                                 r.positionTracker.stop();
                                 r.movement = remote::Movement::Idle;
@@ -411,9 +423,6 @@ namespace IOHC {
                             break;
                         }
                         case RemoteButton::Absolute: {
-                            int index = (data->size() > 2) ? 2 : 0;
-                            int percent = atoi(data->at(index).c_str());
-                            percent = std::clamp(percent, 0, 100);
                             uint16_t val = static_cast<uint16_t>(percent * 0x0200);
                             packet->payload.packet.msg.p0x00_14.main[0] = val >> 8;
                             packet->payload.packet.msg.p0x00_14.main[1] = val & 0xFF;
@@ -422,27 +431,11 @@ namespace IOHC {
                             if (target > current + 0.5f) {
                                 r.positionTracker.startOpening();
                                 r.movement = remote::Movement::Opening;
-#if defined(MQTT)
-                                {
-                                    std::string id = bytesToHexString(r.node, sizeof(r.node));
-                                    publishCoverState(id, "OPENING");
-                                    publishCoverPosition(id, r.positionTracker.getPosition());
-                                    r.lastPublishedState = "OPENING";
-                                    r.lastPublishedPosition = r.positionTracker.getPosition();
-                                }
-#endif
+                                postRemoteState(r, CoverState::Opening);
                             } else if (target < current - 0.5f) {
                                 r.positionTracker.startClosing();
                                 r.movement = remote::Movement::Closing;
-#if defined(MQTT)
-                                {
-                                    std::string id = bytesToHexString(r.node, sizeof(r.node));
-                                    publishCoverState(id, "CLOSING");
-                                    publishCoverPosition(id, r.positionTracker.getPosition());
-                                    r.lastPublishedState = "CLOSING";
-                                    r.lastPublishedPosition = r.positionTracker.getPosition();
-                                }
-#endif
+                                postRemoteState(r, CoverState::Closing);
                             } else {
                                 r.positionTracker.stop();
                                 r.movement = remote::Movement::Idle;
@@ -633,15 +626,15 @@ Every 9 -> 0x20 12:41:28.171 > (23) 1W S 1 E 1  FROM B60D1A TO 00003F CMD 20 <
 
                     digitalWrite(RX_LED, digitalRead(RX_LED) ^ 1);
 
-                    _radioInstance->send(packets2send);
+                    dispatch(packets2send, collect);
 
                     display1WAction(r.node, remoteButtonToString(cmd), "TX", r.name.c_str());
                     Serial.printf("%s position: %.0f%%\n", r.name.c_str(), r.positionTracker.getPosition());
-                    display1WPosition(r.node, r.positionTracker.getPosition(), r.name.c_str());
+                    postRemoteState(r, CoverState::Unknown);
                     break;
                 }
         }
-        this->save(); // Save sequence number
+        if (!collect) this->save(); // Save sequence number, a group saves once when planned
     }
 
    bool iohcRemote1W::load() {
@@ -847,9 +840,7 @@ const std::vector<iohcRemote1W::remote>& iohcRemote1W::getRemotes() const {
 #if defined(MQTT)
         if (mqttClient.connected()) {
             std::string id = bytesToHexString(r.node, sizeof(r.node));
-            std::string key = bytesToHexString(r.key, sizeof(r.key));
-            publishDiscovery(id, r.name, key);
-            publishTravelTimeDiscovery(id, r.name, key, r.travelTime);
+            publishDiscovery(r);
             mqttClient.subscribe(("iown/" + id + "/set").c_str(), 0);
             mqttClient.subscribe(("iown/" + id + "/position/set").c_str(), 0);
             mqttClient.subscribe(("iown/" + id + "/pair").c_str(), 0);
@@ -876,16 +867,16 @@ const std::vector<iohcRemote1W::remote>& iohcRemote1W::getRemotes() const {
         std::string id = bytesToHexString(it->node, sizeof(it->node));
 #if defined(MQTT)
         if (mqttClient.connected()) {
-            removeDiscovery(id);
+            removeDiscovery(it->node);
             mqttClient.unsubscribe(("iown/" + id + "/set").c_str());
             mqttClient.unsubscribe(("iown/" + id + "/position/set").c_str());
             mqttClient.unsubscribe(("iown/" + id + "/pair").c_str());
             mqttClient.unsubscribe(("iown/" + id + "/add").c_str());
             mqttClient.unsubscribe(("iown/" + id + "/remove").c_str());
             mqttClient.unsubscribe(("iown/" + id + "/travel_time/set").c_str());
-            mqttClient.publish(("iown/" + id + "/travel_time").c_str(), 0, true, "", 0);
         }
 #endif
+        forgetCoverState(it->node);
         remotes.erase(it);
         save();
         return true;
@@ -903,10 +894,7 @@ const std::vector<iohcRemote1W::remote>& iohcRemote1W::getRemotes() const {
         save();
 #if defined(MQTT)
         if (mqttClient.connected()) {
-            std::string id = bytesToHexString(it->node, sizeof(it->node));
-            std::string key = bytesToHexString(it->key, sizeof(it->key));
-            publishDiscovery(id, it->name, key);
-            publishTravelTimeDiscovery(id, it->name, key, it->travelTime);
+            publishDiscovery(*it);
         }
 #endif
         return true;
@@ -928,43 +916,19 @@ const std::vector<iohcRemote1W::remote>& iohcRemote1W::getRemotes() const {
                 r.positionTracker.startOpening();
                 r.movement = remote::Movement::Opening;
                 r.targetPosition = 100.0f;
-#if defined(MQTT)
-                {
-                    std::string id = bytesToHexString(r.node, sizeof(r.node));
-                    publishCoverState(id, "OPENING");
-                    publishCoverPosition(id, r.positionTracker.getPosition());
-                    r.lastPublishedState = "OPENING";
-                    r.lastPublishedPosition = r.positionTracker.getPosition();
-                }
-#endif
+                postRemoteState(r, CoverState::Opening);
                 break;
             case RemoteButton::Close:
                 r.positionTracker.startClosing();
                 r.movement = remote::Movement::Closing;
                 r.targetPosition = 0.0f;
-#if defined(MQTT)
-                {
-                    std::string id = bytesToHexString(r.node, sizeof(r.node));
-                    publishCoverState(id, "CLOSING");
-                    publishCoverPosition(id, r.positionTracker.getPosition());
-                    r.lastPublishedState = "CLOSING";
-                    r.lastPublishedPosition = r.positionTracker.getPosition();
-                }
-#endif
+                postRemoteState(r, CoverState::Closing);
                 break;
             case RemoteButton::Stop:
                 r.positionTracker.stop();
                 r.movement = remote::Movement::Idle;
                 r.targetPosition = r.positionTracker.getPosition();
-#if defined(MQTT)
-                {
-                    std::string id = bytesToHexString(r.node, sizeof(r.node));
-                    publishCoverState(id, "STOP");
-                    publishCoverPosition(id, r.positionTracker.getPosition());
-                    r.lastPublishedState = "STOP";
-                    r.lastPublishedPosition = r.positionTracker.getPosition();
-                }
-#endif
+                postRemoteState(r, CoverState::Stop);
                 break;
             default:
                 break;
@@ -982,6 +946,11 @@ const std::vector<iohcRemote1W::remote>& iohcRemote1W::getRemotes() const {
         it->travelTime = travelTime;
         it->positionTracker.setTravelTime(travelTime);
         save();
+#if defined(MQTT)
+        if (mqttClient.connected()) {
+            publishTravelTime(*it);
+        }
+#endif
         return true;
     }
 
@@ -998,6 +967,54 @@ const std::vector<iohcRemote1W::remote>& iohcRemote1W::getRemotes() const {
         return true;
     }
 
+    std::vector<std::string> iohcRemote1W::resolveGroup(const std::string &spec) const {
+        std::vector<std::string> members;
+        if (spec == "all") {
+            for (const auto &r : remotes) members.push_back(r.description);
+            return members;
+        }
+        for (const auto &entry : iohcRemoteMap::getInstance()->getEntries()) {
+            if (entry.name == spec) return entry.devices;
+        }
+        splitTokens(spec, ',', [&](std::string_view item) {
+            if (item.empty()) return;
+            const remote *r = findRemote(item);
+            members.emplace_back(r ? std::string_view(r->description) : item);
+        });
+        return members;
+    }
+
+    iohcRemote1W::groupResult iohcRemote1W::groupCmd(RemoteButton cmd, const std::vector<std::string> &members, uint8_t percent) {
+        groupResult result;
+        std::vector<iohcPacket *> batch;
+        std::vector<std::string> planned;
+
+        for (const auto &description : members) {
+            auto it = std::find_if(remotes.begin(), remotes.end(), [&](const remote &r) {
+                return r.description == description;
+            });
+            if (it == remotes.end()) {
+                result.missing.push_back(description);
+                continue;
+            }
+            // One frame per device, even if it is listed twice
+            if (std::find(planned.begin(), planned.end(), description) != planned.end()) continue;
+            planned.push_back(description);
+            const size_t before = batch.size();
+            this->cmd(cmd, *it, percent, &batch);
+            if (batch.size() > before) result.devices++;
+        }
+
+        if (batch.empty()) return result;
+        this->save(); // Save sequence numbers once for the whole group
+
+        // Measured between first TX-done interrupts: the long preamble delays every frame alike,
+        // then the round-robin puts one more frame on air per repeat tick
+        result.estimatedSpreadMs = (batch.size() - 1) * batch.front()->repeatTime;
+        _radioInstance->sendInterleaved(batch);
+        return result;
+    }
+
     void iohcRemote1W::updatePositions() {
         for (auto &r : remotes) {
             r.positionTracker.update();
@@ -1024,57 +1041,19 @@ const std::vector<iohcRemote1W::remote>& iohcRemote1W::getRemotes() const {
 
             if (moving) {
                 //Serial.printf("%s position: %.0f%%\n", r.name.c_str(), pos);
-                display1WPosition(r.node, pos, r.name.c_str());
-#if defined(MQTT) || defined(WEBSERVER)
-                std::string id = bytesToHexString(r.node, sizeof(r.node));
-#endif
-#if defined(MQTT)
-                const char *state = r.movement == remote::Movement::Opening ? "OPENING" : "CLOSING";
-                if (state != r.lastPublishedState) {
-                    publishCoverState(id, state);
-                    r.lastPublishedState = state;
-                }
-#endif
-#if defined(MQTT) || defined(WEBSERVER)
-                if (fabs(pos - r.lastPublishedPosition) >= 1.0f) {
-#if defined(MQTT)
-                    publishCoverPosition(id, pos);
-#endif
-#if defined(WEBSERVER)
-                    broadcastDevicePosition(id.c_str(), static_cast<int>(pos));
-#endif
+                CoverState state = r.movement == remote::Movement::Opening ? CoverState::Opening : CoverState::Closing;
+                if (state != r.lastPublishedState || pos != r.lastPublishedPosition) {
+                    postRemoteState(r, state);
                 }
-                r.lastPublishedPosition = pos;
-#endif
             } else {
-#if defined(MQTT) || defined(WEBSERVER)
-                std::string id = bytesToHexString(r.node, sizeof(r.node));
-#endif
-#if defined(MQTT)
-                const char *state = "STOP";
+                CoverState state = CoverState::Stop;
                 if (r.movement == remote::Movement::Opening) {
-                    state = pos >= 99.5f ? "OPEN" : "STOP";
+                    state = pos >= 99.5f ? CoverState::Open : CoverState::Stop;
                 } else if (r.movement == remote::Movement::Closing) {
-                    state = pos <= 0.5f ? "CLOSE" : "STOP";
-                }
-                if (state != r.lastPublishedState) {
-                    publishCoverState(id, state);
-                    r.lastPublishedState = state;
+                    state = pos <= 0.5f ? CoverState::Close : CoverState::Stop;
                 }
-#endif
-                if (r.lastPublishedPosition != pos) {
-                    display1WPosition(r.node, pos, r.name.c_str());
-#if defined(MQTT) || defined(WEBSERVER)
-                    if (fabs(pos - r.lastPublishedPosition) >= 1.0f) {
-#if defined(MQTT)
-                        publishCoverPosition(id, pos);
-#endif
-#if defined(WEBSERVER)
-                        broadcastDevicePosition(id.c_str(), static_cast<int>(pos));
-#endif
-                    }
-#endif
-                    r.lastPublishedPosition = pos;
+                if (state != r.lastPublishedState || pos != r.lastPublishedPosition) {
+                    postRemoteState(r, state);
                 }
                 r.movement = remote::Movement::Idle;
             }
@@ -0,0 +1,92 @@
+#include <iohcScanScheduler.h>
+
+#include <algorithm>
+#include <iterator>
+
+namespace IOHC {
+    namespace {
+        // A decoded 2W frame says more about where dwell time pays off than a preamble alone
+        constexpr uint32_t PREAMBLE_WEIGHT = 4;
+        constexpr uint32_t FRAME_WEIGHT = 64;
+        constexpr uint32_t FRAME_1W_WEIGHT = 1;
+        constexpr uint32_t SCORE_LIMIT = 1UL << 24;
+    }
+
+    void iohcScanScheduler::begin(uint8_t channels, uint32_t baseDwellUs) {
+        _channels = std::min<uint8_t>(channels, MAX_CHANNELS);
+        _baseDwellUs = baseDwellUs;
+        _current = 0;
+        _cycles = 0;
+        std::fill(std::begin(_score), std::end(_score), 0);
+        resetStats();
+        recomputeDwell();
+    }
+
+    void iohcScanScheduler::setPolicy(Policy policy) {
+        _policy = policy;
+        recomputeDwell();
+    }
+
+    void iohcScanScheduler::addScore(uint8_t channel, uint32_t weight) {
+        if (channel >= _channels) return;
+        _score[channel] = std::min(_score[channel] + weight, SCORE_LIMIT);
+    }
+
+    void iohcScanScheduler::recordPreamble(uint8_t channel) {
+        if (channel >= _channels) return;
+        ++_preambles[channel];
+        addScore(channel, PREAMBLE_WEIGHT);
+    }
+
+    void iohcScanScheduler::recordFrame(uint8_t channel, bool oneWay) {
+        if (channel >= _channels) return;
+        ++_frames[channel];
+        addScore(channel, oneWay ? FRAME_1W_WEIGHT : FRAME_WEIGHT);
+    }
+
+    ScanHop iohcScanScheduler::first() {
+        _current = 0;
+        if (_channels) ++_visits[0];
+        return {0, _channels ? _dwellUs[0] : _baseDwellUs};
+    }
+
+    ScanHop iohcScanScheduler::next() {
+        if (!_channels) return {0, _baseDwellUs};
+        if (++_current >= _channels) {
+            _current = 0;
+            if (++_cycles % SCAN_DECAY_CYCLES == 0) {
+                for (uint8_t i = 0; i < _channels; ++i) _score[i] -= _score[i] >> 4;
+            }
+            // New split once per cycle, so a cycle always keeps its length
+            recomputeDwell();
+        }
+        ++_visits[_current];
+        return {_current, _dwellUs[_current]};
+    }
+
+    void iohcScanScheduler::recomputeDwell() {
+        uint64_t total = 0;
+        for (uint8_t i = 0; i < _channels; ++i) total += _score[i];
+
+        if (_policy == Policy::Fixed || total == 0) {
+            std::fill(_dwellUs, _dwellUs + _channels, _baseDwellUs);
+            return;
+        }
+        const uint32_t minDwell = _baseDwellUs * SCAN_MIN_DWELL_PERCENT / 100;
+        const uint64_t shared = static_cast<uint64_t>(_baseDwellUs - minDwell) * _channels;
+        for (uint8_t i = 0; i < _channels; ++i) {
+            _dwellUs[i] = minDwell + static_cast<uint32_t>(shared * _score[i] / total);
+        }
+    }
+
+    iohcScanScheduler::ChannelStats iohcScanScheduler::stats(uint8_t channel) const {
+        if (channel >= _channels) return {};
+        return {_preambles[channel], _frames[channel], _visits[channel], _score[channel], _dwellUs[channel]};
+    }
+
+    void iohcScanScheduler::resetStats() {
+        std::fill(std::begin(_preambles), std::end(_preambles), 0);
+        std::fill(std::begin(_frames), std::end(_frames), 0);
+        std::fill(std::begin(_visits), std::end(_visits), 0);
+    }
+}
@@ -0,0 +1,109 @@
+#include <latency_metrics.h>
+
+#include <Arduino.h>
+#include <esp_timer.h>
+
+#include <algorithm>
+
+namespace {
+
+constexpr uint8_t STAGE_COUNT = static_cast<uint8_t>(LatencyStage::Count);
+
+const char *const STAGE_NAMES[STAGE_COUNT] = {
+  "rx_wake", "rx_drained", "rx_dequeued", "rx_published", "rx_handled", "tx_first", "tx_done",
+};
+
+struct Histogram {
+  uint32_t count;
+  uint32_t minUs;
+  uint32_t maxUs;
+  uint64_t totalUs;
+  uint32_t buckets[LATENCY_BUCKETS];
+};
+
+Histogram s_histograms[STAGE_COUNT];
+portMUX_TYPE s_mux = portMUX_INITIALIZER_UNLOCKED;
+
+// Values below 4 get a bucket each, then 4 buckets per power of two
+uint8_t bucketFor(uint32_t us) {
+  if (us < LATENCY_SUB_BUCKETS) return us;
+  const uint8_t msb = 31 - __builtin_clz(us);
+  return (msb - 1) * LATENCY_SUB_BUCKETS + ((us >> (msb - 2)) & (LATENCY_SUB_BUCKETS - 1));
+}
+
+uint32_t bucketUpper(uint8_t bucket) {
+  if (bucket < LATENCY_SUB_BUCKETS) return bucket;
+  const uint8_t msb = bucket / LATENCY_SUB_BUCKETS + 1;
+  const uint32_t lower = (LATENCY_SUB_BUCKETS + bucket % LATENCY_SUB_BUCKETS) << (msb - 2);
+  return lower + ((1u << (msb - 2)) - 1);
+}
+
+// Upper bound of the bucket holding the given share of the samples, clamped to the exact extremes
+uint32_t percentile(const Histogram &h, uint32_t permille) {
+  const uint64_t target = (static_cast<uint64_t>(h.count) * permille + 999) / 1000;
+  uint64_t seen = 0;
+  for (uint8_t b = 0; b < LATENCY_BUCKETS; ++b) {
+    seen += h.buckets[b];
+    if (seen >= target) return std::min(std::max(bucketUpper(b), h.minUs), h.maxUs);
+  }
+  return h.maxUs;
+}
+
+} // namespace
+
+uint32_t latencyNowUs() {
+  return static_cast<uint32_t>(esp_timer_get_time());
+}
+
+void recordLatency(LatencyStage stage, uint32_t sinceUs, uint32_t untilUs) {
+  const uint32_t us = untilUs - sinceUs;
+  Histogram &h = s_histograms[static_cast<uint8_t>(stage)];
+  portENTER_CRITICAL(&s_mux);
+  if (h.count == 0) h.minUs = us;
+  h.count++;
+  h.totalUs += us;
+  h.minUs = std::min(h.minUs, us);
+  h.maxUs = std::max(h.maxUs, us);
+  h.buckets[bucketFor(us)]++;
+  portEXIT_CRITICAL(&s_mux);
+}
+
+LatencySummary getLatency(LatencyStage stage) {
+  const Histogram &h = s_histograms[static_cast<uint8_t>(stage)];
+  LatencySummary summary{};
+  portENTER_CRITICAL(&s_mux);
+  if (h.count) {
+    summary.count = h.count;
+    summary.minUs = h.minUs;
+    summary.maxUs = h.maxUs;
+    summary.avgUs = static_cast<uint32_t>(h.totalUs / h.count);
+    summary.p50Us = percentile(h, 500);
+    summary.p99Us = percentile(h, 990);
+  }
+  portEXIT_CRITICAL(&s_mux);
+  return summary;
+}
+
+void resetLatency() {
+  portENTER_CRITICAL(&s_mux);
+  for (auto &h : s_histograms) h = Histogram{};
+  portEXIT_CRITICAL(&s_mux);
+}
+
+const char *latencyStageName(LatencyStage stage) {
+  return stage < LatencyStage::Count ? STAGE_NAMES[static_cast<uint8_t>(stage)] : "?";
+}
+
+void appendLatencyMetrics(JsonObject &stages) {
+  for (uint8_t i = 0; i < STAGE_COUNT; ++i) {
+    const auto stage = static_cast<LatencyStage>(i);
+    const LatencySummary s = getLatency(stage);
+    JsonObject entry = stages[latencyStageName(stage)].to<JsonObject>();
+    entry["count"] = s.count;
+    entry["minUs"] = s.minUs;
+    entry["avgUs"] = s.avgUs;
+    entry["p50Us"] = s.p50Us;
+    entry["p99Us"] = s.p99Us;
+    entry["maxUs"] = s.maxUs;
+  }
+}
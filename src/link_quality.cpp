@@ -0,0 +1,93 @@
+#include <link_quality.h>
+
+#include <Arduino.h>
+
+#include <iohcCryptoHelpers.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+struct Entry {
+  bool used = false;
+  LinkQuality quality{};
+};
+
+Entry s_table[LINK_QUALITY_MAX_DEVICES];
+portMUX_TYPE s_mux = portMUX_INITIALIZER_UNLOCKED;
+
+Entry *slotFor(const uint8_t *source) {
+  Entry *oldest = nullptr;
+  for (auto &entry : s_table) {
+    if (!entry.used) return &entry;
+    if (memcmp(entry.quality.address, source, sizeof(entry.quality.address)) == 0) return &entry;
+    if (!oldest || static_cast<int32_t>(entry.quality.lastSeenMs - oldest->quality.lastSeenMs) < 0)
+      oldest = &entry;
+  }
+  return oldest;
+}
+
+} // namespace
+
+void recordLinkQuality(const uint8_t *source, float rssi, float afc, uint8_t lnaDb, uint32_t frequency) {
+  const uint32_t now = millis();
+  portENTER_CRITICAL(&s_mux);
+  Entry *entry = slotFor(source);
+  LinkQuality &q = entry->quality;
+  if (!entry->used || memcmp(q.address, source, sizeof(q.address)) != 0) {
+    entry->used = true;
+    q = LinkQuality{};
+    memcpy(q.address, source, sizeof(q.address));
+    q.rssiMin = q.rssiMax = q.rssiAvg = rssi;
+    q.afcAvg = afc;
+  } else {
+    q.rssiMin = std::min(q.rssiMin, rssi);
+    q.rssiMax = std::max(q.rssiMax, rssi);
+    q.rssiAvg += (rssi - q.rssiAvg) / LINK_QUALITY_SMOOTHING;
+    q.afcAvg += (afc - q.afcAvg) / LINK_QUALITY_SMOOTHING;
+  }
+  q.frames++;
+  q.rssiLast = rssi;
+  q.lnaDb = lnaDb;
+  q.frequency = frequency;
+  q.lastSeenMs = now;
+  portEXIT_CRITICAL(&s_mux);
+}
+
+std::vector<LinkQuality> getLinkQuality() {
+  std::vector<LinkQuality> out;
+  out.reserve(LINK_QUALITY_MAX_DEVICES);
+  portENTER_CRITICAL(&s_mux);
+  for (const auto &entry : s_table) {
+    if (entry.used) out.push_back(entry.quality);
+  }
+  portEXIT_CRITICAL(&s_mux);
+  std::sort(out.begin(), out.end(), [](const LinkQuality &a, const LinkQuality &b) {
+    return static_cast<int32_t>(a.lastSeenMs - b.lastSeenMs) > 0;
+  });
+  return out;
+}
+
+void resetLinkQuality() {
+  portENTER_CRITICAL(&s_mux);
+  for (auto &entry : s_table) entry.used = false;
+  portEXIT_CRITICAL(&s_mux);
+}
+
+void appendLinkQuality(JsonArray &devices) {
+  const uint32_t now = millis();
+  for (const auto &q : getLinkQuality()) {
+    JsonObject device = devices.add<JsonObject>();
+    device["address"] = bytesToHexString(q.address, sizeof(q.address));
+    device["frames"] = q.frames;
+    device["rssi"] = q.rssiLast;
+    device["rssiMin"] = q.rssiMin;
+    device["rssiAvg"] = roundf(q.rssiAvg * 10) / 10;
+    device["rssiMax"] = q.rssiMax;
+    device["afc"] = lroundf(q.afcAvg);
+    device["lna"] = q.lnaDb;
+    device["frequency"] = q.frequency;
+    device["ageS"] = (now - q.lastSeenMs) / 1000;
+  }
+}
@@ -1,34 +1,119 @@
-#include <deque>
-#include <vector>
 #include <Arduino.h>
 #include <log_buffer.h>
 #include <user_config.h>
+#include <algorithm>
+#include <cstring>
 
-#if defined(WEBSERVER)
-#include <web_server_handler.h>
-#endif
 #if defined(SYSLOG)
 #include <syslog_helper.h>
 #endif
 
 namespace {
-    std::deque<String> logDeque;
-    const size_t MAX_LOG_ENTRIES = 50;
+    /* Each record is a 1 byte length followed by the message, wrapping around
+     * the end of the ring. IDs are consecutive, so only the ID of the oldest
+     * record is stored. Writers hold a spinlock just long enough to copy one
+     * record, readers one record at a time. */
+    constexpr size_t RING_SIZE = LOG_BUFFER_KB * 1024;
+    constexpr size_t RECORD_HEADER = 1;
+
+    uint8_t s_ring[RING_SIZE];
+    size_t s_head = 0;       // where the next record is written
+    size_t s_tail = 0;       // oldest record
+    size_t s_used = 0;
+    uint32_t s_firstId = 1;  // ID of the record at s_tail
+    uint32_t s_nextId = 1;
+    portMUX_TYPE s_mux = portMUX_INITIALIZER_UNLOCKED;
+
+    void ringWrite(size_t pos, const void *data, size_t len) {
+        const size_t first = std::min(len, RING_SIZE - pos);
+        memcpy(s_ring + pos, data, first);
+        memcpy(s_ring, static_cast<const uint8_t *>(data) + first, len - first);
+    }
+
+    void ringRead(size_t pos, void *data, size_t len) {
+        const size_t first = std::min(len, RING_SIZE - pos);
+        memcpy(data, s_ring + pos, first);
+        memcpy(static_cast<uint8_t *>(data) + first, s_ring, len - first);
+    }
+
+    size_t recordSize(size_t pos) {
+        return RECORD_HEADER + s_ring[pos];
+    }
+
+    void dropOldestLocked() {
+        const size_t size = recordSize(s_tail);
+        s_tail = (s_tail + size) % RING_SIZE;
+        s_used -= size;
+        ++s_firstId;
+    }
 }
 
-void addLogMessage(const String &msg) {
-    if (logDeque.size() >= MAX_LOG_ENTRIES) {
-        logDeque.pop_front();
+void addLogMessage(const char *msg, size_t len, int severity) {
+    const uint8_t stored = static_cast<uint8_t>(std::min<size_t>(len, LOG_MAX_MESSAGE));
+    const size_t size = RECORD_HEADER + stored;
+
+    portENTER_CRITICAL(&s_mux);
+    while (s_used + size > RING_SIZE) {
+        dropOldestLocked();
     }
-    logDeque.push_back(msg);
-#if defined(WEBSERVER)
-    //broadcastLog(msg);
-#endif
+    s_ring[s_head] = stored;
+    ringWrite((s_head + RECORD_HEADER) % RING_SIZE, msg, stored);
+    s_head = (s_head + size) % RING_SIZE;
+    s_used += size;
+    ++s_nextId;
+    portEXIT_CRITICAL(&s_mux);
+
 #if defined(SYSLOG)
-    sendSyslog(msg);
+    sendSyslog(msg, stored, severity);
 #endif
 }
 
-std::vector<String> getLogMessages() {
-    return std::vector<String>(logDeque.begin(), logDeque.end());
+void addLogMessage(const String &msg) {
+    addLogMessage(msg.c_str(), msg.length());
+}
+
+uint32_t readLogMessages(uint32_t since, const std::function<void(uint32_t id, const char *msg, size_t len)> &emit) {
+    char msg[LOG_MAX_MESSAGE + 1];
+    uint32_t missed = 0;
+    uint32_t id = since + 1;
+    size_t pos = 0;
+    bool positioned = false;
+
+    for (;;) {
+        size_t len;
+        portENTER_CRITICAL(&s_mux);
+        if (id >= s_nextId) {
+            portEXIT_CRITICAL(&s_mux);
+            break;
+        }
+        if (id < s_firstId) {
+            // Overwritten before or while reading; continue with the oldest
+            missed += s_firstId - id;
+            id = s_firstId;
+            positioned = false;
+        }
+        if (!positioned) {
+            // Walk the length prefixes from the oldest record to the requested one
+            pos = s_tail;
+            for (uint32_t skip = s_firstId; skip < id; ++skip) {
+                pos = (pos + recordSize(pos)) % RING_SIZE;
+            }
+            positioned = true;
+        }
+        len = s_ring[pos];
+        ringRead((pos + RECORD_HEADER) % RING_SIZE, msg, len);
+        pos = (pos + RECORD_HEADER + len) % RING_SIZE;
+        portEXIT_CRITICAL(&s_mux);
+
+        msg[len] = '\0';
+        emit(id++, msg, len);
+    }
+    return missed;
+}
+
+uint32_t lastLogId() {
+    portENTER_CRITICAL(&s_mux);
+    const uint32_t id = s_nextId - 1;
+    portEXIT_CRITICAL(&s_mux);
+    return id;
 }
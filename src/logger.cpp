@@ -0,0 +1,452 @@
+#include <logger.h>
+
+#include <Arduino.h>
+#include <log_buffer.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <strings.h>
+
+extern "C" {
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+}
+
+volatile uint8_t logModuleLevels[static_cast<uint8_t>(LogModule::Count)] = {
+  static_cast<uint8_t>(LOGGER_DEFAULT_LEVEL), static_cast<uint8_t>(LOGGER_DEFAULT_LEVEL),
+  static_cast<uint8_t>(LOGGER_DEFAULT_LEVEL), static_cast<uint8_t>(LOGGER_DEFAULT_LEVEL),
+  static_cast<uint8_t>(LOGGER_DEFAULT_LEVEL), static_cast<uint8_t>(LogLevel::Verbose),
+};
+
+namespace {
+
+constexpr size_t RING_SIZE = LOGGER_RING_KB * 1024;
+constexpr size_t MAX_RECORD = 512;
+constexpr const char *MODULE_NAMES[] = {"core", "radio", "mqtt", "web", "script", "idf"};
+constexpr const char *LEVEL_NAMES[] = {"none", "error", "warn", "info", "debug", "verbose"};
+constexpr char LEVEL_LETTERS[] = "-EWIDV";
+// Syslog severity per level: error, warning, informational, debug
+constexpr int LEVEL_SEVERITIES[] = {6, 3, 4, 6, 7, 7};
+
+static_assert(sizeof(MODULE_NAMES) / sizeof(MODULE_NAMES[0]) == static_cast<size_t>(LogModule::Count),
+              "every module needs a name");
+
+/* Record: u16 size, u8 level, u8 module, u32 millis, format pointer, then the
+ * arguments in format order at their natural size. Strings are stored as a
+ * u8 length plus bytes. The same format walk packs and unpacks, so no type
+ * tags are needed. */
+struct RecordHeader {
+  uint16_t size;
+  uint8_t level;
+  uint8_t module;
+  uint32_t ms;
+  const char *fmt;
+};
+
+uint8_t s_ring[RING_SIZE];
+size_t s_head = 0;
+size_t s_tail = 0;
+size_t s_used = 0;
+portMUX_TYPE s_mux = portMUX_INITIALIZER_UNLOCKED;
+TaskHandle_t s_task = nullptr;
+std::atomic<uint32_t> s_written{0};
+std::atomic<uint32_t> s_dropped{0};
+std::atomic<uint32_t> s_formatted{0};
+
+void ringWrite(size_t pos, const void *data, size_t len) {
+  const size_t first = std::min(len, RING_SIZE - pos);
+  memcpy(s_ring + pos, data, first);
+  memcpy(s_ring, static_cast<const uint8_t *>(data) + first, len - first);
+}
+
+void ringRead(size_t pos, void *data, size_t len) {
+  const size_t first = std::min(len, RING_SIZE - pos);
+  memcpy(data, s_ring + pos, first);
+  memcpy(static_cast<uint8_t *>(data) + first, s_ring, len - first);
+}
+
+enum class ArgKind : uint8_t {
+  None,
+  Int,
+  Long,
+  LongLong,
+  Size,
+  Double,
+  String,
+  Pointer,
+};
+
+// One conversion of a printf format
+struct Spec {
+  const char *start;   // at the '%'
+  size_t len;          // up to and including the conversion character
+  bool starWidth;
+  bool starPrecision;
+  int precision;       // -1 when absent or given by '*'
+  ArgKind kind;
+};
+
+/* Advance to the next conversion. Returns false at the end of the format;
+ * "%%" comes back as a Spec with kind None. */
+bool nextSpec(const char *&p, Spec &spec) {
+  while (*p && *p != '%') ++p;
+  if (!*p) return false;
+  spec = Spec{p, 0, false, false, -1, ArgKind::None};
+  const char *q = p + 1;
+  while (*q && strchr("-+ #0", *q)) ++q;
+  if (*q == '*') {
+    spec.starWidth = true;
+    ++q;
+  }
+  while (*q >= '0' && *q <= '9') ++q;
+  if (*q == '.') {
+    ++q;
+    if (*q == '*') {
+      spec.starPrecision = true;
+      ++q;
+    } else {
+      spec.precision = 0;
+    }
+    while (*q >= '0' && *q <= '9') spec.precision = spec.precision * 10 + (*q++ - '0');
+  }
+  ArgKind integer = ArgKind::Int;
+  if (*q == 'h') {
+    while (*q == 'h') ++q;
+  } else if (*q == 'l') {
+    ++q;
+    integer = ArgKind::Long;
+    if (*q == 'l') {
+      ++q;
+      integer = ArgKind::LongLong;
+    }
+  } else if (*q == 'j') {
+    ++q;
+    integer = ArgKind::LongLong;
+  } else if (*q == 'z' || *q == 't') {
+    ++q;
+    integer = ArgKind::Size;
+  } else if (*q == 'L') {
+    ++q;
+  }
+  switch (*q) {
+    case 'd': case 'i': case 'u': case 'x': case 'X': case 'o': case 'c':
+      spec.kind = integer;
+      break;
+    case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+      spec.kind = ArgKind::Double;
+      break;
+    case 's':
+      spec.kind = ArgKind::String;
+      break;
+    case 'p': case 'n':
+      spec.kind = ArgKind::Pointer;
+      break;
+    case '\0':
+      p = q;
+      return false;
+    default:
+      break;
+  }
+  ++q;
+  spec.len = q - p;
+  p = q;
+  return true;
+}
+
+// Writes arguments straight into the ring, wrapping at the end
+class Packer {
+public:
+  Packer(size_t pos, size_t cap) : _pos(pos), _cap(cap) {}
+
+  template <typename T>
+  void put(T value) { raw(&value, sizeof(value)); }
+
+  // A precision bounds the read: "%.*s" arguments need not be NUL-terminated
+  void string(const char *str, int precision) {
+    if (!str) str = "(null)";
+    const size_t max = precision >= 0 ? std::min<size_t>(precision, LOGGER_MAX_STRING) : LOGGER_MAX_STRING;
+    const uint8_t len = static_cast<uint8_t>(strnlen(str, max));
+    put(len);
+    raw(str, len);
+  }
+
+  size_t size() const { return _len; }
+  bool overflow() const { return _overflow; }
+
+private:
+  void raw(const void *data, size_t len) {
+    if (_overflow || _len + len > _cap) {
+      _overflow = true;
+      return;
+    }
+    ringWrite((_pos + _len) % RING_SIZE, data, len);
+    _len += len;
+  }
+
+  size_t _pos;
+  size_t _cap;
+  size_t _len = 0;
+  bool _overflow = false;
+};
+
+class Unpacker {
+public:
+  Unpacker(const uint8_t *buf, size_t len) : _buf(buf), _len(len) {}
+
+  template <typename T>
+  T get() {
+    T value{};
+    if (_pos + sizeof(T) <= _len) memcpy(&value, _buf + _pos, sizeof(T));
+    _pos += sizeof(T);
+    return value;
+  }
+
+  // Copies into `out`, which holds at least LOGGER_MAX_STRING + 1 bytes
+  void string(char *out) {
+    const uint8_t len = std::min<size_t>(get<uint8_t>(), LOGGER_MAX_STRING);
+    const size_t avail = _pos < _len ? std::min<size_t>(len, _len - _pos) : 0;
+    memcpy(out, _buf + std::min(_pos, _len), avail);
+    out[avail] = '\0';
+    _pos += len;
+  }
+
+private:
+  const uint8_t *_buf;
+  size_t _len;
+  size_t _pos = 0;
+};
+
+void packArgs(Packer &out, const char *fmt, va_list args) {
+  Spec spec;
+  while (nextSpec(fmt, spec)) {
+    int precision = spec.precision;
+    if (spec.starWidth) out.put<int>(va_arg(args, int));
+    if (spec.starPrecision) {
+      precision = va_arg(args, int);
+      out.put<int>(precision);
+    }
+    switch (spec.kind) {
+      case ArgKind::Int: out.put<int>(va_arg(args, int)); break;
+      case ArgKind::Long: out.put<long>(va_arg(args, long)); break;
+      case ArgKind::LongLong: out.put<long long>(va_arg(args, long long)); break;
+      case ArgKind::Size: out.put<size_t>(va_arg(args, size_t)); break;
+      case ArgKind::Double: out.put<double>(va_arg(args, double)); break;
+      case ArgKind::String: out.string(va_arg(args, const char *), precision); break;
+      case ArgKind::Pointer: out.put<void *>(va_arg(args, void *)); break;
+      case ArgKind::None: break;
+    }
+  }
+}
+
+// Formats one conversion with its own snprintf call
+template <typename T>
+size_t formatOne(char *out, size_t cap, const Spec &spec, int width, int precision, T value) {
+  char conv[16];
+  const size_t len = std::min(spec.len, sizeof(conv) - 1);
+  memcpy(conv, spec.start, len);
+  conv[len] = '\0';
+  int n;
+  if (spec.starWidth && spec.starPrecision) n = snprintf(out, cap, conv, width, precision, value);
+  else if (spec.starWidth) n = snprintf(out, cap, conv, width, value);
+  else if (spec.starPrecision) n = snprintf(out, cap, conv, precision, value);
+  else n = snprintf(out, cap, conv, value);
+  return n < 0 ? 0 : std::min<size_t>(n, cap ? cap - 1 : 0);
+}
+
+size_t formatRecord(char *out, size_t cap, const char *fmt, Unpacker &in) {
+  size_t len = 0;
+  auto append = [&](const char *text, size_t n) {
+    n = std::min(n, cap - 1 - len);
+    memcpy(out + len, text, n);
+    len += n;
+  };
+
+  const char *p = fmt;
+  Spec spec;
+  for (;;) {
+    const char *literal = p;
+    const bool more = nextSpec(p, spec);
+    append(literal, (more ? spec.start : p) - literal);
+    if (!more) break;
+    if (spec.kind == ArgKind::None) {
+      append("%", spec.start[spec.len - 1] == '%' ? 1 : 0);
+      continue;
+    }
+    const int width = spec.starWidth ? in.get<int>() : 0;
+    const int precision = spec.starPrecision ? in.get<int>() : 0;
+    char *dst = out + len;
+    const size_t room = cap - len;
+    switch (spec.kind) {
+      case ArgKind::Int: len += formatOne(dst, room, spec, width, precision, in.get<int>()); break;
+      case ArgKind::Long: len += formatOne(dst, room, spec, width, precision, in.get<long>()); break;
+      case ArgKind::LongLong: len += formatOne(dst, room, spec, width, precision, in.get<long long>()); break;
+      case ArgKind::Size: len += formatOne(dst, room, spec, width, precision, in.get<size_t>()); break;
+      case ArgKind::Double: len += formatOne(dst, room, spec, width, precision, in.get<double>()); break;
+      case ArgKind::String: {
+        char str[LOGGER_MAX_STRING + 1];
+        in.string(str);
+        len += formatOne(dst, room, spec, width, precision, static_cast<const char *>(str));
+        break;
+      }
+      case ArgKind::Pointer:
+        // %n is never written through
+        if (spec.start[spec.len - 1] == 'p') len += formatOne(dst, room, spec, width, precision, in.get<void *>());
+        else in.get<void *>();
+        break;
+      case ArgKind::None: break;
+    }
+  }
+  out[len] = '\0';
+  return len;
+}
+
+void emitLine(const RecordHeader &header, const uint8_t *args, size_t argLen) {
+  char line[LOGGER_MAX_LINE];
+  size_t len = 0;
+  const bool idf = header.module == static_cast<uint8_t>(LogModule::Idf);
+  if (!idf) {
+    // Same shape as ESP-IDF lines: "D (1234) radio: message"
+    const int n = snprintf(line, sizeof(line), "%c (%lu) %s: ", LEVEL_LETTERS[header.level],
+                           static_cast<unsigned long>(header.ms), MODULE_NAMES[header.module]);
+    len = n < 0 ? 0 : std::min<size_t>(n, sizeof(line) - 1);
+  }
+  Unpacker in(args, argLen);
+  len += formatRecord(line + len, sizeof(line) - len, header.fmt, in);
+  // ESP-IDF formats end in a newline, facade formats may not
+  while (len && (line[len - 1] == '\n' || line[len - 1] == '\r')) --len;
+  line[len] = '\0';
+
+  Serial.write(reinterpret_cast<const uint8_t *>(line), len);
+  Serial.write('\n');
+  addLogMessage(line, len, LEVEL_SEVERITIES[header.level]);
+  ++s_formatted;
+}
+
+void loggerTask(void *) {
+  static uint8_t record[MAX_RECORD];
+  uint32_t reportedDrops = 0;
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(1000));
+    for (;;) {
+      RecordHeader header;
+      portENTER_CRITICAL(&s_mux);
+      if (!s_used) {
+        portEXIT_CRITICAL(&s_mux);
+        break;
+      }
+      ringRead(s_tail, &header, sizeof(header));
+      ringRead((s_tail + sizeof(header)) % RING_SIZE, record, header.size - sizeof(header));
+      s_tail = (s_tail + header.size) % RING_SIZE;
+      s_used -= header.size;
+      portEXIT_CRITICAL(&s_mux);
+
+      emitLine(header, record, header.size - sizeof(header));
+    }
+    const uint32_t dropped = s_dropped;
+    if (dropped != reportedDrops) {
+      LOG_W(Core, "%u log records dropped (ring full)", static_cast<unsigned>(dropped - reportedDrops));
+      reportedDrops = dropped;
+    }
+  }
+}
+
+} // namespace
+
+void logWriteV(LogModule module, LogLevel level, const char *fmt, va_list args) {
+  if (!logEnabled(module, level) || !fmt) return;
+
+  RecordHeader header{0, static_cast<uint8_t>(level), static_cast<uint8_t>(module),
+                      static_cast<uint32_t>(millis()), fmt};
+  va_list copy;
+  va_copy(copy, args);
+  bool wake = false;
+  // Arguments are packed in place, so nothing is staged on the caller's stack
+  portENTER_CRITICAL_SAFE(&s_mux);
+  const size_t room = std::min(RING_SIZE - s_used, MAX_RECORD);
+  if (room > sizeof(header)) {
+    Packer packer((s_head + sizeof(header)) % RING_SIZE, room - sizeof(header));
+    packArgs(packer, fmt, copy);
+    if (!packer.overflow()) {
+      header.size = sizeof(header) + packer.size();
+      ringWrite(s_head, &header, sizeof(header));
+      s_head = (s_head + header.size) % RING_SIZE;
+      wake = s_used == 0;
+      s_used += header.size;
+    }
+  }
+  portEXIT_CRITICAL_SAFE(&s_mux);
+  va_end(copy);
+
+  if (!header.size) {
+    ++s_dropped;
+    return;
+  }
+  ++s_written;
+  // Only the first record after the task emptied the ring needs a wake-up
+  if (wake && s_task) {
+    if (xPortInIsrContext()) {
+      BaseType_t woken = pdFALSE;
+      vTaskNotifyGiveFromISR(s_task, &woken);
+      if (woken) portYIELD_FROM_ISR();
+    } else {
+      xTaskNotifyGive(s_task);
+    }
+  }
+}
+
+void logWrite(LogModule module, LogLevel level, const char *fmt, ...) {
+  va_list args;
+  va_start(args, fmt);
+  logWriteV(module, level, fmt, args);
+  va_end(args);
+}
+
+void initLogger() {
+  if (s_task) return;
+  if (xTaskCreatePinnedToCore(loggerTask, "logger", 4096, nullptr, 1, &s_task, 0) != pdPASS) {
+    Serial.println("Failed to create logger task");
+    s_task = nullptr;
+  }
+}
+
+void setLogLevel(LogModule module, LogLevel level) {
+  logModuleLevels[static_cast<uint8_t>(module)] = static_cast<uint8_t>(level);
+}
+
+LogLevel getLogLevel(LogModule module) {
+  return static_cast<LogLevel>(logModuleLevels[static_cast<uint8_t>(module)]);
+}
+
+const char *logModuleName(LogModule module) {
+  return MODULE_NAMES[static_cast<uint8_t>(module)];
+}
+
+const char *logLevelName(LogLevel level) {
+  return LEVEL_NAMES[static_cast<uint8_t>(level)];
+}
+
+bool parseLogModule(const char *name, LogModule &module) {
+  for (uint8_t i = 0; i < static_cast<uint8_t>(LogModule::Count); ++i) {
+    if (strcasecmp(name, MODULE_NAMES[i]) == 0) {
+      module = static_cast<LogModule>(i);
+      return true;
+    }
+  }
+  return false;
+}
+
+bool parseLogLevel(const char *name, LogLevel &level) {
+  for (uint8_t i = 0; i < sizeof(LEVEL_NAMES) / sizeof(LEVEL_NAMES[0]); ++i) {
+    if (strcasecmp(name, LEVEL_NAMES[i]) == 0 || (name[0] == '0' + i && name[1] == '\0')) {
+      level = static_cast<LogLevel>(i);
+      return true;
+    }
+  }
+  return false;
+}
+
+LoggerStats getLoggerStats() {
+  return {s_written.load(), s_dropped.load(), s_formatted.load()};
+}
@@ -32,12 +32,25 @@
 #include <iohcRemoteMap.h>
 #include <interact.h>
 #include <version_info.h>
+#include <cover_state_bus.h>
+#include <script_runner.h>
+#include <link_quality.h>
+#include <latency_metrics.h>
 #if defined(MQTT)
 #include <mqtt_handler.h>
+#include <frame_telemetry.h>
 #endif
 #include <wifi_helper.h>
 #include <nvs_helpers.h>
+#include <syslog_helper.h>
 #include "log_buffer.h"
+#include <logger.h>
+#include <timer_service.h>
+#if __has_include(<esp_memory_utils.h>)
+#include <esp_memory_utils.h>
+#else
+#include <soc/soc_memory_layout.h>
+#endif
 #include <stdarg.h>
 #include <algorithm>
 #include <cstring>
@@ -58,7 +71,7 @@ extern "C" {
 #include "freertos/task.h"
 }
 
-void txUserBuffer(Tokens *cmd);
+void txUserBuffer(const TokenView *cmd);
 void testKey();
 void scanDump();
 bool publishMsg(IOHC::iohcPacket *iohc);
@@ -87,17 +100,25 @@ constexpr uint8_t kNumScanFrequencies =
 
 using namespace IOHC;
 
-// Custom log vprintf that also stores to buffer
+// ESP-IDF log output goes through the deferred logger: the record keeps the
+// format pointer and the raw arguments and is formatted on the logger task.
+// Formats outside flash might not outlive the call, so those are formatted here.
 int log_to_buffer_and_serial(const char *format, va_list args) {
-    char buf[256];
-    vsnprintf(buf, sizeof(buf), format, args); // Format naar buffer
-    addLogMessage(String(buf));                // In je logbuffer
-    return Serial.printf("%s", buf);           // Ook naar Serial
+    if (esp_ptr_in_drom(format)) {
+        logWriteV(LogModule::Idf, LogLevel::Info, format, args);
+        return 0;
+    }
+    char buf[LOGGER_MAX_LINE];
+    const int len = vsnprintf(buf, sizeof(buf), format, args);
+    logWrite(LogModule::Idf, LogLevel::Info, "%s", buf);
+    return len;
 }
 
 void setup() {
 
     Serial.begin(115200);       //Start serial connection for debug and manual input
+    initLogger();
+    initTimerService();
     esp_log_set_vprintf(log_to_buffer_and_serial);
     esp_log_level_set("*", ESP_LOG_DEBUG);    // Or VERBOSE for ESP_LOGV
 
@@ -120,6 +141,8 @@ void setup() {
     Serial.println("LittleFS mounted successfully");
 #endif
     nvs_init();
+    startSyslogSender();
+    initCoverStateBus();
 
     // Load 1W device definitions before starting network services so
     // that /api/devices can immediately return the configured remotes.
@@ -138,6 +161,7 @@ void setup() {
     //   AES_init_ctx(&ctx, transfert_key); // PreInit AES for cozy (1W use original version) TODO
 
     Cmd::createCommands();
+    initScriptRunner();
 
     // Initialize network services after devices are ready
     initWifi();
@@ -145,7 +169,7 @@ void setup() {
 #if defined(MQTT)
     initMqtt();
 #endif
-    Cmd::kbd_tick.attach_ms(500, Cmd::cmdFuncHandler);
+    Cmd::init();
 
 //    esp_timer_dump(stdout);
 
@@ -193,9 +217,13 @@ bool msgRcvd(IOHC::iohcPacket *iohc) {
     JsonDocument doc;
     doc["type"] = "Unk";
     memcpy(IOHC::lastFromAddress, iohc->payload.packet.header.source, sizeof(IOHC::lastFromAddress));
+    scriptFrameReceived(iohc->payload.packet.header.source);
+    recordLinkQuality(iohc->payload.packet.header.source, iohc->rssi, static_cast<float>(iohc->afc), iohc->lna,
+                      iohc->frequency);
 #if defined(WEBSERVER)
-    broadcastLastAddress(bytesToHexString(IOHC::lastFromAddress, sizeof(IOHC::lastFromAddress)).c_str());
+    broadcastLastAddress(IOHC::lastFromAddress);
 #endif
+    broadcastFrame(iohc);
     String deviceId =
         bytesToHexString(iohc->payload.packet.header.source,
                          sizeof(iohc->payload.packet.header.source))
@@ -581,56 +609,24 @@ bool msgRcvd(IOHC::iohcPacket *iohc) {
     }
 
     publishMsg(iohc);
+#if defined(MQTT)
+    recordLatency(LatencyStage::RxPublished, iohc->stampUs);
+#endif
     return true;
 }
 
 /**
- * The function creates a JSON message from an `iohcPacket` object and publishes it using
- * MQTT if enabled.
+ * The function publishes a received frame to the enabled MQTT frame sinks (JSON and/or CBOR).
  * 
  * @param iohc The `iohc` parameter is a pointer to an object of type `IOHC::iohcPacket`. The function
- * `publishMsg` takes this pointer as input and processes the data within the `iohc` object to create a
- * JSON message and publish it using MQTT if the conditions are met.
+ * `publishMsg` hands it to `publishFrameTelemetry`, which encodes it for every sink selected in
+ * `mqtt_frame_sinks`.
  * 
  * @return The function `publishMsg` is returning `false`.
  */
 bool publishMsg(IOHC::iohcPacket *iohc) {
-    JsonDocument doc;
-
-    doc["type"] = "Cozy";
-    doc["from"] = bytesToHexString(iohc->payload.packet.header.target, 3);
-    doc["to"] = bytesToHexString(iohc->payload.packet.header.source, 3);
-    doc["cmd"] = to_hex_str(iohc->payload.packet.header.cmd).c_str();
-    doc["_data"] = bytesToHexString(iohc->payload.buffer + 9, iohc->buffer_length - 9);
-    if (remoteMap) {
-        if (const auto *map = remoteMap->find(iohc->payload.packet.header.source)) {
-            doc["remote"] = map->name;
-        }
-    }
-
-    if (iohc->payload.packet.header.CtrlByte1.asStruct.Protocol == 1 &&
-        iohc->payload.packet.header.cmd == 0x00) {
-        uint16_t main =
-                (iohc->payload.packet.msg.p0x00_14.main[0] << 8) |
-                iohc->payload.packet.msg.p0x00_14.main[1];
-        const char *action = "unknown";
-        switch (main) {
-            case 0x0000: action = "open"; break;
-            case 0xC800: action = "close"; break;
-            case 0xD200: action = "stop"; break;
-            case 0xD803: action = "vent"; break;
-            case 0x6400: action = "force"; break;
-            default: break;
-        }
-        doc["type"] = "1W";
-        doc["action"] = action;
-    }
-
-    std::string message;
-    size_t messageSize = serializeJson(doc, message);
 #if defined(MQTT)
-    mqttClient.publish("iown/Frame", 1, false, message.c_str(), messageSize);
-    mqttClient.publish((mqtt_discovery_topic + "/sensor/iohc_frame/state").c_str(), 0, false, message.c_str(), messageSize);
+    publishFrameTelemetry(iohc);
 #endif
     return false;
 }
@@ -682,7 +678,7 @@ bool msgArchive(IOHC::iohcPacket *iohc) {
  * The function `txUserBuffer` sends a packet using a radio instance based on the input command and
  * frequency.
  * 
- * @param cmd The `cmd` parameter is a pointer to a `Tokens` object. It seems like the `Tokens` class
+ * @param cmd The `cmd` parameter is a pointer to a `TokenView` object. It seems like the `TokenView` class
  * has a method `size()` that returns the size of the object, and an `at()` method that retrieves a
  * specific element at a given index. The function `txUserBuffer`
  * 
@@ -690,7 +686,7 @@ bool msgArchive(IOHC::iohcPacket *iohc) {
  * does not return any value. Instead, it performs certain operations and then exits the function
  * without returning any specific value.
  */
-void txUserBuffer(Tokens *cmd) {
+void txUserBuffer(const TokenView *cmd) {
     if (cmd->size() < 2) {
         Serial.printf("No packet to be sent!\n");
         return;
@@ -698,12 +694,13 @@ void txUserBuffer(Tokens *cmd) {
     digitalWrite(RX_LED, digitalRead(RX_LED) ^ 1);
     auto *packet = new iohcPacket;
 
-    if (cmd->size() == 3)
-        packet->frequency = frequencies[atoi(cmd->at(2).c_str()) - 1];
+    int channel = 0;
+    if (cmd->size() == 3 && cmd->integer(2, channel) && channel > 0 && channel <= kNumScanFrequencies)
+        packet->frequency = frequencies[channel - 1];
     else
         packet->frequency = 0;
 
-    packet->buffer_length = hexStringToBytes(cmd->at(1), packet->payload.buffer);
+    packet->buffer_length = hexStringToBytes(std::string(cmd->at(1)), packet->payload.buffer);
     packet->repeatTime = 35;
     packet->repeat = 1;
 
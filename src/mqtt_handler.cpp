@@ -2,9 +2,13 @@
 
 #if defined(MQTT)
 
+#include <mqtt_outbox.h>
+#include <frame_telemetry.h>
 #include <firmware_version.h>
 #include <iohcRemote1W.h>
 #include <iohcCryptoHelpers.h>
+#include <link_quality.h>
+#include <timer_service.h>
 #include <version_info.h>
 #include <AsyncMqttClient.h>
 #include <ArduinoJson.h>
@@ -17,32 +21,46 @@
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
 #include <nvs_helpers.h>
-#include <atomic>
+#include <map>
+#include <deque>
+#include <tuple>
+#include <charconv>
+#include <string_view>
+#include <freertos/semphr.h>
 #include "wifi_helper.h"
 
+#ifndef MQTT_DISCOVERY_CACHE_BYTES
+#define MQTT_DISCOVERY_CACHE_BYTES (64 * 1024) // Upper bound for cached discovery payloads
+#endif
+
 AsyncMqttClient mqttClient;
 static const char AVAILABILITY_TOPIC[] = "iown/status";
 static const char FREE_MEM_TOPIC[] = "iown/info/free_mem";
 static const char WIFI_STRENGTH_TOPIC[] = "iown/info/wifi_rssi";
 static const char IP_ADDRESS_TOPIC[] = "iown/info/ip";
+static const char LINK_QUALITY_TOPIC[] = "iown/info/link_quality";
 static const char VERSION_TOPIC[] = "iown/info/version";
 static const char VERSION_ATTRIBUTES_TOPIC[] = "iown/info/version/attributes";
 static const char VERSION_LATEST_TOPIC[] = "iown/info/version/latest";
 static const char VERSION_CHECK_COMPLETED_TOPIC[] = "iown/info/version/check_completed";
 static const char VERSION_CHECK_OK_TOPIC[] = "iown/info/version/check_ok";
 static const char VERSION_UPDATE_AVAILABLE_TOPIC[] = "iown/info/version/update_available";
+static const char GROUP_SET_TOPIC[] = "iown/group/set";
+static const char GROUP_RESULT_TOPIC[] = "iown/group/result";
 static const char GATEWAY_ID[] = "MyOpenIO";
 static const char VERSION_ENTITY_ID[] = "iohc_version";
 static const char VERSION_LATEST_ENTITY_ID[] = "iohc_latest_version";
 static const char VERSION_UPDATE_ENTITY_ID[] = "iohc_update_available";
-static TaskHandle_t s_mqttSchedulerTask = nullptr;
-static std::atomic<bool> s_heartbeatEnabled{false};
-static std::atomic<uint32_t> s_nextHeartbeatAtMs{0};
+static TimerToken s_reconnectTimer{};
+static TimerToken s_heartbeatTimer{};
 static uint32_t s_lastMqttConnectAttemptMs = 0;
+static SemaphoreHandle_t s_deviceCacheMutex = nullptr;  // guards s_deviceCache, created by initMqtt
 static constexpr uint32_t MQTT_RECONNECT_INTERVAL_MS = 5000;
+static constexpr uint64_t MQTT_HEARTBEAT_INTERVAL_US = 60000000ULL;
 static TaskHandle_t s_mqttPostConnectTask = nullptr;
 
-static void mqttSchedulerTask(void*);
+static void reconnectTick();
+static void heartbeatTick();
 static void publishIohcFrameDiscovery();
 static void publishFreeMemDiscovery();
 static void publishIpAddressDiscovery();
@@ -54,17 +72,18 @@ static void onMqttMessage(char *topic, char *payload,
                    AsyncMqttClientMessageProperties properties,
                    size_t len, size_t index, size_t total);
 static void publishHeartbeat();
-static void mqttFuncHandler(const char *cmd);
+static void mqttFuncHandler(const char *topic, const char *data);
 static void mqttPostConnectTask(void*);
 static void handleMqttConnectImpl();
+static void onMqttPublish(uint16_t packetId);
 
 static void startHeartbeat() {
-    s_heartbeatEnabled.store(true);
-    s_nextHeartbeatAtMs.store(millis() + 60000UL);
+    timerCancel(s_heartbeatTimer);
+    s_heartbeatTimer = timerEvery("mqtt_heartbeat", MQTT_HEARTBEAT_INTERVAL_US, heartbeatTick, TimerDispatch::Worker);
 }
 
 static void stopHeartbeat() {
-    s_heartbeatEnabled.store(false);
+    timerCancel(s_heartbeatTimer);
 }
 
 static void storeHardcodedConfigValue(const char* desc, const char* key, std::string &value) {
@@ -78,6 +97,13 @@ static void storeHardcodedConfigValue(const char* desc, const char* key, std::st
 }
 
 void initMqtt() {
+    if (!s_deviceCacheMutex) {
+        s_deviceCacheMutex = xSemaphoreCreateMutex();
+        if (!s_deviceCacheMutex) {
+            Serial.println("Failed to create MQTT device cache mutex");
+            return;
+        }
+    }
     storeHardcodedConfigValue("MQTT server", NVS_KEY_MQTT_SERVER, mqtt_server);
     storeHardcodedConfigValue("MQTT user", NVS_KEY_MQTT_USER, mqtt_user);
     storeHardcodedConfigValue("MQTT password", NVS_KEY_MQTT_PASSWORD, mqtt_password);
@@ -87,6 +113,7 @@ void initMqtt() {
     if (!nvs_read_u16(NVS_KEY_MQTT_PORT, mqtt_port)) {
         nvs_write_u16(NVS_KEY_MQTT_PORT, mqtt_port);
     }
+    loadFrameSinks();
 
     mqttClient.setWill(AVAILABILITY_TOPIC, 0, true, "offline");
     mqttClient.setClientId(mqtt_client_id.c_str());
@@ -95,11 +122,12 @@ void initMqtt() {
     mqttClient.onConnect(onMqttConnect);
     mqttClient.onDisconnect(onMqttDisconnect);
     mqttClient.onMessage(onMqttMessage);
+    mqttClient.onPublish(onMqttPublish);
+    initMqttOutbox();
 
-    if (xTaskCreatePinnedToCore(mqttSchedulerTask, "mqttScheduler", 4096, nullptr,
-                                1, &s_mqttSchedulerTask, tskNO_AFFINITY) != pdPASS) {
-        Serial.println("Failed to create MQTT scheduler task");
-        s_mqttSchedulerTask = nullptr;
+    s_reconnectTimer = timerEvery("mqtt_reconnect", 1000000ULL, reconnectTick, TimerDispatch::Worker);
+    if (!timerActive(s_reconnectTimer)) {
+        Serial.println("Failed to start MQTT reconnect timer");
         return;
     }
 
@@ -169,54 +197,109 @@ static void publishVersionDiscovery() {
                        0, true, updatePayload.c_str(), updateLen);
 }
 
-static void publishButtonDiscovery(const std::string &id, const std::string &name,
-                                   const std::string &action, const std::string &key) {
+// ==== Per device topic and discovery cache ====
+// Topics and serialized discovery payloads are built once per remote and reused on every
+// reconnect and position update. They are rebuilt only when the name, key, travel time or
+// discovery prefix change.
+
+struct CachedMessage {
+    std::string topic;
+    std::string payload;
+};
+
+struct DeviceMqttCache {
+    uint32_t node{};
+    char id[7]{};
+    std::string stateTopic;
+    std::string positionTopic;
+    std::string travelTimeTopic;
+    std::string travelTimeValue;
+    uint32_t travelTime{UINT32_MAX};
+    std::string name;
+    uint8_t key[16]{};
+    std::string prefix;                  // discovery prefix the payloads were built for
+    std::vector<CachedMessage> discovery; // cover, pair/add/remove buttons, travel time number
+    size_t discoveryBytes{0};
+};
+
+// Payloads built for a device that did not fit in the cache budget, kept while it is being published
+struct DiscoveryScratch {
+    uint32_t node{UINT32_MAX};
+    std::vector<CachedMessage> messages;
+};
+
+static std::map<uint32_t, DeviceMqttCache> s_deviceCache;
+static size_t s_discoveryCacheBytes = 0;
+
+static uint32_t nodeKey(const uint8_t *node) {
+    return (static_cast<uint32_t>(node[0]) << 16) | (node[1] << 8) | node[2];
+}
+
+static DeviceMqttCache &cacheEntryLocked(const uint8_t *node) {
+    const uint32_t k = nodeKey(node);
+    auto [it, inserted] = s_deviceCache.try_emplace(k);
+    DeviceMqttCache &entry = it->second;
+    if (inserted) {
+        entry.node = k;
+        snprintf(entry.id, sizeof(entry.id), "%06x", static_cast<unsigned>(k));
+        const std::string base = std::string("iown/") + entry.id;
+        entry.stateTopic = base + "/state";
+        entry.positionTopic = base + "/position";
+        entry.travelTimeTopic = base + "/travel_time";
+    }
+    return entry;
+}
+
+static void dropDiscoveryLocked(DeviceMqttCache &entry) {
+    s_discoveryCacheBytes -= entry.discoveryBytes;
+    entry.discoveryBytes = 0;
+    entry.discovery.clear();
+    entry.discovery.shrink_to_fit();
+}
+
+static CachedMessage buildButtonDiscovery(const DeviceMqttCache &entry, const JsonDocument &device,
+                                          const char *action) {
+    const std::string id(entry.id);
     JsonDocument doc;
-    doc["name"] = name + " " + action;
+    doc["name"] = entry.name + " " + action;
     doc["unique_id"] = id + "_" + action;
     doc["command_topic"] = "iown/" + id + "/" + action;
-    doc["device"] = createDeviceObject(id, name, key);
-
-    std::string payload;
-    size_t len = serializeJson(doc, payload);
+    doc["device"] = device;
 
-    std::string topic = mqtt_discovery_topic + "/button/" + id + "_" + action + "/config";
-    mqttClient.publish(topic.c_str(), 0, true, payload.c_str(), len);
+    CachedMessage msg;
+    msg.topic = mqtt_discovery_topic + "/button/" + id + "_" + action + "/config";
+    serializeJson(doc, msg.payload);
+    return msg;
 }
 
-void publishTravelTimeDiscovery(const std::string &id, const std::string &name,
-                                const std::string &key, uint32_t travelTime) {
+static CachedMessage buildTravelTimeDiscovery(const DeviceMqttCache &entry, const JsonDocument &device) {
+    const std::string id(entry.id);
     JsonDocument doc;
-    doc["name"] = name + " travel time";
+    doc["name"] = entry.name + " travel time";
     doc["unique_id"] = id + "_travel_time";
-    doc["command_topic"] = "iown/" + id + "/travel_time/set";
-    doc["state_topic"] = "iown/" + id + "/travel_time";
+    doc["command_topic"] = entry.travelTimeTopic + "/set";
+    doc["state_topic"] = entry.travelTimeTopic;
     doc["unit_of_measurement"] = "s";
     doc["min"] = 0;
     doc["max"] = 60;
     doc["step"] = 1;
-    doc["device"] = createDeviceObject(id, name, key);
+    doc["device"] = device;
 
-    std::string payload;
-    size_t len = serializeJson(doc, payload);
-
-    std::string topic = mqtt_discovery_topic + "/number/" + id + "_travel_time/config";
-    mqttClient.publish(topic.c_str(), 0, true, payload.c_str(), len);
-
-    // publish current value
-    std::string stateTopic = "iown/" + id + "/travel_time";
-    std::string value = std::to_string(travelTime);
-    mqttClient.publish(stateTopic.c_str(), 0, true, value.c_str());
+    CachedMessage msg;
+    msg.topic = mqtt_discovery_topic + "/number/" + id + "_travel_time/config";
+    serializeJson(doc, msg.payload);
+    return msg;
 }
 
-void publishDiscovery(const std::string &id, const std::string &name, const std::string &key) {
+static CachedMessage buildCoverDiscovery(const DeviceMqttCache &entry, const JsonDocument &device) {
+    const std::string id(entry.id);
     JsonDocument doc;
-    doc["name"] = name;
+    doc["name"] = entry.name;
     doc["unique_id"] = id;
     doc["command_topic"] = "iown/" + id + "/set";
-    doc["state_topic"] = "iown/" + id + "/state";
-    doc["position_topic"] = "iown/" + id + "/position";
-    doc["set_position_topic"] = "iown/" + id + "/position/set";
+    doc["state_topic"] = entry.stateTopic;
+    doc["position_topic"] = entry.positionTopic;
+    doc["set_position_topic"] = entry.positionTopic + "/set";
     doc["availability_topic"] = AVAILABILITY_TOPIC;
     doc["payload_available"] = "online";
     doc["payload_not_available"] = "offline";
@@ -233,20 +316,97 @@ void publishDiscovery(const std::string &id, const std::string &name, const std:
     doc["optimistic"] = false;
     doc["retain"] = true;
     doc["qos"] = 0;
-    doc["device"] = createDeviceObject(id, name, key);
+    doc["device"] = device;
 
-    std::string payload;
-    size_t len = serializeJson(doc, payload);
+    CachedMessage msg;
+    msg.topic = mqtt_discovery_topic + "/cover/" + id + "/config";
+    serializeJson(doc, msg.payload);
+    return msg;
+}
 
-    std::string topic = mqtt_discovery_topic + "/cover/" + id + "/config";
-    mqttClient.publish(topic.c_str(), 0, true, payload.c_str(), len);
+// Make sure the discovery payloads of a device match its current name/key and prefix.
+// Returns the messages to publish; they stay cached as long as the cache budget allows.
+static const std::vector<CachedMessage> &refreshDiscoveryLocked(DeviceMqttCache &entry, const std::string &name,
+                                                               const uint8_t *key, DiscoveryScratch &scratch) {
+    const bool upToDate = entry.name == name && entry.prefix == mqtt_discovery_topic &&
+                          memcmp(entry.key, key, sizeof(entry.key)) == 0;
+    if (upToDate && !entry.discovery.empty()) {
+        return entry.discovery;
+    }
+    if (upToDate && scratch.node == entry.node && !scratch.messages.empty()) {
+        return scratch.messages;
+    }
 
-    publishButtonDiscovery(id, name, "pair", key);
-    publishButtonDiscovery(id, name, "add", key);
-    publishButtonDiscovery(id, name, "remove", key);
+    dropDiscoveryLocked(entry);
+    entry.name = name;
+    entry.prefix = mqtt_discovery_topic;
+    memcpy(entry.key, key, sizeof(entry.key));
+
+    const JsonDocument device = createDeviceObject(entry.id, name, bytesToHexString(key, sizeof(entry.key)));
+    scratch.node = entry.node;
+    scratch.messages.clear();
+    scratch.messages.push_back(buildCoverDiscovery(entry, device));
+    scratch.messages.push_back(buildButtonDiscovery(entry, device, "pair"));
+    scratch.messages.push_back(buildButtonDiscovery(entry, device, "add"));
+    scratch.messages.push_back(buildButtonDiscovery(entry, device, "remove"));
+    scratch.messages.push_back(buildTravelTimeDiscovery(entry, device));
+
+    size_t bytes = 0;
+    for (const auto &msg : scratch.messages) bytes += msg.topic.size() + msg.payload.size();
+    if (s_discoveryCacheBytes + bytes > MQTT_DISCOVERY_CACHE_BYTES) {
+        // Over budget: publish from the scratch copy, rebuild on the next reconnect
+        return scratch.messages;
+    }
+    entry.discovery = std::move(scratch.messages);
+    entry.discoveryBytes = bytes;
+    s_discoveryCacheBytes += bytes;
+    scratch.node = UINT32_MAX;
+    scratch.messages.clear();
+    return entry.discovery;
 }
 
-void removeDiscovery(const std::string &id) {
+static void refreshTravelTimeLocked(DeviceMqttCache &entry, uint32_t travelTime) {
+    if (entry.travelTime != travelTime) {
+        entry.travelTime = travelTime;
+        entry.travelTimeValue = std::to_string(travelTime);
+    }
+}
+
+void publishDiscovery(const IOHC::iohcRemote1W::remote &r) {
+    if (!s_deviceCacheMutex) return;
+    const std::string &name = r.name.empty() ? r.description : r.name;
+    DiscoveryScratch scratch;
+
+    xSemaphoreTake(s_deviceCacheMutex, portMAX_DELAY);
+    DeviceMqttCache &entry = cacheEntryLocked(r.node);
+    for (const auto &msg : refreshDiscoveryLocked(entry, name, r.key, scratch)) {
+        mqttClient.publish(msg.topic.c_str(), 0, true, msg.payload.c_str(), msg.payload.size());
+    }
+    refreshTravelTimeLocked(entry, r.travelTime);
+    mqttClient.publish(entry.travelTimeTopic.c_str(), 0, true, entry.travelTimeValue.c_str());
+    xSemaphoreGive(s_deviceCacheMutex);
+}
+
+void publishTravelTime(const IOHC::iohcRemote1W::remote &r) {
+    if (!s_deviceCacheMutex) return;
+    xSemaphoreTake(s_deviceCacheMutex, portMAX_DELAY);
+    DeviceMqttCache &entry = cacheEntryLocked(r.node);
+    refreshTravelTimeLocked(entry, r.travelTime);
+    mqttClient.publish(entry.travelTimeTopic.c_str(), 0, true, entry.travelTimeValue.c_str());
+    xSemaphoreGive(s_deviceCacheMutex);
+}
+
+void removeDiscovery(const uint8_t *node) {
+    if (!s_deviceCacheMutex) return;
+    xSemaphoreTake(s_deviceCacheMutex, portMAX_DELAY);
+    auto it = s_deviceCache.find(nodeKey(node));
+    if (it != s_deviceCache.end()) {
+        dropDiscoveryLocked(it->second);
+        s_deviceCache.erase(it);
+    }
+    xSemaphoreGive(s_deviceCacheMutex);
+
+    const std::string id = bytesToHexString(node, 3);
     std::string topic = mqtt_discovery_topic + "/cover/" + id + "/config";
     mqttClient.publish(topic.c_str(), 0, true, "", 0);
 
@@ -261,6 +421,7 @@ void removeDiscovery(const std::string &id) {
 
     std::string t = mqtt_discovery_topic + "/number/" + id + "_travel_time/config";
     mqttClient.publish(t.c_str(), 0, true, "", 0);
+    mqttClient.publish(("iown/" + id + "/travel_time").c_str(), 0, true, "", 0);
 }
 
 void publishHeartbeat() {
@@ -275,6 +436,15 @@ void publishWifiStrength() {
     mqttClient.publish(WIFI_STRENGTH_TOPIC, 0, true, std::to_string(wifiStatus.rssi).c_str());
 }
 
+void publishLinkQuality() {
+    JsonDocument doc;
+    JsonArray devices = doc.to<JsonArray>();
+    appendLinkQuality(devices);
+    std::string payload;
+    size_t len = serializeJson(doc, payload);
+    mqttClient.publish(LINK_QUALITY_TOPIC, 0, true, payload.c_str(), len);
+}
+
 void publishIpAddress() {
     mqttClient.publish(IP_ADDRESS_TOPIC, 0, true, WiFi.localIP().toString().c_str());
 }
@@ -308,16 +478,216 @@ void publishVersionInfo() {
                        info.updateAvailable ? "true" : "false");
 }
 
-void publishCoverState(const std::string &id, const char *state) {
-    std::string topic = "iown/" + id + "/state";
-    mqttClient.publish(topic.c_str(), 0, true, state);
+bool publishCoverState(const uint8_t *node, const char *state) {
+    if (!s_deviceCacheMutex) return false;
+    xSemaphoreTake(s_deviceCacheMutex, portMAX_DELAY);
+    const std::string topic = cacheEntryLocked(node).stateTopic;
+    xSemaphoreGive(s_deviceCacheMutex);
+    return outboxPublish(topic.c_str(), state, strlen(state), 0, true, OutboxPolicy::LastValue);
 }
 
-void publishCoverPosition(const std::string &id, float position) {
+bool publishCoverPosition(const uint8_t *node, float position) {
+    if (!s_deviceCacheMutex) return false;
     char buf[8];
-    snprintf(buf, sizeof(buf), "%.0f", position);
-    std::string topic = "iown/" + id + "/position";
-    mqttClient.publish(topic.c_str(), 0, true, buf);
+    const int len = snprintf(buf, sizeof(buf), "%.0f", position);
+    xSemaphoreTake(s_deviceCacheMutex, portMAX_DELAY);
+    const std::string topic = cacheEntryLocked(node).positionTopic;
+    xSemaphoreGive(s_deviceCacheMutex);
+    return outboxPublish(topic.c_str(), buf, len, 0, true, OutboxPolicy::LastValue);
+}
+
+// ==== Paced discovery publisher ====
+// Discovery is published with QoS 1 through a small window of unacknowledged messages, so the
+// client and TCP buffers never hold more than a few payloads. Acks (onPublish) reopen the window.
+// An ack timeout costs the message an attempt; a publish the client refuses (buffers full) costs
+// nothing and is retried after an exponential backoff.
+
+static constexpr uint8_t DISCOVERY_WINDOW = 4;
+static constexpr uint32_t DISCOVERY_ACK_TIMEOUT_MS = 5000;
+static constexpr uint8_t DISCOVERY_MAX_ATTEMPTS = 3;
+static constexpr uint32_t DISCOVERY_REFUSED_BACKOFF_MIN_MS = 50;
+static constexpr uint32_t DISCOVERY_REFUSED_BACKOFF_MAX_MS = 2000;
+static constexpr uint32_t DISCOVERY_MIN_FREE_HEAP = 20 * 1024;
+static constexpr uint8_t DISCOVERY_MSGS_PER_DEVICE = 6; // cover, 3 buttons, travel time number and its state
+static constexpr uint8_t DISCOVERY_ACK_SLOTS = 32;
+
+struct DiscoveryTarget {
+    uint8_t node[3];
+    uint8_t key[16];
+    std::string name;
+    uint32_t travelTime;
+};
+
+struct DiscoveryInFlight {
+    uint16_t packetId;
+    uint16_t item;
+    uint8_t attempts;
+    uint32_t sentAtMs;
+};
+
+static MqttDiscoveryProgress s_discoveryProgress{};
+static portMUX_TYPE s_ackMux = portMUX_INITIALIZER_UNLOCKED;
+static uint16_t s_ackedIds[DISCOVERY_ACK_SLOTS];
+static uint8_t s_ackedCount = 0;
+
+static void onMqttPublish(uint16_t packetId) {
+    portENTER_CRITICAL(&s_ackMux);
+    if (s_ackedCount < DISCOVERY_ACK_SLOTS) {
+        s_ackedIds[s_ackedCount++] = packetId; // a lost ack is recovered by the timeout
+    }
+    portEXIT_CRITICAL(&s_ackMux);
+    if (s_mqttPostConnectTask) {
+        xTaskNotifyGive(s_mqttPostConnectTask);
+    }
+}
+
+static uint16_t publishDiscoveryItem(const DiscoveryTarget &target, uint8_t msg, DiscoveryScratch &scratch) {
+    uint16_t packetId;
+    xSemaphoreTake(s_deviceCacheMutex, portMAX_DELAY);
+    DeviceMqttCache &entry = cacheEntryLocked(target.node);
+    if (msg < DISCOVERY_MSGS_PER_DEVICE - 1) {
+        const CachedMessage &m = refreshDiscoveryLocked(entry, target.name, target.key, scratch)[msg];
+        packetId = mqttClient.publish(m.topic.c_str(), 1, true, m.payload.c_str(), m.payload.size());
+    } else {
+        refreshTravelTimeLocked(entry, target.travelTime);
+        packetId = mqttClient.publish(entry.travelTimeTopic.c_str(), 1, true, entry.travelTimeValue.c_str());
+    }
+    xSemaphoreGive(s_deviceCacheMutex);
+    return packetId;
+}
+
+static void runDiscoveryPublisher() {
+    std::vector<DiscoveryTarget> targets;
+    for (const auto &r : IOHC::iohcRemote1W::getInstance()->getRemotes()) {
+        DiscoveryTarget t;
+        memcpy(t.node, r.node, sizeof(t.node));
+        memcpy(t.key, r.key, sizeof(t.key));
+        t.name = r.name.empty() ? r.description : r.name;
+        t.travelTime = r.travelTime;
+        targets.push_back(std::move(t));
+    }
+
+    const uint16_t total = targets.size() * DISCOVERY_MSGS_PER_DEVICE;
+    s_discoveryProgress = {};
+    s_discoveryProgress.total = total;
+    s_discoveryProgress.running = true;
+    const uint32_t startedMs = millis();
+    portENTER_CRITICAL(&s_ackMux);
+    s_ackedCount = 0;
+    portEXIT_CRITICAL(&s_ackMux);
+
+    std::vector<DiscoveryInFlight> inFlight;
+    std::deque<std::pair<uint16_t, uint8_t>> retries; // item, attempts so far
+    DiscoveryScratch scratch;
+    uint16_t next = 0;
+    uint16_t reported = 0;
+    uint32_t refusedBackoffMs = 0;
+    uint32_t refusedAtMs = 0;
+
+    while (next < total || !inFlight.empty() || !retries.empty()) {
+        if (!mqttClient.connected()) {
+            s_discoveryProgress.aborted = true;
+            break;
+        }
+
+        uint16_t acked[DISCOVERY_ACK_SLOTS];
+        uint8_t ackCount;
+        portENTER_CRITICAL(&s_ackMux);
+        ackCount = s_ackedCount;
+        memcpy(acked, s_ackedIds, ackCount * sizeof(uint16_t));
+        s_ackedCount = 0;
+        portEXIT_CRITICAL(&s_ackMux);
+        for (uint8_t i = 0; i < ackCount; ++i) {
+            auto it = std::find_if(inFlight.begin(), inFlight.end(),
+                                   [&](const DiscoveryInFlight &f) { return f.packetId == acked[i]; });
+            if (it != inFlight.end()) {
+                inFlight.erase(it);
+                s_discoveryProgress.acked++;
+            }
+        }
+
+        const uint32_t now = millis();
+        for (auto it = inFlight.begin(); it != inFlight.end();) {
+            if (now - it->sentAtMs >= DISCOVERY_ACK_TIMEOUT_MS) {
+                retries.emplace_back(it->item, it->attempts);
+                s_discoveryProgress.retries++;
+                it = inFlight.erase(it);
+            } else {
+                ++it;
+            }
+        }
+
+        // Acks wake this task early, so the backoff is a deadline rather than a sleep
+        const bool backingOff = refusedBackoffMs && now - refusedAtMs < refusedBackoffMs;
+        while (!backingOff && inFlight.size() < DISCOVERY_WINDOW) {
+            uint16_t item;
+            uint8_t attempts;
+            if (!retries.empty()) {
+                std::tie(item, attempts) = retries.front();
+                retries.pop_front();
+            } else if (next < total) {
+                item = next++;
+                attempts = 0;
+            } else {
+                break;
+            }
+            if (attempts >= DISCOVERY_MAX_ATTEMPTS) {
+                s_discoveryProgress.failed++;
+                continue;
+            }
+            if (esp_get_free_heap_size() < DISCOVERY_MIN_FREE_HEAP) {
+                retries.emplace_front(item, attempts); // wait for the TCP buffers to drain
+                break;
+            }
+            const uint16_t packetId = publishDiscoveryItem(targets[item / DISCOVERY_MSGS_PER_DEVICE],
+                                                           item % DISCOVERY_MSGS_PER_DEVICE, scratch);
+            if (packetId == 0) {
+                retries.emplace_front(item, attempts);
+                s_discoveryProgress.refused++;
+                refusedAtMs = now;
+                refusedBackoffMs = refusedBackoffMs ? std::min(refusedBackoffMs * 2, DISCOVERY_REFUSED_BACKOFF_MAX_MS)
+                                                    : DISCOVERY_REFUSED_BACKOFF_MIN_MS;
+                break;
+            }
+            refusedBackoffMs = 0;
+            inFlight.push_back({packetId, item, static_cast<uint8_t>(attempts + 1), now});
+        }
+
+        const uint16_t done = s_discoveryProgress.acked + s_discoveryProgress.failed;
+        if (total && done * 4 / total != reported * 4 / total) {
+            Serial.printf("MQTT discovery %u/%u\n", done, total);
+        }
+        reported = done;
+        s_discoveryProgress.elapsedMs = millis() - startedMs;
+
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(50));
+    }
+
+    s_discoveryProgress.elapsedMs = millis() - startedMs;
+    s_discoveryProgress.running = false;
+    addLogMessage(String("MQTT discovery ") + (s_discoveryProgress.aborted ? "aborted: " : "done: ") +
+                  String(s_discoveryProgress.acked) + "/" + String(total) + " acked, " +
+                  String(s_discoveryProgress.retries) + " retries, " + String(s_discoveryProgress.refused) +
+                  " refused, " + String(s_discoveryProgress.failed) +
+                  " failed in " + String(s_discoveryProgress.elapsedMs) + " ms");
+}
+
+MqttDiscoveryProgress getMqttDiscoveryProgress() {
+    return s_discoveryProgress;
+}
+
+void appendMqttDiagnostics(JsonObject &root) {
+    const MqttDiscoveryProgress progress = getMqttDiscoveryProgress();
+    JsonObject discovery = root["discovery_progress"].to<JsonObject>();
+    discovery["running"] = progress.running;
+    discovery["aborted"] = progress.aborted;
+    discovery["total"] = progress.total;
+    discovery["acked"] = progress.acked;
+    discovery["retries"] = progress.retries;
+    discovery["refused"] = progress.refused;
+    discovery["failed"] = progress.failed;
+    discovery["elapsed_ms"] = progress.elapsedMs;
+    appendMqttOutboxStats(root);
 }
 
 // ==== BELANGRIJK: scheduler die het zware werk in een eigen task zet ====
@@ -327,7 +697,7 @@ void handleMqttConnect() {
     xTaskCreatePinnedToCore(
         mqttPostConnectTask,
         "mqttPostConnect",
-        4096,      // stack
+        6144,      // stack
         nullptr,
         1,         // prioriteit laag
         &s_mqttPostConnectTask,
@@ -348,27 +718,14 @@ static void handleMqttConnectImpl() {
     // Discovery van de ‘frame’ sensor eerst, zodat state pub direct een entity heeft
     publishIohcFrameDiscovery();
     publishVersionDiscovery();
-    const auto &remotes = IOHC::iohcRemote1W::getInstance()->getRemotes();
-    for (const auto &r : remotes) {
-        std::string id = bytesToHexString(r.node, sizeof(r.node));
-        std::string key = bytesToHexString(r.key, sizeof(r.key));
-        std::string name = r.name.empty() ? r.description : r.name;
-        publishDiscovery(id, name, key);
-        publishTravelTimeDiscovery(id, name, key, r.travelTime);
-        //std::string t = "iown/" + id + "/set";
-        //mqttClient.subscribe(t.c_str(), 0);
-        //mqttClient.subscribe(("iown/" + id + "/pair").c_str(), 0);
-        //mqttClient.subscribe(("iown/" + id + "/add").c_str(), 0);
-        //mqttClient.subscribe(("iown/" + id + "/remove").c_str(), 0);
-        //mqttClient.subscribe(("iown/" + id + "/travel_time/set").c_str(), 0);
-        vTaskDelay(pdMS_TO_TICKS(200)); // throttle per device
-    }
+    runDiscoveryPublisher();
     startHeartbeat();
     publishHeartbeat();
     publishFreeMem();
     publishWifiStrength();
     publishIpAddress();
     publishVersionInfo();
+    resumeMqttOutbox();
 }
 
 void connectToMqtt() {
@@ -425,30 +782,24 @@ void onMqttDisconnect(AsyncMqttClientDisconnectReason reason) {
     Serial.println(static_cast<uint8_t>(reason));
     addLogMessage(String("Disconnected from MQTT (reason ") + String(static_cast<uint8_t>(reason)) + ")");
     mqttStatus = ConnState::Disconnected;
+    pauseMqttOutbox();
     updateDisplayStatus();
     stopHeartbeat();
 }
 
-static void mqttSchedulerTask(void*) {
-    while (true) {
-        vTaskDelay(pdMS_TO_TICKS(1000));
-
-        const uint32_t now = millis();
-
-        if (mqttStatus == ConnState::Disconnected && WiFi.status() == WL_CONNECTED &&
-            static_cast<int32_t>(now - s_lastMqttConnectAttemptMs) >= static_cast<int32_t>(MQTT_RECONNECT_INTERVAL_MS)) {
-            connectToMqtt();
-        }
+static void reconnectTick() {
+    if (mqttStatus == ConnState::Disconnected && WiFi.status() == WL_CONNECTED &&
+        static_cast<int32_t>(millis() - s_lastMqttConnectAttemptMs) >= static_cast<int32_t>(MQTT_RECONNECT_INTERVAL_MS)) {
+        connectToMqtt();
+    }
+}
 
-        if (s_heartbeatEnabled.load() &&
-            static_cast<int32_t>(now - s_nextHeartbeatAtMs.load()) >= 0) {
-            s_nextHeartbeatAtMs.store(now + 60000UL);
-            if (mqttStatus == ConnState::Connected && mqttClient.connected()) {
-                publishHeartbeat();
-                publishFreeMem();
-                publishWifiStrength();
-            }
-        }
+static void heartbeatTick() {
+    if (mqttStatus == ConnState::Connected && mqttClient.connected()) {
+        publishHeartbeat();
+        publishFreeMem();
+        publishWifiStrength();
+        publishLinkQuality();
     }
 }
 
@@ -516,211 +867,190 @@ static void publishWifiStrengthDiscovery() {
                        0, true, cfg.c_str(), cfgLen);
 }
 
-void mqttFuncHandler(const char *cmd) {
-    constexpr char delim = ' ';
-    Tokens segments;
-    tokenize(cmd + 5, delim, segments);
-    Serial.printf("Search for %s\t", segments[0].c_str());
-    for (uint8_t idx = 0; idx <= lastEntry; ++idx) {
-        if (_cmdHandler[idx] == nullptr) continue;
-        if (segments[0].find(_cmdHandler[idx]->cmd) != std::string::npos) {
-            Serial.printf(" %s %s (%s)\n", _cmdHandler[idx]->cmd,
-                          segments.size() > 1 ? segments[1].c_str() : "No param",
-                          _cmdHandler[idx]->description);
-            _cmdHandler[idx]->handler(&segments);
-            return;
-        }
-    }
-    Serial.printf("*> MQTT Unknown %s <*\n", segments[0].c_str());
+void mqttFuncHandler(const char *topic, const char *data) {
+    // iown/<command>: the command is the last topic level
+    const char *slash = strrchr(topic, '/');
+    const char *name = slash ? slash + 1 : topic;
+    Serial.printf("Search for %s\t", name);
+    TokenView args(data ? data : "");
+    args.insert(0, name);
+    const std::string_view params = args.size() > 1 ? args.rest(1) : "No param";
+    Serial.printf("%.*s\n", static_cast<int>(params.size()), params.data());
+    if (Cmd::dispatch(args) == Cmd::Result::Unknown) Serial.printf("*> MQTT Unknown %s <*\n", topic);
+}
+
+// iown/<id><suffix>: extract the device id of a per-device topic
+static bool deviceTopic(std::string_view topic, std::string_view suffix, std::string_view &id) {
+    if (topic.substr(0, 5) != "iown/") return false;
+    const size_t pos = topic.find(suffix, 5);
+    if (pos == std::string_view::npos) return false;
+    id = topic.substr(5, pos - 5);
+    return true;
+}
+
+static const IOHC::iohcRemote1W::remote *findRemote(std::string_view id) {
+    uint8_t node[3];
+    if (id.size() != 6 || !TokenView(id).hexAddress(0, node)) return nullptr;
+    const auto &remotes = IOHC::iohcRemote1W::getInstance()->getRemotes();
+    auto it = std::find_if(remotes.begin(), remotes.end(), [&](const auto &r) {
+        return memcmp(r.node, node, sizeof(node)) == 0;
+    });
+    return it != remotes.end() ? &*it : nullptr;
+}
+
+// atoi() for a payload that is not NUL terminated
+static long payloadToLong(std::string_view body) {
+    while (!body.empty() && isspace(static_cast<unsigned char>(body.front()))) body.remove_prefix(1);
+    if (!body.empty() && body.front() == '+') body.remove_prefix(1);
+    long value = 0;
+    std::from_chars(body.data(), body.data() + body.size(), value);
+    return value;
+}
+
+static void clearRetained(const char *topic) {
+    mqttClient.publish(topic, 0, true, "", 0);
 }
 
 void onMqttMessage(char *topic, char *payload, AsyncMqttClientMessageProperties properties,
                    size_t len, size_t index, size_t total) {
     if (!topic || !payload || len == 0) return;
 
-    // Safe copy of payload
-    char buf[len + 1];
-    memcpy(buf, payload, len);
-    buf[len] = '\0';
-
-    Serial.printf("Received MQTT %s %s %d\n", topic, buf, len);
-
-    std::string topicStr(topic);
-    std::string payloadStr(buf);
-
-    if (topicStr.rfind("iown/", 0) == 0 && topicStr.find("/travel_time/set", 5) != std::string::npos) {
-        std::string id = topicStr.substr(5, topicStr.find("/travel_time/set", 5) - 5);
-        std::transform(id.begin(), id.end(), id.begin(), ::tolower);
-        const auto &remotes = IOHC::iohcRemote1W::getInstance()->getRemotes();
-        auto it = std::find_if(remotes.begin(), remotes.end(), [&](const auto &r) {
-            return bytesToHexString(r.node, sizeof(r.node)) == id;
-        });
-        if (it != remotes.end()) {
-            uint32_t tt = strtoul(payloadStr.c_str(), nullptr, 10);
+    // The payload is not NUL terminated; work on views instead of copies
+    const std::string_view topicView(topic);
+    const std::string_view body(payload, len);
+    std::string_view id;
+
+    Serial.printf("Received MQTT %s %.*s %d\n", topic, static_cast<int>(len), payload, len);
+
+    // Group command: {"group": "all|remote name|dev1,dev2", "action": "close", "position": 40}
+    if (topicView == GROUP_SET_TOPIC) {
+        JsonDocument doc;
+        if (deserializeJson(doc, payload, len) != DeserializationError::Ok) {
+            Serial.println(F("Failed to parse group JSON"));
+            return;
+        }
+        std::string action = doc["action"] | "";
+        std::transform(action.begin(), action.end(), action.begin(), ::tolower);
+        IOHC::RemoteButton btn;
+        if (!IOHC::groupActionFromString(action, btn)) {
+            Serial.printf("*> MQTT Unknown group action %s <*\n", action.c_str());
+            return;
+        }
+        const auto percent = static_cast<uint8_t>(std::clamp(doc["position"] | 0, 0, 100));
+        auto *remote1W = IOHC::iohcRemote1W::getInstance();
+        auto result = remote1W->groupCmd(btn, remote1W->resolveGroup(doc["group"] | "all"), percent);
+
+        JsonDocument report;
+        report["devices"] = result.devices;
+        report["estimated_spread_ms"] = result.estimatedSpreadMs;
+        JsonArray missing = report["missing"].to<JsonArray>();
+        for (const auto &m : result.missing) missing.add(m);
+        std::string out;
+        serializeJson(report, out);
+        mqttClient.publish(GROUP_RESULT_TOPIC, 0, false, out.c_str());
+        clearRetained(topic);
+        return;
+    }
+
+    if (deviceTopic(topicView, "/travel_time/set", id)) {
+        if (const auto *remote = findRemote(id)) {
+            const long tt = payloadToLong(body);
             if (tt > 0) {
-                IOHC::iohcRemote1W::getInstance()->setTravelTime(it->description, tt);
-                std::string stateTopic = "iown/" + id + "/travel_time";
-                std::string val = std::to_string(tt);
-                mqttClient.publish(stateTopic.c_str(), 0, true, val.c_str());
+                // Publishes the new retained travel time state as well
+                IOHC::iohcRemote1W::getInstance()->setTravelTime(remote->description, tt);
             }
-            mqttClient.publish(topicStr.c_str(), 0, true, "", 0);
+            clearRetained(topic);
         }
         return;
     }
 
-    if (topicStr.rfind("iown/", 0) == 0 && topicStr.find("/position/set", 5) != std::string::npos) {
-        std::string id = topicStr.substr(5, topicStr.find("/position/set", 5) - 5);
-        std::transform(id.begin(), id.end(), id.begin(), ::tolower);
-        const auto &remotes = IOHC::iohcRemote1W::getInstance()->getRemotes();
-        auto it = std::find_if(remotes.begin(), remotes.end(), [&](const auto &r) {
-            return bytesToHexString(r.node, sizeof(r.node)) == id;
-        });
-        if (it != remotes.end()) {
-            int openVal = atoi(payloadStr.c_str());
-            openVal = std::clamp(openVal, 0, 100);
+    if (deviceTopic(topicView, "/position/set", id)) {
+        if (const auto *remote = findRemote(id)) {
+            int openVal = std::clamp<long>(payloadToLong(body), 0, 100);
             int closeVal = 100 - openVal;
-            Tokens t;
-            t.push_back(std::to_string(closeVal));
-            t.push_back(it->description);
+            const std::string closeStr = std::to_string(closeVal);
+            TokenView t;
+            t.append(closeStr);
+            t.append(remote->description);
+            // cmd() posts the movement and tracked position to the cover state bus
             IOHC::iohcRemote1W::getInstance()->cmd(IOHC::RemoteButton::Absolute, &t);
-            std::string stateTopic = "iown/" + id + "/state";
-            const char *state = (openVal >= 99) ? "OPEN" : (openVal <= 1 ? "CLOSE" : "STOP");
-            mqttClient.publish(stateTopic.c_str(), 0, true, state);
-            std::string posTopic = "iown/" + id + "/position";
-            std::string openStr = std::to_string(openVal);
-            mqttClient.publish(posTopic.c_str(), 0, true, openStr.c_str());
-            mqttClient.publish(topicStr.c_str(), 0, true, "", 0);
+            clearRetained(topic);
         }
         return;
     }
 
-    if (topicStr.rfind("iown/", 0) == 0 && topicStr.find("/absolute/set", 5) != std::string::npos) {
-        std::string id = topicStr.substr(5, topicStr.find("/absolute/set", 5) - 5);
-        std::transform(id.begin(), id.end(), id.begin(), ::tolower);
-        const auto &remotes = IOHC::iohcRemote1W::getInstance()->getRemotes();
-        auto it = std::find_if(remotes.begin(), remotes.end(), [&](const auto &r) {
-            return bytesToHexString(r.node, sizeof(r.node)) == id;
-        });
-        if (it != remotes.end()) {
-            Tokens t;
-            t.push_back(payloadStr);
-            t.push_back(it->description);
+    if (deviceTopic(topicView, "/absolute/set", id)) {
+        if (const auto *remote = findRemote(id)) {
+            const long closeVal = std::clamp<long>(payloadToLong(body), 0, 100);
+            const std::string closeStr = std::to_string(closeVal);
+            TokenView t;
+            t.append(closeStr);
+            t.append(remote->description);
             IOHC::iohcRemote1W::getInstance()->cmd(IOHC::RemoteButton::Absolute, &t);
-            std::string stateTopic = "iown/" + id + "/state";
-            int val = atoi(payloadStr.c_str());
-            int openVal = 100 - std::clamp(val, 0, 100);
-            const char *state = (openVal >= 99) ? "OPEN" : (openVal <= 1 ? "CLOSE" : "STOP");
-            mqttClient.publish(stateTopic.c_str(), 0, true, state);
-            std::string posTopic = "iown/" + id + "/position";
-            std::string openStr = std::to_string(openVal);
-            mqttClient.publish(posTopic.c_str(), 0, true, openStr.c_str());
-            mqttClient.publish(topicStr.c_str(), 0, true, "", 0);
+            clearRetained(topic);
         }
         return;
     }
 
-    if (topicStr.rfind("iown/", 0) == 0 && topicStr.find("/set", 5) != std::string::npos) {
-        std::string id = topicStr.substr(5, topicStr.find("/set", 5) - 5);
-        std::transform(id.begin(), id.end(), id.begin(), ::tolower);
-        const auto &remotes = IOHC::iohcRemote1W::getInstance()->getRemotes();
-        auto it = std::find_if(remotes.begin(), remotes.end(), [&](const auto &r) {
-            return bytesToHexString(r.node, sizeof(r.node)) == id;
-        });
-        if (it != remotes.end()) {
-            Tokens t;
-            std::transform(payloadStr.begin(), payloadStr.end(), payloadStr.begin(), ::tolower);
-            t.push_back(payloadStr);
-            t.push_back(it->description);
-            std::string stateTopic = "iown/" + id + "/state";
-
-            if (payloadStr == "open") {
+    if (deviceTopic(topicView, "/set", id)) {
+        if (const auto *remote = findRemote(id)) {
+            char action[16] = "";
+            if (len < sizeof(action)) {
+                std::transform(body.begin(), body.end(), action, ::tolower);
+                action[len] = '\0';
+            }
+            TokenView t;
+            t.append(action);
+            t.append(remote->description);
+
+            if (strcmp(action, "open") == 0) {
                 IOHC::iohcRemote1W::getInstance()->cmd(IOHC::RemoteButton::Open, &t);
-                mqttClient.publish(stateTopic.c_str(), 0, true, "OPEN");
-            } else if (payloadStr == "close") {
+            } else if (strcmp(action, "close") == 0) {
                 IOHC::iohcRemote1W::getInstance()->cmd(IOHC::RemoteButton::Close, &t);
-                mqttClient.publish(stateTopic.c_str(), 0, true, "CLOSE");
-            } else if (payloadStr == "stop") {
+            } else if (strcmp(action, "stop") == 0) {
                 IOHC::iohcRemote1W::getInstance()->cmd(IOHC::RemoteButton::Stop, &t);
-                mqttClient.publish(stateTopic.c_str(), 0, true, "STOP");
-            } else if (payloadStr == "vent") {
+            } else if (strcmp(action, "vent") == 0) {
                 IOHC::iohcRemote1W::getInstance()->cmd(IOHC::RemoteButton::Vent, &t);
-            } else if (payloadStr == "force") {
+            } else if (strcmp(action, "force") == 0) {
                 IOHC::iohcRemote1W::getInstance()->cmd(IOHC::RemoteButton::ForceOpen, &t);
             } else {
-                Serial.printf("*> MQTT Unknown %s <*\n", payloadStr.c_str());
+                Serial.printf("*> MQTT Unknown %.*s <*\n", static_cast<int>(len), payload);
             }
             // Clear retained set message
-            mqttClient.publish(topicStr.c_str(), 0, true, "", 0);
+            clearRetained(topic);
         } else {
-            Serial.printf("*> MQTT Unknown device %s <*\n", id.c_str());
+            Serial.printf("*> MQTT Unknown device %.*s <*\n", static_cast<int>(id.size()), id.data());
         }
         return;
     }
 
-    if (topicStr.rfind("iown/", 0) == 0 && topicStr.find("/pair", 5) != std::string::npos) {
-        std::string id = topicStr.substr(5, topicStr.find("/pair", 5) - 5);
-        std::transform(id.begin(), id.end(), id.begin(), ::tolower);
-        const auto &remotes = IOHC::iohcRemote1W::getInstance()->getRemotes();
-        auto it = std::find_if(remotes.begin(), remotes.end(), [&](const auto &r) {
-            return bytesToHexString(r.node, sizeof(r.node)) == id;
-        });
-        if (it != remotes.end()) {
-            Tokens t;
-            t.push_back("pair");
-            t.push_back(it->description);
-            IOHC::iohcRemote1W::getInstance()->cmd(IOHC::RemoteButton::Pair, &t);
-            mqttClient.publish(topicStr.c_str(), 0, true, "", 0);
-        }
-        return;
-    }
-
-    if (topicStr.rfind("iown/", 0) == 0 && topicStr.find("/add", 5) != std::string::npos) {
-        std::string id = topicStr.substr(5, topicStr.find("/add", 5) - 5);
-        std::transform(id.begin(), id.end(), id.begin(), ::tolower);
-        const auto &remotes = IOHC::iohcRemote1W::getInstance()->getRemotes();
-        auto it = std::find_if(remotes.begin(), remotes.end(), [&](const auto &r) {
-            return bytesToHexString(r.node, sizeof(r.node)) == id;
-        });
-        if (it != remotes.end()) {
-            Tokens t;
-            t.push_back("add");
-            t.push_back(it->description);
-            IOHC::iohcRemote1W::getInstance()->cmd(IOHC::RemoteButton::Add, &t);
-            mqttClient.publish(topicStr.c_str(), 0, true, "", 0);
-        }
-        return;
-    }
-
-    if (topicStr.rfind("iown/", 0) == 0 && topicStr.find("/remove", 5) != std::string::npos) {
-        std::string id = topicStr.substr(5, topicStr.find("/remove", 5) - 5);
-        std::transform(id.begin(), id.end(), id.begin(), ::tolower);
-        const auto &remotes = IOHC::iohcRemote1W::getInstance()->getRemotes();
-        auto it = std::find_if(remotes.begin(), remotes.end(), [&](const auto &r) {
-            return bytesToHexString(r.node, sizeof(r.node)) == id;
-        });
-        if (it != remotes.end()) {
-            Tokens t;
-            t.push_back("remove");
-            t.push_back(it->description);
-            IOHC::iohcRemote1W::getInstance()->cmd(IOHC::RemoteButton::Remove, &t);
-            mqttClient.publish(topicStr.c_str(), 0, true, "", 0);
+    struct {
+        const char *suffix;
+        const char *name;
+        IOHC::RemoteButton button;
+    } static constexpr LINK_ACTIONS[] = {
+        {"/pair", "pair", IOHC::RemoteButton::Pair},
+        {"/add", "add", IOHC::RemoteButton::Add},
+        {"/remove", "remove", IOHC::RemoteButton::Remove},
+    };
+    for (const auto &action : LINK_ACTIONS) {
+        if (!deviceTopic(topicView, action.suffix, id)) continue;
+        if (const auto *remote = findRemote(id)) {
+            TokenView t;
+            t.append(action.name);
+            t.append(remote->description);
+            IOHC::iohcRemote1W::getInstance()->cmd(action.button, &t);
+            clearRetained(topic);
         }
         return;
     }
 
     JsonDocument doc;
-    if (deserializeJson(doc, buf) != DeserializationError::Ok) {
+    if (deserializeJson(doc, payload, len) != DeserializationError::Ok) {
         Serial.println(F("Failed to parse JSON"));
         return;
     }
 
-    const char *data = doc["_data"];
-    size_t bufferSize = strlen(topic) + (data ? strlen(data) : 0) + 7;
-    char message[bufferSize];
-    if (!data)
-        snprintf(message, sizeof(message), "MQTT %s", topic);
-    else
-        snprintf(message, sizeof(message), "MQTT %s %s", topic, data);
-    mqttFuncHandler(message);
+    mqttFuncHandler(topic, doc["_data"].as<const char *>());
 }
 #endif // MQTT
@@ -0,0 +1,241 @@
+#include <mqtt_outbox.h>
+
+#if defined(MQTT)
+
+#include <Arduino.h>
+
+#include <mqtt_handler.h>
+
+#include <algorithm>
+#include <cstring>
+
+extern "C" {
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+}
+
+namespace {
+
+constexpr uint32_t RETRY_BACKOFF_MS = 200;
+constexpr uint32_t IDLE_POLL_MS = 1000;
+
+static_assert(MQTT_OUTBOX_STATES <= 256, "state slots are indexed by uint8_t");
+
+// Fixed size, so queuing during an outage never touches the heap
+struct Entry {
+  char topic[MQTT_OUTBOX_MAX_TOPIC];
+  char payload[MQTT_OUTBOX_MAX_PAYLOAD];
+  uint16_t len;
+  uint8_t qos;
+  bool retain;
+};
+
+SemaphoreHandle_t s_mutex = nullptr;
+TaskHandle_t s_task = nullptr;
+bool s_online = false;
+
+// Last-value table. s_stateOrder lists the slots in first-queued order, the
+// first s_stateCount are in use; only the indices move, never the entries.
+Entry s_states[MQTT_OUTBOX_STATES];
+uint8_t s_stateOrder[MQTT_OUTBOX_STATES];
+uint16_t s_stateCount = 0;
+
+// FIFO ring for events.
+Entry s_events[MQTT_OUTBOX_EVENTS];
+uint16_t s_eventHead = 0;
+uint16_t s_eventCount = 0;
+
+MqttOutboxStats s_stats{};
+
+void lock() { xSemaphoreTake(s_mutex, portMAX_DELAY); }
+void unlock() { xSemaphoreGive(s_mutex); }
+
+// Callers checked the topic and payload sizes
+void assign(Entry &e, const char *topic, const char *payload, size_t len, uint8_t qos, bool retain) {
+  strcpy(e.topic, topic);
+  memcpy(e.payload, payload, len);
+  e.len = static_cast<uint16_t>(len);
+  e.qos = qos;
+  e.retain = retain;
+}
+
+// The oldest used slot moves behind the others, where it becomes the first free one
+void rotateStatesLocked() {
+  std::rotate(s_stateOrder, s_stateOrder + 1, s_stateOrder + s_stateCount);
+}
+
+void trackDepthLocked() {
+  s_stats.states = s_stateCount;
+  s_stats.events = s_eventCount;
+  s_stats.maxDepth = std::max<uint16_t>(s_stats.maxDepth, s_stateCount + s_eventCount);
+}
+
+void enqueueLocked(const char *topic, const char *payload, size_t len, uint8_t qos, bool retain,
+                   OutboxPolicy policy) {
+  s_stats.queued++;
+  if (policy == OutboxPolicy::LastValue) {
+    for (uint16_t i = 0; i < s_stateCount; ++i) {
+      Entry &e = s_states[s_stateOrder[i]];
+      if (strcmp(e.topic, topic) == 0) {
+        assign(e, topic, payload, len, qos, retain);
+        s_stats.compacted++;
+        return;
+      }
+    }
+    if (s_stateCount == MQTT_OUTBOX_STATES) {
+      // Table full: give up the oldest state to keep the newest one
+      rotateStatesLocked();
+      s_stateCount--;
+      s_stats.dropped++;
+    }
+    assign(s_states[s_stateOrder[s_stateCount++]], topic, payload, len, qos, retain);
+  } else {
+    if (s_eventCount == MQTT_OUTBOX_EVENTS) {
+      s_eventHead = (s_eventHead + 1) % MQTT_OUTBOX_EVENTS;
+      s_eventCount--;
+      s_stats.dropped++;
+    }
+    const uint16_t tail = (s_eventHead + s_eventCount) % MQTT_OUTBOX_EVENTS;
+    assign(s_events[tail], topic, payload, len, qos, retain);
+    s_eventCount++;
+  }
+  trackDepthLocked();
+}
+
+// Publish the oldest queued message. Returns false when nothing was sent,
+// either because the outbox is empty or because the client refused it.
+bool drainOneLocked(bool &empty) {
+  empty = false;
+  if (s_eventCount) {
+    const Entry &e = s_events[s_eventHead];
+    if (!mqttClient.publish(e.topic, e.qos, e.retain, e.payload, e.len)) {
+      return false;
+    }
+    s_eventHead = (s_eventHead + 1) % MQTT_OUTBOX_EVENTS;
+    s_eventCount--;
+  } else if (s_stateCount) {
+    const Entry &e = s_states[s_stateOrder[0]];
+    if (!mqttClient.publish(e.topic, e.qos, e.retain, e.payload, e.len)) {
+      return false;
+    }
+    rotateStatesLocked();
+    s_stateCount--;
+  } else {
+    empty = true;
+    return false;
+  }
+  s_stats.replayed++;
+  trackDepthLocked();
+  return true;
+}
+
+void outboxTask(void *) {
+  const TickType_t pace = pdMS_TO_TICKS(std::max<uint32_t>(1, 1000 / MQTT_OUTBOX_DRAIN_RATE));
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(IDLE_POLL_MS));
+    for (;;) {
+      bool empty = true;
+      bool sent = false;
+      lock();
+      if (s_online && mqttClient.connected()) {
+        sent = drainOneLocked(empty);
+      }
+      unlock();
+      if (empty) {
+        break;
+      }
+      vTaskDelay(sent ? pace : pdMS_TO_TICKS(RETRY_BACKOFF_MS));
+      if (!s_online) {
+        break;
+      }
+    }
+  }
+}
+
+} // namespace
+
+void initMqttOutbox() {
+  if (s_task) {
+    return;
+  }
+
+  s_mutex = xSemaphoreCreateMutex();
+  if (!s_mutex) {
+    Serial.println("Failed to create MQTT outbox mutex");
+    return;
+  }
+  for (uint8_t i = 0; i < MQTT_OUTBOX_STATES; ++i) {
+    s_stateOrder[i] = i;
+  }
+
+  if (xTaskCreatePinnedToCore(outboxTask, "mqttOutbox", 3072, nullptr, 1, &s_task, tskNO_AFFINITY) != pdPASS) {
+    Serial.println("Failed to create MQTT outbox task");
+    vSemaphoreDelete(s_mutex);
+    s_mutex = nullptr;
+    s_task = nullptr;
+  }
+}
+
+bool outboxPublish(const char *topic, const char *payload, size_t len, uint8_t qos, bool retain,
+                   OutboxPolicy policy) {
+  if (!s_mutex) {
+    return mqttClient.publish(topic, qos, retain, payload, len) != 0;
+  }
+
+  lock();
+  // Publishing directly while older messages wait would reorder them
+  if (s_online && !s_stateCount && !s_eventCount && mqttClient.connected() &&
+      mqttClient.publish(topic, qos, retain, payload, len)) {
+    unlock();
+    return true;
+  }
+  if (len > MQTT_OUTBOX_MAX_PAYLOAD || strlen(topic) >= MQTT_OUTBOX_MAX_TOPIC) {
+    s_stats.dropped++;
+    unlock();
+    return false;
+  }
+  enqueueLocked(topic, payload, len, qos, retain, policy);
+  unlock();
+  if (s_online) {
+    xTaskNotifyGive(s_task); // client refused it, retry from the outbox task
+  }
+  return true;
+}
+
+void resumeMqttOutbox() {
+  s_online = true;
+  if (s_task) {
+    xTaskNotifyGive(s_task);
+  }
+}
+
+void pauseMqttOutbox() {
+  s_online = false;
+}
+
+MqttOutboxStats getMqttOutboxStats() {
+  if (!s_mutex) {
+    return {};
+  }
+  lock();
+  MqttOutboxStats stats = s_stats;
+  stats.online = s_online;
+  unlock();
+  return stats;
+}
+
+void appendMqttOutboxStats(JsonObject &root) {
+  const MqttOutboxStats stats = getMqttOutboxStats();
+  JsonObject outbox = root["outbox"].to<JsonObject>();
+  outbox["online"] = stats.online;
+  outbox["states"] = stats.states;
+  outbox["events"] = stats.events;
+  outbox["max_depth"] = stats.maxDepth;
+  outbox["queued"] = stats.queued;
+  outbox["compacted"] = stats.compacted;
+  outbox["replayed"] = stats.replayed;
+  outbox["dropped"] = stats.dropped;
+}
+
+#endif // MQTT
@@ -24,8 +24,12 @@
 #include <WiFi.h>
 #include <display_helpers.h>
 #include <nvs_helpers.h>
+#include <timer_service.h>
+#include <algorithm>
 #include <atomic>
 #include <chrono>
+#include <cstring>
+#include <initializer_list>
 #include <freertos/semphr.h>
 
 
@@ -33,11 +37,13 @@ Adafruit_SSD1306 display(SCREEN_WIDTH, SCREEN_HEIGHT, &Wire, OLED_RST);
 DisplayBuffer displayBuffer;
 SemaphoreHandle_t displayBufferMutex = xSemaphoreCreateMutex();
 
-TimerHandle_t displayUpdateTimer;
+TimerToken displayUpdateTimer;
 std::chrono::time_point<std::chrono::system_clock> startTime;
 std::atomic<int64_t> lastDataTime = 0;
 std::atomic<bool> displayEnabled = true;
+TaskHandle_t displayTaskHandle = nullptr;
 void displayTask(void *);
+void handleTimerTick();
 
 const int MILLIS_BETWEEN_DISPLAY_UPDATE_SLOW = 30000;
 const int MILLIS_BETWEEN_DISPLAY_UPDATE_FAST = 100;
@@ -136,6 +142,7 @@ int mqttStatusToIconIndex() {
 const bool fast = true;
 const bool slow = false;
 std::atomic<bool> timerIsFast = false;
+portMUX_TYPE timerSpeedMux = portMUX_INITIALIZER_UNLOCKED;  // keeps the flag and the timer period in step
 
 static void notifyDisplayTask() {
     if (displayTaskHandle != nullptr) {
@@ -144,13 +151,15 @@ static void notifyDisplayTask() {
 }
 
 void setTimerSpeed(bool needsFast) {
-    if (!displayUpdateTimer) {
-        return;
-    }
-    if (needsFast != timerIsFast) {
-        timerIsFast = needsFast;
-        notifyDisplayTask();
-    }
+    // Rescheduled in place: the token never changes, so concurrent callers can't orphan a timer
+    portENTER_CRITICAL(&timerSpeedMux);
+    const bool changed = needsFast != timerIsFast &&
+                         timerReschedule(displayUpdateTimer,
+                                         (needsFast ? MILLIS_BETWEEN_DISPLAY_UPDATE_FAST
+                                                    : MILLIS_BETWEEN_DISPLAY_UPDATE_SLOW) * 1000ULL);
+    if (changed) timerIsFast = needsFast;
+    portEXIT_CRITICAL(&timerSpeedMux);
+    if (changed) notifyDisplayTask();
 }
 
 bool initDisplay() {
@@ -165,24 +174,22 @@ bool initDisplay() {
     }
 
     startTime = std::chrono::system_clock::now();
-    timeSinceNoData = startTime;
     lastDisplayActivityMs = millis();
-    displayUpdateTimer = xTimerCreate(
-        "displayTimer",
-        pdMS_TO_TICKS(MILLIS_BETWEEN_DISPLAY_UPDATE_FAST),
-        pdTRUE,
-        nullptr,
-        handleTimerTick
-    );
-    if (displayUpdateTimer) {
-        xTimerStart(displayUpdateTimer, 0);
+    lastDataTime = esp_timer_get_time();
+
+    if (xTaskCreatePinnedToCore(displayTask, "displayTask", 4096, nullptr, 1, &displayTaskHandle, 1) != pdPASS) {
+        Serial.println("Failed to create display task");
+        displayTaskHandle = nullptr;
+        return false;
+    }
+
+    displayUpdateTimer = timerEvery("display", MILLIS_BETWEEN_DISPLAY_UPDATE_FAST * 1000ULL, handleTimerTick);
+    if (timerActive(displayUpdateTimer)) {
+        timerIsFast = fast;
     } else {
         Serial.println("Failed to create display update timer");
     }
-
-    startTime = std::chrono::system_clock::now();
-    lastDataTime = esp_timer_get_time();
-    xTaskNotifyGive(displayTaskHandle);
+    notifyDisplayTask();
 
     return true;
 }
@@ -289,7 +296,6 @@ void enterIdleScreen() {
     displayBuffer.clear();
     xSemaphoreGive(displayBufferMutex);
 
-    drawIdleScreen();
     setTimerSpeed(slow);
 }
 
@@ -319,56 +325,151 @@ void drawFooter() {
     }
 }
 
-bool drawContents() {
-    const int width = SCREEN_WIDTH / 6; // char width is 5 + 1 pixel space
-    const int height = (SCREEN_HEIGHT - 20 - 8) / 8; // char height is 7 + 1 pixel space and 20 pixels (12 pixels + an empty line) for the header + 8 for the footer
+namespace {
+    /* What the panel shows right now, as last sent over I2C. A new frame is
+     * compared against it page by page and only the changed column range of
+     * each changed page is transferred; an unchanged frame is not drawn at all. */
+    constexpr size_t FRAME_BYTES = SCREEN_WIDTH * SCREEN_HEIGHT / 8;
+    constexpr uint8_t PAGES = SCREEN_HEIGHT / 8;
+    // Data bytes per I2C transaction, one byte of the Wire buffer goes to the control byte
+    constexpr size_t I2C_CHUNK = 31;
+
+    uint8_t sentFrame[FRAME_BYTES];
+    bool sentValid = false;
+
+    struct ScreenState {
+        bool idle;
+        int8_t mqttIcon;
+        int8_t wifiIcon;
+        int8_t footer;     // -1 none, 0 url, 1 ip
+        uint32_t ip;
+    };
+    ScreenState drawnState{};
+    bool drawnValid = false;
+    std::vector<std::string> shownLines;
+
+    void sendCommands(std::initializer_list<uint8_t> cmds) {
+        Wire.beginTransmission(OLED_ADDRESS);
+        Wire.write(static_cast<uint8_t>(0x00)); // Co = 0, D/C = 0: command stream
+        for (const uint8_t c : cmds) Wire.write(c);
+        Wire.endTransmission();
+    }
 
-    xSemaphoreTake(displayBufferMutex, portMAX_DELAY);
-    const auto lines = displayBuffer.getTextToDisplay(width, height);
-    xSemaphoreGive(displayBufferMutex);
-    for(auto &line : lines) {
-        display.println(line.c_str());
+    void pushFrame() {
+        const uint8_t *frame = display.getBuffer();
+        if (!sentValid) {
+            display.display();
+            memcpy(sentFrame, frame, FRAME_BYTES);
+            sentValid = true;
+            return;
+        }
+        for (uint8_t page = 0; page < PAGES; ++page) {
+            const uint8_t *now = frame + page * SCREEN_WIDTH;
+            uint8_t *was = sentFrame + page * SCREEN_WIDTH;
+            int first = 0;
+            while (first < SCREEN_WIDTH && now[first] == was[first]) ++first;
+            if (first == SCREEN_WIDTH) continue;
+            int last = SCREEN_WIDTH - 1;
+            while (now[last] == was[last]) --last;
+
+            sendCommands({SSD1306_PAGEADDR, page, page, SSD1306_COLUMNADDR,
+                          static_cast<uint8_t>(first), static_cast<uint8_t>(last)});
+            for (int col = first; col <= last; col += I2C_CHUNK) {
+                const size_t n = std::min<size_t>(I2C_CHUNK, last + 1 - col);
+                Wire.beginTransmission(OLED_ADDRESS);
+                Wire.write(static_cast<uint8_t>(0x40)); // Co = 0, D/C = 1: data stream
+                Wire.write(now + col, n);
+                Wire.endTransmission();
+            }
+            memcpy(was + first, now + first, last + 1 - first);
+        }
+    }
+
+    ScreenState currentState(bool idle) {
+        ScreenState state{};
+        state.idle = idle;
+        if (idle) return state;
+#if defined(MQTT)
+        state.mqttIcon = static_cast<int8_t>(mqttStatusToIconIndex());
+#endif
+        state.wifiIcon = static_cast<int8_t>(min(wifiStatus.signalStrengthPercent.load(), 99) / 25);
+        state.footer = -1;
+        if (wifiStatus.connectionStatus == ConnState::Connected) {
+            // every 10 seconds alternate between url and ip
+            state.footer = static_cast<int8_t>(getSecondsSinceStart() / 10 % 2);
+            state.ip = static_cast<uint32_t>(WiFi.localIP());
+        }
+        return state;
+    }
+
+    bool sameState(const ScreenState &a, const ScreenState &b) {
+        return a.idle == b.idle && a.mqttIcon == b.mqttIcon && a.wifiIcon == b.wifiIcon &&
+               a.footer == b.footer && a.ip == b.ip;
     }
-    return lines.size() > 0;
 }
 
 void drawData() {
     display.setTextSize(1);
     display.setTextColor(SSD1306_WHITE);
 
-    display.setTextSize(1);
-    display.setTextColor(SSD1306_WHITE);
+    const int width = SCREEN_WIDTH / 6; // char width is 5 + 1 pixel space
+    const int height = (SCREEN_HEIGHT - 20 - 8) / 8; // char height is 7 + 1 pixel space and 20 pixels (12 pixels + an empty line) for the header + 8 for the footer
 
-    if (millis() - lastDisplayActivityMs >= MILLIS_BEFORE_IDLE_SCREEN) {
-        enterIdleScreen();
-        return;
+    bool linesChanged = false;
+    const bool idleTimeout = millis() - lastDisplayActivityMs >= MILLIS_BEFORE_IDLE_SCREEN;
+    if (!idleTimeout) {
+        xSemaphoreTake(displayBufferMutex, portMAX_DELAY);
+        linesChanged = displayBuffer.getTextToDisplay(width, height, shownLines);
+        xSemaphoreGive(displayBufferMutex);
+    }
+    const bool idle = idleTimeout || shownLines.empty();
+    if (idle) {
+        if (!drawnState.idle || !drawnValid) enterIdleScreen();
+        shownLines.clear();
     }
 
-    drawHeader();
-
-    display.setCursor(0, 20);
-    const bool hasData = drawContents();
+    const ScreenState state = currentState(idle);
+    if (drawnValid && sameState(state, drawnState) && (idle || !linesChanged)) {
+        return; // nothing visible changed: no drawing, no I2C traffic
+    }
 
-    if (hasData) {
-        timeSinceNoData = std::chrono::system_clock::now();
-        drawFooter();
+    display.clearDisplay();
+    if (idle) {
+        drawIdleScreen();
     } else {
-        enterIdleScreen();
-        return;
+        drawHeader();
+        display.setCursor(0, 20);
+        for (auto &line : shownLines) {
+            display.println(line.c_str());
+        }
+        drawFooter();
     }
+    pushFrame();
 
+    drawnState = state;
+    drawnValid = true;
+}
 
-        display.clearDisplay();
-
-        const auto secondsSinceNoData = getSecondsSinceNoData();
+void handleTimerTick() {
+    notifyDisplayTask();
+}
 
-        if (timerIsFast || secondsSinceNoData < SECONDS_BEFORE_SCREENSAVER) {
-            drawData();
-        } else {
-            drawLogo();
+void displayTask(void *) {
+    bool blanked = false;
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        if (!displayEnabled.load()) {
+            if (!blanked) {
+                display.clearDisplay();
+                pushFrame();
+                drawnValid = false;
+                blanked = true;
+            }
+            continue;
         }
-
-        display.display();
+        blanked = false;
+        drawData();
     }
 }
 
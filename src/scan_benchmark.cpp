@@ -0,0 +1,190 @@
+#include <interact.h>
+
+#if defined(CMD_BENCHMARK)
+
+#include <Arduino.h>
+#include <board-config.h>
+#include <iohcRadio.h>
+#include <iohcScanScheduler.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+/* Radio scan simulator: replays a reference traffic mix against the scan
+ * scheduler, the way the RX state machine drives it, and reports the share of
+ * transmissions whose preamble was heard. Pure computation; the radio keeps
+ * running while it executes. */
+
+namespace {
+
+using IOHC::iohcScanScheduler;
+
+// A receiver needs about two preamble bytes at 38.4 kbit/s to detect it
+constexpr uint32_t DETECT_US = 420;
+constexpr uint32_t DEFAULT_SECONDS = 900;
+constexpr int MIN_SECONDS = 10;
+constexpr int MAX_SECONDS = 3600;  // makeTraffic keeps every transmission in RAM
+
+/* Reference mix, per configured scan channel (FREQS2SCAN order: 868.95,
+ * 868.25, 869.85 MHz). 1W repeats use the 40 ms short preamble; 2W frames
+ * use a few ms of preamble, which is what a scan can miss. */
+struct TrafficClass {
+  const char *name;
+  bool oneWay;
+  uint8_t channel;
+  float perMinute;
+  uint32_t preambleUs;
+  uint32_t frameUs;
+};
+
+constexpr TrafficClass REFERENCE_MIX[] = {
+  {"1W 868.95", true, 0, 30.0f, 40000, 8000},
+  {"2W 868.95", false, 0, 12.0f, 3000, 10000},
+  {"2W 868.25", false, 1, 12.0f, 3000, 10000},
+  {"2W 869.85", false, 2, 6.0f, 3000, 10000},
+};
+constexpr size_t CLASS_COUNT = sizeof(REFERENCE_MIX) / sizeof(REFERENCE_MIX[0]);
+
+struct Transmission {
+  uint64_t startUs;
+  uint8_t cls;
+};
+
+struct SimResult {
+  uint32_t sent[CLASS_COUNT];
+  uint32_t heard[CLASS_COUNT];
+};
+
+// xorshift32, so runs are repeatable
+struct Rng {
+  uint32_t state;
+  uint32_t next() {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+  }
+  // Exponential inter-arrival time in us for a rate per minute
+  uint64_t interval(float perMinute) {
+    const double u = (next() + 1.0) / 4294967297.0;
+    return static_cast<uint64_t>(-std::log(u) * 60e6 / perMinute);
+  }
+};
+
+std::vector<Transmission> makeTraffic(uint32_t seconds, uint32_t seed) {
+  std::vector<Transmission> traffic;
+  Rng rng{seed};
+  const uint64_t horizon = static_cast<uint64_t>(seconds) * 1000000ULL;
+  for (uint8_t cls = 0; cls < CLASS_COUNT; ++cls) {
+    for (uint64_t t = rng.interval(REFERENCE_MIX[cls].perMinute); t < horizon;
+         t += rng.interval(REFERENCE_MIX[cls].perMinute)) {
+      traffic.push_back({t, cls});
+    }
+  }
+  std::sort(traffic.begin(), traffic.end(),
+            [](const Transmission &a, const Transmission &b) { return a.startUs < b.startUs; });
+  return traffic;
+}
+
+SimResult simulate(const std::vector<Transmission> &traffic, uint8_t channels, uint32_t dwellUs,
+                   iohcScanScheduler::Policy policy) {
+  SimResult result{};
+  iohcScanScheduler scheduler;
+  scheduler.begin(channels, dwellUs);
+  scheduler.setPolicy(policy);
+
+  IOHC::ScanHop hop = scheduler.first();
+  uint64_t now = 0;
+  uint64_t dwellEnd = hop.dwellUs;
+  size_t nextTx = 0;
+  std::vector<size_t> pending;  // started, preamble still detectable
+
+  while (nextTx < traffic.size() || !pending.empty()) {
+    // Everything that starts before this dwell ends may be heard during it
+    while (nextTx < traffic.size() && traffic[nextTx].startUs < dwellEnd) {
+      ++result.sent[traffic[nextTx].cls];
+      pending.push_back(nextTx++);
+    }
+
+    // Earliest detectable preamble on the current channel within [now, dwellEnd)
+    size_t best = SIZE_MAX;
+    uint64_t bestAt = UINT64_MAX;
+    for (size_t i : pending) {
+      const TrafficClass &cls = REFERENCE_MIX[traffic[i].cls];
+      if (cls.channel != hop.channel) continue;
+      const uint64_t from = std::max(now, traffic[i].startUs);
+      const uint64_t until = traffic[i].startUs + cls.preambleUs - DETECT_US;
+      if (from < until && from < dwellEnd && from < bestAt) {
+        best = i;
+        bestAt = from;
+      }
+    }
+
+    if (best != SIZE_MAX) {
+      // Locked on until the frame is received, then a fresh dwell on the same channel
+      const TrafficClass &cls = REFERENCE_MIX[traffic[best].cls];
+      ++result.heard[traffic[best].cls];
+      scheduler.recordPreamble(hop.channel);
+      scheduler.recordFrame(hop.channel, cls.oneWay);
+      now = traffic[best].startUs + cls.preambleUs + cls.frameUs;
+      dwellEnd = now + hop.dwellUs;
+      pending.erase(std::find(pending.begin(), pending.end(), best));
+    } else {
+      now = dwellEnd;
+      hop = scheduler.next();
+      dwellEnd = now + hop.dwellUs;
+    }
+
+    // Drop transmissions whose preamble can no longer be detected
+    pending.erase(std::remove_if(pending.begin(), pending.end(),
+                                 [&](size_t i) {
+                                   const TrafficClass &cls = REFERENCE_MIX[traffic[i].cls];
+                                   return traffic[i].startUs + cls.preambleUs - DETECT_US <= now;
+                                 }),
+                  pending.end());
+  }
+  return result;
+}
+
+float percent(uint32_t heard, uint32_t sent) {
+  return sent ? 100.0f * heard / sent : 0.0f;
+}
+
+void report(const SimResult &fixed, const SimResult &adaptive) {
+  uint32_t sent = 0, heardFixed = 0, heardAdaptive = 0;
+  Serial.printf("  %-10s %6s %8s %8s\n", "traffic", "sent", "fixed", "adaptive");
+  for (size_t c = 0; c < CLASS_COUNT; ++c) {
+    Serial.printf("  %-10s %6u %7.1f%% %7.1f%%\n", REFERENCE_MIX[c].name, fixed.sent[c],
+                  percent(fixed.heard[c], fixed.sent[c]), percent(adaptive.heard[c], adaptive.sent[c]));
+    sent += fixed.sent[c];
+    heardFixed += fixed.heard[c];
+    heardAdaptive += adaptive.heard[c];
+  }
+  Serial.printf("  %-10s %6u %7.1f%% %7.1f%%\n", "total", sent, percent(heardFixed, sent),
+                percent(heardAdaptive, sent));
+}
+
+} // namespace
+
+namespace Cmd {
+
+void registerScanBenchmark() {
+  addHandler((char *) "hopBench", (char *) "Simulated capture rate, fixed vs adaptive scan [seconds]", [](const TokenView *cmd)-> void {
+    int requested = 0;
+    cmd->integer(1, requested);
+    const uint32_t seconds = cmd->size() > 1 ? std::clamp(requested, MIN_SECONDS, MAX_SECONDS) : DEFAULT_SECONDS;
+    uint32_t freqs[] = FREQS2SCAN;
+    const uint8_t channels = sizeof(freqs) / sizeof(freqs[0]);
+
+    const auto traffic = makeTraffic(seconds, 0x1ABCDEF1);
+    Serial.printf("Simulating %u s, %u transmissions, %u channels, %u us base dwell\n", seconds,
+                  static_cast<unsigned>(traffic.size()), channels, DEFAULT_SCAN_INTERVAL_US);
+    report(simulate(traffic, channels, DEFAULT_SCAN_INTERVAL_US, iohcScanScheduler::Policy::Fixed),
+           simulate(traffic, channels, DEFAULT_SCAN_INTERVAL_US, iohcScanScheduler::Policy::Adaptive));
+  });
+}
+
+}
+
+#endif // CMD_BENCHMARK
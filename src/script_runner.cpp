@@ -0,0 +1,447 @@
+#include <script_runner.h>
+
+#include <Arduino.h>
+#include <LittleFS.h>
+
+#include <interact.h>
+#include <iohcRemote1W.h>
+#include <log_buffer.h>
+#include <logger.h>
+#include <tokens.h>
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <cstring>
+#include <deque>
+#include <memory>
+
+extern "C" {
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+}
+
+namespace {
+
+constexpr uint32_t DEFAULT_WAITFRAME_MS = 10000;
+constexpr size_t MAX_NAME_LEN = 24;
+
+enum class Op : uint8_t { Command, Delay, Repeat, Foreach, End, WaitFrame };
+
+struct Step {
+  Op op;
+  std::string text;      // command line or group spec
+  uint32_t value = 0;    // delay/timeout ms or repeat count
+  uint16_t jump = 0;     // matching end (Repeat/Foreach) or block start (End)
+  uint8_t addr[3]{};
+  bool anyAddr = false;
+};
+
+struct Program {
+  std::string name;
+  std::vector<Step> steps;
+};
+
+struct Loop {
+  uint16_t start;
+  uint32_t remaining;                // repeat
+  std::vector<std::string> devices;  // foreach
+  size_t index;
+};
+
+SemaphoreHandle_t s_mutex = nullptr;
+TaskHandle_t s_task = nullptr;
+std::deque<std::unique_ptr<Program>> s_queue;
+ScriptStatus s_status{};
+std::atomic<bool> s_stop{false};
+uint32_t s_startedMs = 0;
+
+// waitframe handshake with the RX path
+std::atomic<bool> s_waitArmed{false};
+std::atomic<bool> s_frameSeen{false};
+uint8_t s_waitAddr[3];
+bool s_waitAny = false;
+
+void lock() { xSemaphoreTake(s_mutex, portMAX_DELAY); }
+void unlock() { xSemaphoreGive(s_mutex); }
+
+bool validName(const std::string &name) {
+  if (name.empty() || name.size() > MAX_NAME_LEN) return false;
+  return std::all_of(name.begin(), name.end(), [](char c) { return isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '-'; });
+}
+
+std::string scriptPath(const std::string &name) {
+  return std::string(SCRIPT_DIR) + "/" + name + ".txt";
+}
+
+bool parseNumber(std::string_view token, uint32_t &out) {
+  const auto res = std::from_chars(token.data(), token.data() + token.size(), out);
+  return !token.empty() && res.ec == std::errc() && res.ptr == token.data() + token.size();
+}
+
+std::string_view trim(std::string_view s) {
+  while (!s.empty() && isspace(static_cast<unsigned char>(s.front()))) s.remove_prefix(1);
+  while (!s.empty() && isspace(static_cast<unsigned char>(s.back()))) s.remove_suffix(1);
+  return s;
+}
+
+bool compile(const std::string &body, Program &program, std::string &error) {
+  std::vector<uint16_t> open;
+  size_t lineNo = 0;
+  bool ok = true;
+
+  auto fail = [&](const char *what) {
+    if (ok) error = "line " + std::to_string(lineNo) + ": " + what;
+    ok = false;
+  };
+
+  auto statement = [&](std::string_view line) {
+    line = trim(line);
+    if (!ok || line.empty()) return;
+    if (program.steps.size() >= SCRIPT_MAX_STEPS) {
+      fail("too many statements");
+      return;
+    }
+
+    const TokenView tok(line);
+    Step step{};
+    if (tok[0] == "delay") {
+      step.op = Op::Delay;
+      if (tok.size() != 2 || !parseNumber(tok[1], step.value)) fail("usage: delay <ms>");
+    } else if (tok[0] == "repeat") {
+      step.op = Op::Repeat;
+      if (tok.size() != 2 || !parseNumber(tok[1], step.value)) fail("usage: repeat <count>");
+      open.push_back(program.steps.size());
+    } else if (tok[0] == "foreach") {
+      step.op = Op::Foreach;
+      step.text = std::string(trim(line.substr(tok[0].size())));
+      if (step.text.empty()) fail("usage: foreach <group>");
+      open.push_back(program.steps.size());
+    } else if (tok[0] == "end") {
+      step.op = Op::End;
+      if (open.empty()) {
+        fail("end without repeat/foreach");
+        return;
+      }
+      step.jump = open.back();
+      program.steps[open.back()].jump = program.steps.size();
+      open.pop_back();
+    } else if (tok[0] == "waitframe") {
+      step.op = Op::WaitFrame;
+      step.value = DEFAULT_WAITFRAME_MS;
+      step.anyAddr = tok[1] == "any";
+      if (tok.size() < 2 || tok.size() > 3 || (!step.anyAddr && !tok.hexAddress(1, step.addr)) ||
+          (tok.size() == 3 && !parseNumber(tok[2], step.value)))
+        fail("usage: waitframe <address|any> [timeout ms]");
+    } else {
+      step.op = Op::Command;
+      step.text = std::string(line);
+      if (tok[0] != "help" && !Cmd::findHandler(tok[0].data(), tok[0].size()))
+        fail("unknown command");
+    }
+    program.steps.push_back(std::move(step));
+  };
+
+  const std::string_view text(body);
+  size_t start = 0;
+  while (ok && start < text.size()) {
+    size_t end = text.find('\n', start);
+    if (end == std::string_view::npos) end = text.size();
+    const std::string_view line = text.substr(start, end - start);
+    start = end + 1;
+    lineNo++;
+    if (trim(line).substr(0, 1) == "#") continue;
+    splitTokens(line, ';', statement);
+  }
+  if (ok && !open.empty()) {
+    error = "missing end";
+    ok = false;
+  }
+  return ok;
+}
+
+std::string substitute(const std::string &text, const std::string *device) {
+  if (!device) return text;
+  std::string out = text;
+  for (size_t pos = out.find("$dev"); pos != std::string::npos; pos = out.find("$dev", pos + device->size()))
+    out.replace(pos, 4, *device);
+  return out;
+}
+
+// Sleep until `deadline`; with `forFrame` return early once the armed frame
+// arrives. Returns false when stopped, or when a frame wait timed out.
+bool waitUntil(TickType_t deadline, bool forFrame) {
+  for (;;) {
+    if (s_stop) return false;
+    if (forFrame && s_frameSeen) return true;
+    const TickType_t now = xTaskGetTickCount();
+    const int32_t remaining = static_cast<int32_t>(deadline - now);
+    if (remaining <= 0) return !forFrame;
+    ulTaskNotifyTake(pdTRUE, remaining);
+  }
+}
+
+void setError(const std::string &error) {
+  lock();
+  s_status.lastError = error;
+  unlock();
+  addLogMessage(String("Script ") + s_status.name.c_str() + ": " + error.c_str());
+}
+
+void runProgram(const Program &program) {
+  std::vector<Loop> loops;
+  TickType_t deadline = xTaskGetTickCount();
+  uint16_t pc = 0;
+
+  while (pc < program.steps.size() && !s_stop) {
+    const Step &step = program.steps[pc];
+    lock();
+    s_status.step = pc;
+    unlock();
+
+    switch (step.op) {
+      case Op::Command: {
+        const std::string *device = nullptr;
+        for (auto it = loops.rbegin(); it != loops.rend(); ++it) {
+          if (!it->devices.empty()) {
+            device = &it->devices[it->index];
+            break;
+          }
+        }
+        Cmd::execute(substitute(step.text, device).c_str());
+        pc++;
+        break;
+      }
+      case Op::Delay:
+        deadline += pdMS_TO_TICKS(step.value);
+        if (static_cast<int32_t>(deadline - xTaskGetTickCount()) < 0)
+          deadline = xTaskGetTickCount(); // fell behind, do not try to catch up
+        waitUntil(deadline, false);
+        pc++;
+        break;
+      case Op::Repeat:
+        if (!step.value) {
+          pc = step.jump + 1;
+        } else {
+          loops.push_back({pc, step.value, {}, 0});
+          pc++;
+        }
+        break;
+      case Op::Foreach: {
+        auto devices = IOHC::iohcRemote1W::getInstance()->resolveGroup(step.text);
+        if (devices.empty()) {
+          pc = step.jump + 1;
+        } else {
+          loops.push_back({pc, 0, std::move(devices), 0});
+          pc++;
+        }
+        break;
+      }
+      case Op::End: {
+        Loop &loop = loops.back();
+        const bool again = loop.devices.empty() ? --loop.remaining > 0 : ++loop.index < loop.devices.size();
+        if (again) {
+          pc = loop.start + 1;
+        } else {
+          loops.pop_back();
+          pc++;
+        }
+        break;
+      }
+      case Op::WaitFrame: {
+        memcpy(s_waitAddr, step.addr, sizeof(s_waitAddr));
+        s_waitAny = step.anyAddr;
+        s_frameSeen = false;
+        s_waitArmed = true;
+        const bool seen = waitUntil(xTaskGetTickCount() + pdMS_TO_TICKS(step.value), true);
+        s_waitArmed = false;
+        if (!seen) {
+          if (!s_stop) setError("waitframe timed out at statement " + std::to_string(pc));
+          return;
+        }
+        deadline = xTaskGetTickCount();
+        pc++;
+        break;
+      }
+    }
+  }
+  if (s_stop) setError("stopped");
+}
+
+void scriptTask(void *) {
+  for (;;) {
+    std::unique_ptr<Program> program;
+    lock();
+    if (!s_queue.empty()) {
+      program = std::move(s_queue.front());
+      s_queue.pop_front();
+      s_status.running = true;
+      s_status.name = program->name;
+      s_status.step = 0;
+      s_status.steps = program->steps.size();
+      s_status.queued = s_queue.size();
+      s_status.lastError.clear();
+    }
+    unlock();
+
+    if (!program) {
+      ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+      continue;
+    }
+
+    s_stop = false;
+    const uint32_t started = millis();
+    s_startedMs = started;
+    runProgram(*program);
+    const uint32_t elapsedMs = millis() - started;
+    lock();
+    s_status.running = false;
+    s_status.elapsedMs = elapsedMs;
+    s_status.completed++;
+    unlock();
+    LOG_I(Script, "Script %s finished in %u ms", program->name.c_str(), static_cast<unsigned>(elapsedMs));
+  }
+}
+
+bool enqueue(std::unique_ptr<Program> program, std::string &error) {
+  if (!s_task) {
+    error = "script runner not started";
+    return false;
+  }
+  lock();
+  if (s_queue.size() >= SCRIPT_QUEUE_DEPTH) {
+    unlock();
+    error = "script queue full";
+    return false;
+  }
+  s_queue.push_back(std::move(program));
+  s_status.queued = s_queue.size();
+  unlock();
+  xTaskNotifyGive(s_task);
+  return true;
+}
+
+} // namespace
+
+void initScriptRunner() {
+  if (s_task) {
+    return;
+  }
+
+  s_mutex = xSemaphoreCreateMutex();
+  if (!s_mutex) {
+    Serial.println("Failed to create script mutex");
+    return;
+  }
+  if (!LittleFS.exists(SCRIPT_DIR)) {
+    LittleFS.mkdir(SCRIPT_DIR);
+  }
+
+  // Scripts run console commands, so they get the same stack as the console task
+  if (xTaskCreatePinnedToCore(scriptTask, "scripts", 8192, nullptr, 1, &s_task, tskNO_AFFINITY) != pdPASS) {
+    Serial.println("Failed to create script task");
+    vSemaphoreDelete(s_mutex);
+    s_mutex = nullptr;
+    s_task = nullptr;
+  }
+}
+
+std::vector<std::string> listScripts() {
+  std::vector<std::string> names;
+  fs::File dir = LittleFS.open(SCRIPT_DIR);
+  if (!dir || !dir.isDirectory()) return names;
+  for (fs::File f = dir.openNextFile(); f; f = dir.openNextFile()) {
+    std::string name = f.name();
+    const size_t slash = name.rfind('/');
+    if (slash != std::string::npos) name.erase(0, slash + 1);
+    if (name.size() > 4 && name.compare(name.size() - 4, 4, ".txt") == 0) {
+      names.push_back(name.substr(0, name.size() - 4));
+    }
+  }
+  return names;
+}
+
+bool loadScript(const std::string &name, std::string &body) {
+  if (!validName(name)) return false;
+  fs::File f = LittleFS.open(scriptPath(name).c_str(), "r");
+  if (!f) return false;
+  body = f.readString().c_str();
+  return true;
+}
+
+bool saveScript(const std::string &name, const std::string &body, std::string &error) {
+  if (!validName(name)) {
+    error = "invalid name, use letters, digits, _ or - (max 24)";
+    return false;
+  }
+  Program program;
+  if (!compile(body, program, error)) return false;
+  fs::File f = LittleFS.open(scriptPath(name).c_str(), "w");
+  if (!f || f.print(body.c_str()) != body.size()) {
+    error = "write failed";
+    return false;
+  }
+  return true;
+}
+
+bool deleteScript(const std::string &name) {
+  return validName(name) && LittleFS.remove(scriptPath(name).c_str());
+}
+
+bool runScript(const std::string &name, std::string &error) {
+  std::string body;
+  if (!loadScript(name, body)) {
+    error = "unknown script";
+    return false;
+  }
+  auto program = std::make_unique<Program>();
+  program->name = name;
+  return compile(body, *program, error) && enqueue(std::move(program), error);
+}
+
+bool runScriptText(const std::string &body, std::string &error) {
+  auto program = std::make_unique<Program>();
+  program->name = "(inline)";
+  return compile(body, *program, error) && enqueue(std::move(program), error);
+}
+
+void stopScripts() {
+  if (!s_task) return;
+  lock();
+  s_queue.clear();
+  s_status.queued = 0;
+  unlock();
+  s_stop = true;
+  xTaskNotifyGive(s_task);
+}
+
+ScriptStatus getScriptStatus() {
+  if (!s_mutex) return {};
+  lock();
+  ScriptStatus status = s_status;
+  unlock();
+  if (status.running) status.elapsedMs = millis() - s_startedMs;
+  return status;
+}
+
+void appendScriptStatus(JsonObject &root) {
+  const ScriptStatus status = getScriptStatus();
+  JsonObject script = root["status"].to<JsonObject>();
+  script["running"] = status.running;
+  script["name"] = status.name;
+  script["step"] = status.step;
+  script["steps"] = status.steps;
+  script["elapsed_ms"] = status.elapsedMs;
+  script["queued"] = status.queued;
+  script["completed"] = status.completed;
+  script["last_error"] = status.lastError;
+}
+
+void scriptFrameReceived(const uint8_t *source) {
+  if (!s_waitArmed) return;
+  if (s_waitAny || memcmp(source, s_waitAddr, sizeof(s_waitAddr)) == 0) {
+    s_frameSeen = true;
+    xTaskNotifyGive(s_task);
+  }
+}
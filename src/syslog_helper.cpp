@@ -9,7 +9,9 @@
 #include <esp_log.h>
 #include <esp_random.h>
 #include <nvs_helpers.h>
-#include <time.h>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
 
 // ===== Config (adjust if you like) =====
 #ifndef SYSLOG_FACILITY
@@ -20,8 +22,22 @@
 #define SYSLOG_APP "MIOPENIO"        // rsyslog will use this as %PROGRAMNAME%
 #endif
 
-// Define SYSLOG_RFC5424 to send RFC5424 instead of RFC3164
-// #define SYSLOG_RFC5424
+#ifndef SYSLOG_QUEUE_DEPTH
+#define SYSLOG_QUEUE_DEPTH 24        // records waiting for the sender task
+#endif
+
+#ifndef SYSLOG_MAX_MESSAGE
+#define SYSLOG_MAX_MESSAGE 240       // longer messages are truncated
+#endif
+
+#ifndef SYSLOG_MAX_DATAGRAM
+#define SYSLOG_MAX_DATAGRAM 1200     // stays below a typical path MTU
+#endif
+
+// Define SYSLOG_BATCH to pack several newline separated records into one
+// datagram. Only for receivers that split datagrams on newlines (e.g. a
+// Graylog raw/plaintext UDP input); plain syslog inputs take one per datagram.
+// #define SYSLOG_BATCH
 
 namespace {
     WiFiUDP      syslogUdp;
@@ -70,108 +86,174 @@ namespace {
         configLoaded = true;
     }
 
-#ifndef SYSLOG_RFC5424
-    // RFC3164 timestamp: "Jan  2 15:04:05" (local time)
-    String rfc3164Timestamp() {
-        time_t now = time(nullptr);
-        struct tm tmnow;
-        localtime_r(&now, &tmnow);
-        char buf[32];
-        strftime(buf, sizeof(buf), "%b %e %T", &tmnow);
-        return String(buf);
-    }
-#else
-    // RFC5424 timestamp: "YYYY-MM-DDTHH:MM:SSZ" (UTC)
-    String iso8601UTC() {
-        time_t now = time(nullptr);
-        struct tm tmnow;
-        gmtime_r(&now, &tmnow);
-        char buf[32];
-        strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%SZ", &tmnow);
-        return String(buf);
-    }
-#endif
+    struct SyslogRecord {
+        uint8_t severity;
+        uint8_t len;
+        char text[SYSLOG_MAX_MESSAGE];
+    };
+
+    QueueHandle_t s_queue = nullptr;
+    TaskHandle_t s_task = nullptr;
+    std::atomic<bool> s_reconfigure{true};
+    std::atomic<uint32_t> s_queued{0};
+    std::atomic<uint32_t> s_sent{0};
+    std::atomic<uint32_t> s_datagrams{0};
+    std::atomic<uint32_t> s_dropped{0};
+    std::atomic<uint32_t> s_failed{0};
+    char s_ident[64];
+
+    // Resolve the server and open the socket. Runs on the sender task only,
+    // so a slow DNS lookup never blocks the task that logged.
+    void applyConfig() {
+        ESP_LOGD(TAG, "Init syslog: enabled=%d server='%s' port=%u",
+                 syslog_enabled ? 1 : 0, syslog_server.c_str(), syslog_port);
+
+        if (syslogReady) {
+            syslogUdp.stop();
+            syslogReady = false;
+        }
+        if (syslog_server.empty()) {
+            ESP_LOGD(TAG, "Syslog server not set");
+            return;
+        }
+        if (syslog_port == 0) {
+            ESP_LOGD(TAG, "Invalid syslog port: %u", syslog_port);
+            return;
+        }
+        if (!syslogIP.fromString(syslog_server.c_str())) {
+            if (WiFi.hostByName(syslog_server.c_str(), syslogIP) != 1) {
+                ESP_LOGD(TAG, "Unable to resolve syslog server: %s", syslog_server.c_str());
+                return;
+            }
+        }
 
-    String currentHostIdent() {
         const char *h = WiFi.getHostname();
-        if (h && *h) return String(h);
-        return WiFi.localIP().toString();
-    }
-}
+        const String host = (h && *h) ? String(h) : WiFi.localIP().toString();
+        if (syslog_tag.empty()) snprintf(s_ident, sizeof(s_ident), "%s", host.c_str());
+        else snprintf(s_ident, sizeof(s_ident), "%s-%s", syslog_tag.c_str(), host.c_str());
 
-// Initialize UDP + resolve syslog IP from user_config.h
-void initSyslog() {
-    ensureConfigLoaded();
+        syslogUdp.begin(0);
+        syslogReady = true;
+        ESP_LOGD(TAG, "Syslog initialized with IP: %s", syslogIP.toString().c_str());
+    }
 
-    ESP_LOGD(TAG, "Init syslog: enabled=%d server='%s' port=%u",
-             syslog_enabled ? 1 : 0, syslog_server.c_str(), syslog_port);
+    // No timestamp - device has no NTP so Jan 1 epoch would be rejected by syslog servers.
+    // The receiver timestamps the message on arrival instead.
+    size_t formatRecord(char *out, size_t cap, const SyslogRecord &rec) {
+        const int n = snprintf(out, cap, "<%d>%s " SYSLOG_APP ": [" SYSLOG_SECRET "] %.*s",
+                               pri(SYSLOG_FACILITY, rec.severity), s_ident, rec.len, rec.text);
+        return n < 0 ? 0 : std::min<size_t>(n, cap - 1);
+    }
 
-    if (!syslog_enabled) {
-        ESP_LOGD(TAG, "Syslog disabled - not initializing");
-        resetSyslog();
-        return;
+    void senderTask(void *) {
+        static char datagram[SYSLOG_MAX_DATAGRAM];
+        SyslogRecord rec;
+        bool carried = false;
+
+        for (;;) {
+            if (!syslog_enabled) {
+                xQueueReset(s_queue);
+                carried = false;
+                vTaskDelay(pdMS_TO_TICKS(1000));
+                continue;
+            }
+            // Records stay queued while offline; the oldest are dropped when full
+            if (WiFi.status() != WL_CONNECTED) {
+                vTaskDelay(pdMS_TO_TICKS(500));
+                continue;
+            }
+            if (s_reconfigure.exchange(false)) {
+                applyConfig();
+            }
+            if (!syslogReady) {
+                vTaskDelay(pdMS_TO_TICKS(5000));
+                s_reconfigure = true;
+                continue;
+            }
+
+            if (!carried && xQueueReceive(s_queue, &rec, pdMS_TO_TICKS(1000)) != pdTRUE) {
+                continue;
+            }
+            carried = false;
+            size_t len = formatRecord(datagram, sizeof(datagram), rec);
+            uint32_t records = 1;
+#if defined(SYSLOG_BATCH)
+            // Newline separated records, as long as they fit in one datagram
+            char line[SYSLOG_MAX_MESSAGE + 96];
+            while (xQueueReceive(s_queue, &rec, 0) == pdTRUE) {
+                const size_t lineLen = formatRecord(line, sizeof(line), rec);
+                if (len + 1 + lineLen > sizeof(datagram)) {
+                    carried = true;
+                    break;
+                }
+                datagram[len++] = '\n';
+                memcpy(datagram + len, line, lineLen);
+                len += lineLen;
+                ++records;
+            }
+#endif
+            syslogUdp.beginPacket(syslogIP, syslog_port);
+            syslogUdp.write(reinterpret_cast<const uint8_t *>(datagram), len);
+            if (syslogUdp.endPacket()) {
+                s_sent += records;
+                ++s_datagrams;
+            } else {
+                s_failed += records;
+            }
+        }
     }
+}
 
-    if (syslog_server.empty()) {
-        ESP_LOGD(TAG, "Syslog server not set");
-        resetSyslog();
+void startSyslogSender() {
+    if (s_task) {
         return;
     }
-
-    if (syslog_port == 0 || syslog_port > 65535) {
-        ESP_LOGD(TAG, "Invalid syslog port: %u", syslog_port);
-        resetSyslog();
+    ensureConfigLoaded();
+    s_queue = xQueueCreate(SYSLOG_QUEUE_DEPTH, sizeof(SyslogRecord));
+    if (!s_queue) {
+        Serial.println("Failed to create syslog queue");
         return;
     }
-
-    if (!syslogIP.fromString(syslog_server.c_str())) {
-        if (WiFi.hostByName(syslog_server.c_str(), syslogIP) != 1) {
-            ESP_LOGD(TAG, "Unable to resolve syslog server: %s", syslog_server.c_str());
-            resetSyslog();
-            return;
-        }
+    if (xTaskCreatePinnedToCore(senderTask, "syslog", 4096, nullptr, 1, &s_task, 0) != pdPASS) {
+        Serial.println("Failed to create syslog task");
+        vQueueDelete(s_queue);
+        s_queue = nullptr;
+        s_task = nullptr;
     }
+}
 
-    if (!syslogReady) {
-        syslogUdp.begin(0);
-        syslogReady = true;
-    }
+// Reload the settings and re-resolve the server on the sender task
+void initSyslog() {
+    ensureConfigLoaded();
+    s_reconfigure = true;
+}
 
-    ESP_LOGD(TAG, "Syslog initialized with IP: %s", syslogIP.toString().c_str());
+void resetSyslog() {
+    s_reconfigure = true;
 }
 
-// Real sender with RFC header
-void sendSyslog(const String &msg, int severity) {
-    ensureConfigLoaded();
-    if (!syslog_enabled) {
-        return;
-    }
-    if (WiFi.status() != WL_CONNECTED) {
+// Only copies the message into the queue; the sender task does the UDP work
+void sendSyslog(const char *msg, size_t len, int severity) {
+    if (!s_queue || !syslog_enabled) {
         return;
     }
-    if (!syslogReady) {
-        ESP_LOGD(TAG, "Syslog not ready, initializing");
-        initSyslog();
-    }
-    if (!syslog_enabled || !syslogReady) {
-        ESP_LOGD(TAG, "Syslog initialization failed");
-        return;
+    SyslogRecord rec;
+    rec.severity = static_cast<uint8_t>(severity < 0 ? 6 : std::min(severity, 7));
+    rec.len = static_cast<uint8_t>(std::min<size_t>(len, sizeof(rec.text)));
+    memcpy(rec.text, msg, rec.len);
+
+    while (xQueueSend(s_queue, &rec, 0) != pdTRUE) {
+        // Full: make room by dropping the oldest record
+        SyslogRecord oldest;
+        if (xQueueReceive(s_queue, &oldest, 0) == pdTRUE) {
+            ++s_dropped;
+        }
     }
+    ++s_queued;
+}
 
-    const int p     = pri(SYSLOG_FACILITY, severity);
-    const String base = currentHostIdent();
-    const String ho = syslog_tag.empty() ? base : (syslog_tag.c_str() + String("-") + base);
-
-    // No timestamp — device has no NTP so Jan 1 epoch would be rejected by syslog servers.
-    // The receiver timestamps the message on arrival instead.
-    const String header = "<" + String(p) + ">" + ho + " " + SYSLOG_APP + ": ";
-    const String wire   = header + "[" SYSLOG_SECRET "] " + msg;
-
-    ESP_LOGD(TAG, "Sending syslog (len=%u): %s", wire.length(), wire.c_str());
-    syslogUdp.beginPacket(syslogIP, syslog_port);
-    syslogUdp.write(reinterpret_cast<const uint8_t*>(wire.c_str()), wire.length());
-    int result = syslogUdp.endPacket();
-    ESP_LOGD(TAG, "Message send result: %d", result);
+void sendSyslog(const String &msg, int severity) {
+    sendSyslog(msg.c_str(), msg.length(), severity);
 }
 
 // Legacy overload without severity (defaults to info)
@@ -179,20 +261,26 @@ void sendSyslog(const String &msg) {
     sendSyslog(msg, 6);
 }
 
-void resetSyslog() {
-    if (syslogReady) {
-        syslogUdp.stop();
-        syslogReady = false;
-    }
+void appendSyslogStats(JsonObject &root) {
+    JsonObject stats = root["stats"].to<JsonObject>();
+    stats["queued"] = s_queued.load();
+    stats["sent"] = s_sent.load();
+    stats["datagrams"] = s_datagrams.load();
+    stats["dropped"] = s_dropped.load();
+    stats["failed"] = s_failed.load();
+    stats["pending"] = s_queue ? uxQueueMessagesWaiting(s_queue) : 0;
 }
 
 #else  // !SYSLOG
 
 // No-op definitions so you can build without SYSLOG
+void startSyslogSender() {}
 void initSyslog() {}
 void resetSyslog() {}
+void sendSyslog(const char *, size_t, int) {}
 void sendSyslog(const String &) {}
 void sendSyslog(const String &, int) {}
+void appendSyslogStats(JsonObject &) {}
 
 
 #endif // SYSLOG
@@ -0,0 +1,269 @@
+#include <timer_service.h>
+
+#include <Arduino.h>
+
+#include <logger.h>
+
+#include <cstring>
+
+namespace {
+
+enum class SlotState : uint8_t {
+  Free,
+  Reserved,  // being set up by timerOnce/timerEvery
+  Pending,
+  Running,   // callback dispatched or queued for the worker
+};
+
+struct Slot {
+  SlotState state = SlotState::Free;
+  TimerDispatch dispatch = TimerDispatch::Immediate;
+  bool cancelled = false;  // cancelled while running: do not rearm
+  uint16_t generation = 0;
+  uint8_t stats = UINT8_MAX;
+  int64_t deadlineUs = 0;
+  uint64_t periodUs = 0;   // 0 for a one-shot timer
+  TimerCallback callback;
+};
+
+Slot s_slots[TIMER_SERVICE_MAX_TIMERS];
+TimerStats s_stats[TIMER_SERVICE_MAX_NAMES];
+uint8_t s_statCount = 0;
+portMUX_TYPE s_mux = portMUX_INITIALIZER_UNLOCKED;
+esp_timer_handle_t s_timer = nullptr;
+int64_t s_armedAt = INT64_MAX;
+QueueHandle_t s_workerQueue = nullptr;
+
+// Callers hold s_mux
+uint8_t statsFor(const char *name, TimerDispatch dispatch) {
+  for (uint8_t i = 0; i < s_statCount; ++i) {
+    if (s_stats[i].name == name || strcmp(s_stats[i].name, name) == 0) return i;
+  }
+  if (s_statCount == TIMER_SERVICE_MAX_NAMES) return UINT8_MAX;
+  s_stats[s_statCount] = TimerStats{};
+  s_stats[s_statCount].name = name;
+  s_stats[s_statCount].worker = dispatch == TimerDispatch::Worker;
+  return s_statCount++;
+}
+
+// Callers hold s_mux. Points the esp_timer at the earliest pending deadline.
+void arm() {
+  int64_t earliest = INT64_MAX;
+  for (const auto &slot : s_slots) {
+    if (slot.state == SlotState::Pending && slot.deadlineUs < earliest) earliest = slot.deadlineUs;
+  }
+  if (earliest == s_armedAt) return;
+  esp_timer_stop(s_timer);
+  s_armedAt = earliest;
+  if (earliest == INT64_MAX) return;
+  const int64_t delay = earliest - esp_timer_get_time();
+  esp_timer_start_once(s_timer, delay > 0 ? delay : 1);
+}
+
+void run(uint8_t idx) {
+  Slot &slot = s_slots[idx];
+  const int64_t now = esp_timer_get_time();
+  const auto lateUs = static_cast<uint32_t>(now > slot.deadlineUs ? now - slot.deadlineUs : 0);
+
+  portENTER_CRITICAL(&s_mux);
+  if (slot.stats != UINT8_MAX) {
+    TimerStats &stats = s_stats[slot.stats];
+    stats.fires++;
+    stats.lateLastUs = lateUs;
+    stats.lateTotalUs += lateUs;
+    if (lateUs > stats.lateMaxUs) stats.lateMaxUs = lateUs;
+  }
+  const bool cancelled = slot.cancelled;
+  portEXIT_CRITICAL(&s_mux);
+
+  if (!cancelled) slot.callback();
+
+  portENTER_CRITICAL(&s_mux);
+  if (slot.periodUs && !slot.cancelled) {
+    // Keep the phase; periods that already passed are dropped, not replayed
+    slot.deadlineUs += slot.periodUs;
+    const int64_t after = esp_timer_get_time();
+    if (slot.deadlineUs <= after) {
+      const uint64_t behind = (after - slot.deadlineUs) / slot.periodUs + 1;
+      slot.deadlineUs += behind * slot.periodUs;
+      if (slot.stats != UINT8_MAX) s_stats[slot.stats].skipped += behind;
+    }
+    slot.state = SlotState::Pending;
+  } else {
+    slot.state = SlotState::Free;
+    slot.generation++;
+  }
+  arm();
+  portEXIT_CRITICAL(&s_mux);
+}
+
+// esp_timer task: run every due Immediate timer, hand Worker timers to the worker task
+void onServiceTimer(void *) {
+  for (;;) {
+    portENTER_CRITICAL(&s_mux);
+    s_armedAt = INT64_MAX;
+    const int64_t now = esp_timer_get_time();
+    uint8_t due = UINT8_MAX;
+    for (uint8_t i = 0; i < TIMER_SERVICE_MAX_TIMERS; ++i) {
+      const Slot &slot = s_slots[i];
+      if (slot.state == SlotState::Pending && slot.deadlineUs <= now &&
+          (due == UINT8_MAX || slot.deadlineUs < s_slots[due].deadlineUs))
+        due = i;
+    }
+    if (due == UINT8_MAX) {
+      arm();
+      portEXIT_CRITICAL(&s_mux);
+      return;
+    }
+    s_slots[due].state = SlotState::Running;
+    const bool worker = s_slots[due].dispatch == TimerDispatch::Worker;
+    portEXIT_CRITICAL(&s_mux);
+
+    // The queue holds every slot, so this never fails
+    if (worker) xQueueSend(s_workerQueue, &due, 0);
+    else run(due);
+  }
+}
+
+void workerTask(void *) {
+  uint8_t idx;
+  for (;;) {
+    if (xQueueReceive(s_workerQueue, &idx, portMAX_DELAY) == pdTRUE) run(idx);
+  }
+}
+
+TimerToken start(const char *name, uint64_t delayUs, uint64_t periodUs, TimerCallback &&callback,
+                 TimerDispatch dispatch) {
+  if (!s_timer) {
+    LOG_E(Core, "Timer %s started before the timer service", name);
+    return {};
+  }
+  uint8_t idx = UINT8_MAX;
+  portENTER_CRITICAL(&s_mux);
+  for (uint8_t i = 0; i < TIMER_SERVICE_MAX_TIMERS; ++i) {
+    if (s_slots[i].state == SlotState::Free) {
+      idx = i;
+      s_slots[i].state = SlotState::Reserved;
+      s_slots[i].stats = statsFor(name, dispatch);
+      break;
+    }
+  }
+  portEXIT_CRITICAL(&s_mux);
+  if (idx == UINT8_MAX) {
+    LOG_E(Core, "No free timer for %s", name);
+    return {};
+  }
+
+  Slot &slot = s_slots[idx];
+  slot.callback = std::move(callback);  // outside the lock, may allocate
+  slot.dispatch = dispatch;
+  slot.periodUs = periodUs;
+  slot.cancelled = false;
+
+  portENTER_CRITICAL(&s_mux);
+  slot.deadlineUs = esp_timer_get_time() + static_cast<int64_t>(delayUs);
+  slot.state = SlotState::Pending;
+  const TimerToken token{idx, slot.generation};
+  arm();
+  portEXIT_CRITICAL(&s_mux);
+  return token;
+}
+
+} // namespace
+
+void initTimerService() {
+  if (s_timer) return;
+  s_workerQueue = xQueueCreate(TIMER_SERVICE_MAX_TIMERS, sizeof(uint8_t));
+  const esp_timer_create_args_t args = {
+    .callback = &onServiceTimer,
+    .arg = nullptr,
+    .dispatch_method = ESP_TIMER_TASK,
+    .name = "timer_service",
+  };
+  if (!s_workerQueue || esp_timer_create(&args, &s_timer) != ESP_OK) {
+    LOG_E(Core, "Can't create the timer service");
+    s_timer = nullptr;
+    return;
+  }
+  if (xTaskCreatePinnedToCore(workerTask, "timers", TIMER_SERVICE_STACK, nullptr, 1, nullptr,
+                              tskNO_AFFINITY) != pdPASS) {
+    LOG_E(Core, "Can't create the timer worker task");
+  }
+}
+
+TimerToken timerOnce(const char *name, uint64_t delayUs, TimerCallback callback, TimerDispatch dispatch) {
+  return start(name, delayUs, 0, std::move(callback), dispatch);
+}
+
+TimerToken timerEvery(const char *name, uint64_t periodUs, TimerCallback callback, TimerDispatch dispatch) {
+  return start(name, periodUs, periodUs ? periodUs : 1, std::move(callback), dispatch);
+}
+
+bool timerCancel(TimerToken &token) {
+  if (token.slot >= TIMER_SERVICE_MAX_TIMERS) return false;
+  bool pending = false;
+  portENTER_CRITICAL(&s_mux);
+  Slot &slot = s_slots[token.slot];
+  if (slot.generation == token.generation) {
+    if (slot.state == SlotState::Pending) {
+      pending = true;
+      slot.state = SlotState::Free;
+      slot.generation++;
+      arm();
+    } else if (slot.state == SlotState::Running) {
+      slot.cancelled = true;
+    }
+  }
+  portEXIT_CRITICAL(&s_mux);
+  token = TimerToken{};
+  return pending;
+}
+
+bool timerReschedule(const TimerToken &token, uint64_t periodUs) {
+  if (token.slot >= TIMER_SERVICE_MAX_TIMERS) return false;
+  bool active = false;
+  portENTER_CRITICAL(&s_mux);
+  Slot &slot = s_slots[token.slot];
+  if (slot.generation == token.generation && slot.periodUs && !slot.cancelled) {
+    if (slot.state == SlotState::Pending) {
+      active = true;
+      slot.periodUs = periodUs ? periodUs : 1;
+      slot.deadlineUs = esp_timer_get_time() + static_cast<int64_t>(slot.periodUs);
+      arm();
+    } else if (slot.state == SlotState::Running) {
+      // run() rearms from the current deadline with the new period
+      active = true;
+      slot.periodUs = periodUs ? periodUs : 1;
+    }
+  }
+  portEXIT_CRITICAL(&s_mux);
+  return active;
+}
+
+bool timerActive(const TimerToken &token) {
+  if (token.slot >= TIMER_SERVICE_MAX_TIMERS) return false;
+  portENTER_CRITICAL(&s_mux);
+  const Slot &slot = s_slots[token.slot];
+  const bool active = slot.generation == token.generation &&
+                      (slot.state == SlotState::Pending ||
+                       (slot.state == SlotState::Running && slot.periodUs && !slot.cancelled));
+  portEXIT_CRITICAL(&s_mux);
+  return active;
+}
+
+std::vector<TimerStats> getTimerStats() {
+  std::vector<TimerStats> out;
+  out.reserve(TIMER_SERVICE_MAX_NAMES);
+  portENTER_CRITICAL(&s_mux);
+  out.assign(s_stats, s_stats + s_statCount);
+  portEXIT_CRITICAL(&s_mux);
+  return out;
+}
+
+void resetTimerStats() {
+  portENTER_CRITICAL(&s_mux);
+  for (uint8_t i = 0; i < s_statCount; ++i) {
+    s_stats[i] = TimerStats{s_stats[i].name, s_stats[i].worker};
+  }
+  portEXIT_CRITICAL(&s_mux);
+}
@@ -19,9 +19,14 @@
 #include <iohcPacket.h>
 #include <log_buffer.h>
 #include <mqtt_handler.h>
+#include <frame_telemetry.h>
 #include <nvs_helpers.h>
 #include <oled_display.h>
 #include <version_info.h>
+#include <cover_state_bus.h>
+#include <script_runner.h>
+#include <link_quality.h>
+#include <latency_metrics.h>
 #if defined(SYSLOG)
 #include <WiFi.h>
 #include <syslog_helper.h>
@@ -60,44 +65,219 @@ static void onWsEvent(AsyncWebSocket *server, AsyncWebSocketClient *client,
     client->text(payload);
 
     // Stream cached log messages individually to avoid a large JSON payload
-    auto logMsgs = getLogMessages();
-    for (const auto &m : logMsgs) {
+    readLogMessages(0, [client](uint32_t id, const char *msg, size_t) {
       JsonDocument logDoc;
       logDoc["type"] = "log";
-      logDoc["message"] = m;
+      logDoc["id"] = id;
+      logDoc["message"] = msg;
       String logPayload;
       serializeJson(logDoc, logPayload);
       client->text(logPayload);
-    }
+    });
   }
 }
 
+// Serialize once into a shared message buffer that every client queues by
+// reference, instead of one String per event and a copy per client.
+static void broadcastJson(const JsonDocument &doc) {
+  if (!ws.count()) return;
+  const size_t len = measureJson(doc);
+  // Room for the terminator serializeJson writes, which is not part of the message
+  auto buffer = std::make_shared<std::vector<uint8_t>>(len + 1);
+  serializeJson(doc, reinterpret_cast<char *>(buffer->data()), len + 1);
+  buffer->resize(len);
+  ws.textAll(buffer);
+}
+
 void broadcastLog(const String &msg) {
+  if (!ws.count()) return;
   JsonDocument doc;
   doc["type"] = "log";
   doc["message"] = msg;
-  String payload;
-  serializeJson(doc, payload);
-  ws.textAll(payload);
+  broadcastJson(doc);
 }
 
 void broadcastDevicePosition(const String &id, int position) {
+  if (!ws.count()) return;
   JsonDocument doc;
   doc["type"] = "position";
   doc["id"] = id;
   doc["position"] = position;
-  String payload;
-  serializeJson(doc, payload);
-  ws.textAll(payload);
+  broadcastJson(doc);
 }
 
-void broadcastLastAddress(const String &addr) {
+void broadcastLastAddress(const uint8_t *addr) {
+  if (!ws.count()) return;
+  char hex[7];
+  snprintf(hex, sizeof(hex), "%02x%02x%02x", addr[0], addr[1], addr[2]);
   JsonDocument doc;
   doc["type"] = "lastaddr";
-  doc["address"] = addr;
-  String payload;
-  serializeJson(doc, payload);
-  ws.textAll(payload);
+  doc["address"] = hex;
+  broadcastJson(doc);
+}
+
+/* Binary frame stream on /ws/frames. A client receives nothing until it sends
+ * a filter as a text message; see README for the filter and frame layout. */
+namespace {
+
+constexpr uint8_t FRAME_STREAM_VERSION = 1;
+constexpr size_t FRAME_STREAM_HEADER = 12;
+constexpr size_t FRAME_FILTER_SOURCES = 8;
+
+enum : uint8_t {
+  FRAME_PROTO_1W = 0x01,
+  FRAME_PROTO_2W = 0x02,
+};
+
+struct FrameFilter {
+  uint32_t client;
+  bool subscribed;
+  uint8_t protocols;              // FRAME_PROTO_* mask
+  uint8_t sourceCount;            // 0 matches any source
+  uint8_t sources[FRAME_FILTER_SOURCES][3];
+  bool anyCmd;
+  uint32_t cmds[8];               // bitmap of accepted command ids
+
+  bool matches(const IOHC::iohcPacket *iohc) const {
+    const auto &header = iohc->payload.packet.header;
+    if (!subscribed) return false;
+    const uint8_t proto = header.CtrlByte1.asStruct.Protocol ? FRAME_PROTO_1W : FRAME_PROTO_2W;
+    if (!(protocols & proto)) return false;
+    if (!anyCmd && !(cmds[header.cmd >> 5] & (1u << (header.cmd & 31)))) return false;
+    if (!sourceCount) return true;
+    for (uint8_t i = 0; i < sourceCount; ++i) {
+      if (memcmp(sources[i], header.source, 3) == 0) return true;
+    }
+    return false;
+  }
+};
+
+AsyncWebSocket wsFrames("/ws/frames");
+std::vector<FrameFilter> s_frameFilters;
+SemaphoreHandle_t s_frameFilterMutex = nullptr;
+
+void lockFilters() { xSemaphoreTake(s_frameFilterMutex, portMAX_DELAY); }
+void unlockFilters() { xSemaphoreGive(s_frameFilterMutex); }
+
+FrameFilter *findFilterLocked(uint32_t client) {
+  for (auto &f : s_frameFilters) {
+    if (f.client == client) return &f;
+  }
+  return nullptr;
+}
+
+/* {"source": ["b60d1a", ...], "cmd": [0, 1, ...], "proto": "1w" | "2w" | "all"}
+ * Every key is optional and an omitted key matches everything. */
+bool parseFrameFilter(const uint8_t *data, size_t len, FrameFilter &filter, String &error) {
+  JsonDocument doc;
+  if (deserializeJson(doc, data, len) || !doc.is<JsonObject>()) {
+    error = "filter must be a JSON object";
+    return false;
+  }
+
+  filter.subscribed = true;
+  filter.protocols = FRAME_PROTO_1W | FRAME_PROTO_2W;
+  const char *proto = doc["proto"] | "all";
+  if (strcasecmp(proto, "1w") == 0) filter.protocols = FRAME_PROTO_1W;
+  else if (strcasecmp(proto, "2w") == 0) filter.protocols = FRAME_PROTO_2W;
+  else if (strcasecmp(proto, "all") != 0) {
+    error = "proto must be 1w, 2w or all";
+    return false;
+  }
+
+  filter.sourceCount = 0;
+  for (JsonVariant v : doc["source"].as<JsonArray>()) {
+    const char *addr = v.as<const char *>();
+    if (filter.sourceCount == FRAME_FILTER_SOURCES || !addr ||
+        !TokenView(addr).hexAddress(0, filter.sources[filter.sourceCount])) {
+      error = "source must be up to 8 six digit hex addresses";
+      return false;
+    }
+    ++filter.sourceCount;
+  }
+
+  JsonArray cmds = doc["cmd"].as<JsonArray>();
+  filter.anyCmd = cmds.isNull() || cmds.size() == 0;
+  memset(filter.cmds, 0, sizeof(filter.cmds));
+  for (JsonVariant v : cmds) {
+    if (!v.is<uint8_t>()) {
+      error = "cmd must be a list of command ids 0-255";
+      return false;
+    }
+    const uint8_t cmd = v.as<uint8_t>();
+    filter.cmds[cmd >> 5] |= 1u << (cmd & 31);
+  }
+  return true;
+}
+
+void onFramesEvent(AsyncWebSocket *server, AsyncWebSocketClient *client, AwsEventType type, void *arg,
+                   uint8_t *data, size_t len) {
+  if (type == WS_EVT_CONNECT) {
+    FrameFilter filter{};
+    filter.client = client->id();
+    lockFilters();
+    s_frameFilters.push_back(filter);
+    unlockFilters();
+  } else if (type == WS_EVT_DISCONNECT) {
+    lockFilters();
+    s_frameFilters.erase(std::remove_if(s_frameFilters.begin(), s_frameFilters.end(),
+                                        [client](const FrameFilter &f) { return f.client == client->id(); }),
+                         s_frameFilters.end());
+    unlockFilters();
+  } else if (type == WS_EVT_DATA) {
+    // Filters are small, so only whole single-frame text messages are accepted
+    const auto *info = static_cast<AwsFrameInfo *>(arg);
+    if (!info->final || info->index != 0 || info->len != len || info->opcode != WS_TEXT) return;
+
+    FrameFilter parsed{};
+    String error;
+    if (!parseFrameFilter(data, len, parsed, error)) {
+      client->text(String("{\"success\":false, \"message\":\"") + error + "\"}");
+      return;
+    }
+    lockFilters();
+    if (FrameFilter *filter = findFilterLocked(client->id())) {
+      parsed.client = filter->client;
+      *filter = parsed;
+    }
+    unlockFilters();
+    client->text("{\"success\":true}");
+  }
+}
+
+} // namespace
+
+void broadcastFrame(const IOHC::iohcPacket *iohc) {
+  if (!wsFrames.count() || !s_frameFilterMutex) return;
+
+  uint32_t targets[DEFAULT_MAX_WS_CLIENTS];
+  size_t targetCount = 0;
+  lockFilters();
+  for (const auto &f : s_frameFilters) {
+    if (targetCount < DEFAULT_MAX_WS_CLIENTS && f.matches(iohc)) targets[targetCount++] = f.client;
+  }
+  unlockFilters();
+  if (!targetCount) return;
+
+  // One buffer, referenced by every matching client's queue
+  const size_t len = FRAME_STREAM_HEADER + iohc->buffer_length;
+  auto buffer = std::make_shared<std::vector<uint8_t>>(len);
+  uint8_t *out = buffer->data();
+  const uint32_t now = millis();
+  const uint32_t freq = iohc->frequency;
+  out[0] = FRAME_STREAM_VERSION;
+  out[1] = iohc->payload.packet.header.CtrlByte1.asStruct.Protocol ? FRAME_PROTO_1W : FRAME_PROTO_2W;
+  memcpy(out + 2, &now, sizeof(now));
+  memcpy(out + 6, &freq, sizeof(freq));
+  out[10] = static_cast<uint8_t>(static_cast<int8_t>(lroundf(iohc->rssi)));
+  out[11] = iohc->buffer_length;
+  memcpy(out + FRAME_STREAM_HEADER, iohc->payload.buffer, iohc->buffer_length);
+
+  for (size_t i = 0; i < targetCount; ++i) {
+    AsyncWebSocketClient *client = wsFrames.client(targets[i]);
+    // A client that cannot keep up loses frames rather than growing its queue
+    if (client && !client->queueIsFull()) client->binary(buffer);
+  }
 }
 
 // Structure describing a device entry returned to the web UI
@@ -300,43 +480,42 @@ void handleApiCommand(AsyncWebServerRequest *request, JsonObject &doc, JsonObjec
     return;
   }
 
-  Tokens segments;
-  tokenize(command.c_str(), ' ', segments);
-  if (segments.empty()) {
+  TokenView args(std::string_view(command.c_str(), command.length()));
+  if (args.empty()) {
     request->send(400, "application/json",
                   "{\"success\":false, \"message\":\"Invalid command\"}");
     return;
   }
 
-  deviceId.toLowerCase();
+  const IOHC::iohcRemote1W::remote *target = nullptr;
   if (!deviceId.isEmpty()) {
+    uint8_t node[3];
     const auto &remotes = IOHC::iohcRemote1W::getInstance()->getRemotes();
-    auto it = std::find_if(remotes.begin(), remotes.end(),
-                           [&](const IOHC::iohcRemote1W::remote &r) {
-      return bytesToHexString(r.node, sizeof(r.node)) == deviceId.c_str();
-    });
+    auto it = remotes.end();
+    if (deviceId.length() == 6 && TokenView(deviceId.c_str()).hexAddress(0, node)) {
+      it = std::find_if(remotes.begin(), remotes.end(),
+                        [&](const IOHC::iohcRemote1W::remote &r) {
+        return memcmp(r.node, node, sizeof(node)) == 0;
+      });
+    }
     if (it == remotes.end()) {
       request->send(400, "application/json",
                     "{\"success\":false, \"message\":\"Unknown device\"}");
       return;
     }
-    segments.insert(segments.begin() + 1, it->description);
+    target = &*it;
   }
 
-  bool success = false;
+  if (target)
+    args.insert(1, target->description);
+  const Cmd::Result result = Cmd::dispatch(args);
+  const bool success = result == Cmd::Result::Done;
   String message;
-  for (uint8_t idx = 0; idx <= lastEntry; ++idx) {
-    if (_cmdHandler[idx] == nullptr)
-      continue;
-    if (strcmp(_cmdHandler[idx]->cmd, segments[0].c_str()) == 0) {
-      _cmdHandler[idx]->handler(&segments);
-      success = true;
-      break;
-    }
-  }
 
   if (success)
     message = "Command executed";
+  else if (result == Cmd::Result::InvalidArgs)
+    message = "Invalid arguments";
   else
     message = "Unknown command";
 
@@ -384,9 +563,9 @@ void handleApiAction(AsyncWebServerRequest *request, JsonObject &doc, JsonObject
     return;
   }
 
-  Tokens t;
-  t.push_back(action.c_str());
-  t.push_back(it->description);
+  TokenView t;
+  t.append(std::string_view(action.c_str(), action.length()));
+  t.append(it->description);
   IOHC::iohcRemote1W::getInstance()->cmd(btn, &t);
   broadcastDevicePosition(deviceId,
                           static_cast<int>(it->positionTracker.getPosition()));
@@ -398,21 +577,187 @@ void handleApiAction(AsyncWebServerRequest *request, JsonObject &doc, JsonObject
   root["message"] = msg;
 }
 
+// Group action: {"group": "all|remote name|dev1,dev2"} or {"devices": ["b60d1a", ...]},
+// plus "action" and an optional "position" for position/absolute.
+void handleApiActions(AsyncWebServerRequest *request, JsonObject &doc, JsonObject &root) {
+  String action = doc["action"] | "";
+  action.toLowerCase();
+
+  IOHC::RemoteButton btn;
+  if (!IOHC::groupActionFromString(action.c_str(), btn)) {
+    request->send(400, "application/json",
+                  "{\"success\":false, \"message\":\"Invalid action\"}");
+    return;
+  }
+
+  auto *remote1W = IOHC::iohcRemote1W::getInstance();
+  std::vector<std::string> members;
+  if (doc["devices"].is<JsonArray>()) {
+    std::string spec;
+    for (JsonVariant id : doc["devices"].as<JsonArray>()) {
+      String value = id.as<String>();
+      value.toLowerCase();
+      if (!spec.empty()) spec += ",";
+      spec += value.c_str();
+    }
+    members = remote1W->resolveGroup(spec);
+  } else {
+    members = remote1W->resolveGroup(doc["group"] | "all");
+  }
+
+  uint8_t percent = 0;
+  if (btn == IOHC::RemoteButton::Position || btn == IOHC::RemoteButton::Absolute) {
+    if (!doc["position"].is<int>()) {
+      request->send(400, "application/json",
+                    "{\"success\":false, \"message\":\"Missing position\"}");
+      return;
+    }
+    percent = static_cast<uint8_t>(std::clamp(doc["position"].as<int>(), 0, 100));
+  }
+
+  auto result = remote1W->groupCmd(btn, members, percent);
+
+  root["success"] = result.devices > 0;
+  root["devices"] = result.devices;
+  root["estimated_spread_ms"] = result.estimatedSpreadMs;
+  JsonArray missing = root["missing"].to<JsonArray>();
+  for (const auto &m : result.missing) {
+    missing.add(m);
+  }
+
+  const auto &report = IOHC::iohcRadio::getInstance()->lastBatchReport();
+  JsonObject last = root["last_batch"].to<JsonObject>();
+  last["frames"] = report.frames;
+  last["interleaved"] = report.interleaved;
+  last["start_spread_ms"] = report.startSpreadUs / 1000;
+  last["duration_ms"] = report.durationUs / 1000;
+
+  String msg = "Group " + action + " sent to " + String(result.devices) + " device(s)";
+  addLogMessage(msg);
+  root["message"] = msg;
+}
+
+// GET /api/scripts lists stored scripts and the runner state; ?name=<script> adds its text.
+void handleApiScriptsGet(AsyncWebServerRequest *request, JsonObject &root) {
+  JsonArray names = root["scripts"].to<JsonArray>();
+  for (const auto &name : listScripts()) {
+    names.add(name);
+  }
+  if (request->hasParam("name")) {
+    std::string body;
+    if (loadScript(request->getParam("name")->value().c_str(), body)) {
+      root["script"] = body;
+    }
+  }
+  appendScriptStatus(root);
+}
+
+// POST /api/scripts {"name": "...", "script": "..."} stores a script,
+// {"name": "...", "delete": true} removes it.
+void handleApiScriptsSet(AsyncWebServerRequest *request, JsonObject &doc, JsonObject &root) {
+  std::string name = doc["name"] | "";
+  if (doc["delete"] | false) {
+    const bool deleted = deleteScript(name);
+    root["success"] = deleted;
+    root["message"] = deleted ? "Script deleted" : "Unknown script";
+    return;
+  }
+  std::string error;
+  if (!doc["script"].is<const char *>() || !saveScript(name, doc["script"].as<const char *>(), error)) {
+    root["success"] = false;
+    root["message"] = error.empty() ? "Missing script" : error;
+    String body;
+    serializeJson(root, body);
+    request->send(400, "application/json", body);
+    return;
+  }
+  addLogMessage(String("Script ") + name.c_str() + " saved");
+  root["success"] = true;
+  root["message"] = "Script saved";
+}
+
+// POST /api/scripts/run {"name": "..."} or {"script": "..."} queues a script,
+// {"stop": true} aborts the running one.
+void handleApiScriptsRun(AsyncWebServerRequest *request, JsonObject &doc, JsonObject &root) {
+  if (doc["stop"] | false) {
+    stopScripts();
+    root["success"] = true;
+    root["message"] = "Scripts stopped";
+    return;
+  }
+  std::string error;
+  bool queued;
+  if (doc["script"].is<const char *>()) {
+    queued = runScriptText(doc["script"].as<const char *>(), error);
+  } else {
+    queued = runScript(doc["name"] | "", error);
+  }
+  if (!queued) {
+    root["success"] = false;
+    root["message"] = error;
+    String body;
+    serializeJson(root, body);
+    request->send(400, "application/json", body);
+    return;
+  }
+  root["success"] = true;
+  root["message"] = "Script queued";
+  appendScriptStatus(root);
+}
+
 void handleApiInfo(AsyncWebServerRequest *request, JsonObject &root) {
   appendVersionInfo(root);
+  appendCoverStateBusStats(root);
 }
 
-void handleApiLogs(AsyncWebServerRequest *request, JsonArray &root) {
-  auto logs = getLogMessages();
-  for (const auto &msg : logs) {
-    root.add(msg);
+/* Without parameters: an array of every buffered message. With ?since=ID:
+ * only newer messages, with their IDs, so the UI can poll incrementally by
+ * passing back "last". "missed" counts messages overwritten before they were
+ * read; an ID from before a reboot starts over from the oldest message. */
+void handleApiLogs(AsyncWebServerRequest *request, JsonVariant &root) {
+  if (!request->hasParam("since")) {
+    JsonArray logs = root.to<JsonArray>();
+    readLogMessages(0, [&logs](uint32_t, const char *msg, size_t) { logs.add(msg); });
+    return;
   }
+
+  uint32_t since = strtoul(request->getParam("since")->value().c_str(), nullptr, 10);
+  const uint32_t last = lastLogId();
+  if (since > last) since = 0;
+  JsonObject obj = root.to<JsonObject>();
+  JsonArray entries = obj["entries"].to<JsonArray>();
+  obj["missed"] = readLogMessages(since, [&entries](uint32_t id, const char *msg, size_t) {
+    JsonObject entry = entries.add<JsonObject>();
+    entry["id"] = id;
+    entry["message"] = msg;
+  });
+  obj["last"] = entries.size() ? entries[entries.size() - 1]["id"].as<uint32_t>() : since;
 }
 
 void handleApiLastAddr(AsyncWebServerRequest *request, JsonObject &root) {
   root["address"] = bytesToHexString(IOHC::lastFromAddress, sizeof(IOHC::lastFromAddress)).c_str();
 }
 
+void handleApiLinkQuality(AsyncWebServerRequest *request, JsonObject &root) {
+  JsonArray devices = root["devices"].to<JsonArray>();
+  appendLinkQuality(devices);
+}
+
+void handleApiLinkQualityReset(AsyncWebServerRequest *request, JsonObject &doc, JsonObject &root) {
+  resetLinkQuality();
+  root["success"] = true;
+}
+
+void handleApiMetrics(AsyncWebServerRequest *request, JsonObject &root) {
+  JsonObject latency = root["latency"].to<JsonObject>();
+  appendLatencyMetrics(latency);
+}
+
+void handleApiMetricsReset(AsyncWebServerRequest *request, JsonObject &doc, JsonObject &root) {
+  resetLatency();
+  root["success"] = true;
+}
+
 static bool jsonToBool(JsonVariant variant, bool &value) {
   if (variant.is<bool>()) {
     value = variant.as<bool>();
@@ -474,6 +819,7 @@ void handleApiSyslogGet(AsyncWebServerRequest *request, JsonObject &root) {
   root["server"] = syslog_server.c_str();
   root["port"] = syslog_port;
   root["tag"] = syslog_tag.c_str();
+  appendSyslogStats(root);
 }
 
 void handleApiSyslogSet(AsyncWebServerRequest *request, JsonObject &doc, JsonObject &root) {
@@ -571,7 +917,7 @@ void handleApiSyslogTest(AsyncWebServerRequest *request, JsonObject &doc, JsonOb
   }
   sendSyslog("Test message from web UI", 6);
   root["success"] = true;
-  root["message"] = "Test message sent";
+  root["message"] = "Test message queued";
 }
 #endif
 
@@ -583,6 +929,8 @@ void handleApiMqttGet(AsyncWebServerRequest *request, JsonObject &root) {
   root["discovery"] = mqtt_discovery_topic.c_str();
   root["clientId"] = mqtt_client_id.c_str();
   root["port"] = mqtt_port;
+  root["frameSinks"] = frameSinksToString(mqtt_frame_sinks);
+  appendMqttDiagnostics(root);
 }
 
 void handleApiMqttSet(AsyncWebServerRequest *request, JsonObject &doc, JsonObject &root) {
@@ -591,6 +939,7 @@ void handleApiMqttSet(AsyncWebServerRequest *request, JsonObject &doc, JsonObjec
   String password = doc["password"] | "";
   String discovery = doc["discovery"] | "";
   String clientId = doc["clientId"] | "";
+  String frameSinks = doc["frameSinks"] | "";
   int portValue = -1;
   if (doc["port"].is<JsonVariant>()) {
     JsonVariant portVariant = doc["port"];
@@ -601,9 +950,20 @@ void handleApiMqttSet(AsyncWebServerRequest *request, JsonObject &doc, JsonObjec
     }
   }
 
+  uint8_t sinks = mqtt_frame_sinks;
+  if (!frameSinks.isEmpty() && !parseFrameSinks(frameSinks.c_str(), sinks)) {
+    request->send(400, "application/json",
+                  "{\"success\":false, \"message\":\"Invalid frameSinks, use json,sensor,cbor or none\"}");
+    return;
+  }
+
   bool mqttChanged = false;
   bool discChanged = false;
 
+  if (sinks != mqtt_frame_sinks) {
+    setFrameSinks(sinks);
+  }
+
   if (!server.isEmpty()) {
     mqtt_server = server.c_str();
     nvs_write_string(NVS_KEY_MQTT_SERVER, mqtt_server);
@@ -762,8 +1122,10 @@ void setupWebServer() {
   server.on("/api/info", HTTP_GET, jsonGet(handleApiInfo));
   server.on("/api/devices", HTTP_GET, jsonGet(handleApiDevices));
   server.on("/api/remotes", HTTP_GET, jsonGet(handleApiRemotes));
-  server.on("/api/logs", HTTP_GET, jsonGet(handleApiLogs));
+  server.on("/api/logs", HTTP_GET, _jsonGet(handleApiLogs));
   server.on("/api/lastaddr", HTTP_GET, jsonGet(handleApiLastAddr));
+  server.on("/api/linkquality", HTTP_GET, jsonGet(handleApiLinkQuality));
+  server.on("/api/metrics", HTTP_GET, jsonGet(handleApiMetrics));
 #if defined(SSD1306_DISPLAY)
   server.on("/api/display", HTTP_GET, jsonGet(handleApiDisplayGet));
 #endif
@@ -773,8 +1135,15 @@ void setupWebServer() {
 #if defined(MQTT)
   server.on("/api/mqtt", HTTP_GET, jsonGet(handleApiMqttGet));
 #endif
+  server.on("/api/scripts", HTTP_GET, jsonGet(handleApiScriptsGet));
   server.on("/api/command", HTTP_POST, jsonPost(handleApiCommand));
   server.on("/api/action", HTTP_POST, jsonPost(handleApiAction));
+  server.on("/api/actions", HTTP_POST, jsonPost(handleApiActions));
+  // Before /api/scripts, which would also match its sub-paths
+  server.on("/api/scripts/run", HTTP_POST, jsonPost(handleApiScriptsRun));
+  server.on("/api/linkquality/reset", HTTP_POST, jsonPost(handleApiLinkQualityReset));
+  server.on("/api/metrics/reset", HTTP_POST, jsonPost(handleApiMetricsReset));
+  server.on("/api/scripts", HTTP_POST, jsonPost(handleApiScriptsSet));
 #if defined(SSD1306_DISPLAY)
   server.on("/api/display", HTTP_POST, jsonPost(handleApiDisplaySet));
 #endif
@@ -798,6 +1167,9 @@ void setupWebServer() {
 
   ws.onEvent(onWsEvent);
   server.addHandler(&ws);
+  s_frameFilterMutex = xSemaphoreCreateMutex();
+  wsFrames.onEvent(onFramesEvent);
+  server.addHandler(&wsFrames);
 
   auto &staticHandler =
       server.serveStatic("/", LittleFS, "/web_interface_data/");
@@ -829,6 +1201,7 @@ void setupWebServer() {
 void loopWebServer() {
   // For ESPAsyncWebServer, most work is done asynchronously.
   ws.cleanupClients();
+  wsFrames.cleanupClients();
 }
 
 #endif // defined(WEBSERVER)
@@ -25,7 +25,7 @@
 #endif
 #include <WiFiManager.h>
 #include <ESPmDNS.h>
-#include <TickerUsESP32.h>
+#include <timer_service.h>
 #include <tuple>
 
 const long PORTAL_TIMEOUT = 300000; // 5 minuten = 300.000 ms
@@ -34,8 +34,8 @@ const uint32_t WIFI_NOTIFY_DISCONNECTED = BIT1;
 const uint32_t WIFI_NOTIFY_RECONNECT = BIT2;
 
 // below variables are thread safe because of the use of a single task that reads/modifies them (except for wifiStatus, but that one has atomic fields)
-TimersUS::TickerUsESP32 wifiReconnectTimer {};
-TimersUS::TickerUsESP32 rssiTimer {};
+TimerToken wifiReconnectTimer {};
+TimerToken rssiTimer {};
 WiFiStatus wifiStatus = { ConnState::Disconnected, 0, 0 };
 
 TaskHandle_t wifiWorkerTaskHandle = NULL;
@@ -88,8 +88,9 @@ static void handleWifiConnected() {
         wifiStatus.rssi = WiFi.RSSI();
         wifiStatus.signalStrengthPercent = rssiToQuality(wifiStatus.rssi);
 
-        wifiReconnectTimer.detach();
-        rssiTimer.attach(5, rssiTimerCb);
+        timerCancel(wifiReconnectTimer);
+        timerCancel(rssiTimer);
+        rssiTimer = timerEvery("wifi_rssi", 5000000ULL, rssiTimerCb, TimerDispatch::Worker);
         updateDisplayStatus();
 
         if (!mdnsStarted) {
@@ -115,8 +116,9 @@ static void configureWifiDisconnected() {
     wifiStatus.connectionStatus = ConnState::Disconnected;
     wifiStatus.signalStrengthPercent = 0;
     wifiStatus.rssi = 0;
-    rssiTimer.detach();
-    wifiReconnectTimer.attach(10, wifiReconnectTimerCb);
+    timerCancel(rssiTimer);
+    timerCancel(wifiReconnectTimer);
+    wifiReconnectTimer = timerEvery("wifi_reconnect", 10000000ULL, wifiReconnectTimerCb);
     mdnsStarted = false;
     updateDisplayStatus();
 }